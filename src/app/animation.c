@@ -0,0 +1,89 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "animation.h"
+#include "../utils/timer.h"
+
+/* Only the look changes between keyframes, so only the cells get repainted */
+static void _paint(Animation *animation, uint32_t keyframe)
+{
+  for (uint32_t i = 0; i < animation->cell_count; i++)
+    frame_set(animation->frame, animation->cells[i].x, animation->cells[i].y, animation->keyframes[keyframe].look);
+}
+
+void animation_init(Animation *animation)
+{
+  animation->cells = NULL;
+  animation->cell_count = 0;
+  animation->running = false;
+}
+
+void animation_free(Animation *animation)
+{
+  free(animation->cells);
+  animation_init(animation);
+}
+
+bool animation_start(Animation *animation, Frame *frame, const Vec2 *cells, uint32_t cell_count,
+                     const Keyframe *keyframes, uint32_t keyframe_count, uint64_t now)
+{
+  animation_free(animation);
+
+  animation->cells = malloc(sizeof(Vec2) * (cell_count > 0 ? cell_count : 1));
+  if (animation->cells == NULL)
+    return false;
+  memcpy(animation->cells, cells, sizeof(Vec2) * cell_count);
+
+  animation->frame = frame;
+  animation->cell_count = cell_count;
+  animation->keyframes = keyframes;
+  animation->keyframe_count = keyframe_count;
+  animation->current = 0;
+  animation->ends_at = now + keyframes[0].duration_ms;
+  animation->running = true;
+
+  _paint(animation, 0);
+  return true;
+}
+
+bool animation_advance(Animation *animation, uint64_t now)
+{
+  if (!animation->running)
+    return false;
+  if (now < animation->ends_at)
+    return true;
+
+  /* Skip every keyframe we were too late for */
+  uint32_t keyframe = animation->current;
+  while (now >= animation->ends_at && keyframe + 1 < animation->keyframe_count)
+  {
+    keyframe++;
+    animation->ends_at += animation->keyframes[keyframe].duration_ms;
+  }
+
+  if (now >= animation->ends_at)
+  {
+    /* The last keyframe is over too */
+    animation_skip(animation);
+    return false;
+  }
+
+  animation->current = keyframe;
+  _paint(animation, keyframe);
+  return true;
+}
+
+void animation_skip(Animation *animation)
+{
+  if (!animation->running)
+    return;
+
+  animation->current = animation->keyframe_count - 1;
+  _paint(animation, animation->current);
+  animation->running = false;
+}
+
+uint64_t animation_next_deadline(const Animation *animation)
+{
+  return animation->running ? animation->ends_at : TIMER_NEVER;
+}
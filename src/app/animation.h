@@ -0,0 +1,66 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../classes/vec.h"
+#include "../utils/frame.h"
+
+/* One step of an animation: how the cells look and for how long */
+typedef struct
+{
+  FrameCell look;
+  uint32_t duration_ms;
+} Keyframe;
+
+/*
+ * Keyframed effect on a set of board cells, painted on a Frame.
+ *
+ * Nothing here sleeps, whoever runs the animation calls animation_advance when
+ * animation_next_deadline passes (see timer.h) and presents the frame afterwards.
+ * If it's called late, the keyframes that were missed are skipped instead of played.
+ */
+typedef struct
+{
+  Frame *frame;
+  /* The animated cells (owned by the animation) */
+  Vec2 *cells;
+  uint32_t cell_count;
+  const Keyframe *keyframes;
+  uint32_t keyframe_count;
+  /* Keyframe on screen, and when it ends */
+  uint32_t current;
+  uint64_t ends_at;
+  bool running;
+} Animation;
+
+/* Readies an animation that isn't running (so animation_free is always safe) */
+void animation_init(Animation *animation);
+void animation_free(Animation *animation);
+
+/**
+ * animation_start
+ * Paints the first keyframe on the cells and starts timing it
+ * @param animation The animation
+ * @param frame Frame the cells are painted on
+ * @param cells Cells to animate (copied)
+ * @param cell_count Amount of cells
+ * @param keyframes Keyframes, they must outlive the animation
+ * @param keyframe_count Amount of keyframes (at least 1)
+ * @param now Current time on the timer_now_ms clock
+ * @return false if memory couldn't be allocated
+ */
+bool animation_start(Animation *animation, Frame *frame, const Vec2 *cells, uint32_t cell_count,
+                     const Keyframe *keyframes, uint32_t keyframe_count, uint64_t now);
+
+/* Paints whatever keyframe should be on screen at `now`, returns false once the animation is over */
+bool animation_advance(Animation *animation, uint64_t now);
+
+/* Jumps straight to the end (the last keyframe stays painted) */
+void animation_skip(Animation *animation);
+
+/* When animation_advance has something to do next, TIMER_NEVER if it isn't running */
+uint64_t animation_next_deadline(const Animation *animation);
+
+#endif /* ANIMATION_H */
@@ -0,0 +1,208 @@
+/**
+ * autoplay.c
+ * The solver playing the game on its own, as a demo or as a benchmark of the whole game.
+ *
+ * Moves come from solver_next_move, which only looks at what's on screen,
+ * and are sent to the game as keys one at a time.
+ */
+#include <stdio.h>
+#include <time.h>
+
+#include "autoplay.h"
+#include "engine.h"
+#include "game.h"
+#include "solver.h"
+#include "../utils/consoleutils.h"
+#include "../utils/input.h"
+#include "../utils/render.h"
+#include "../utils/timer.h"
+
+/* A new seed every time, like the games started from the menu */
+static uint64_t _seed()
+{
+  return (uint64_t)time(0) ^ ((uint64_t)clock() << 32);
+}
+
+/* Walks the cursor to `cell` with the arrow keys */
+static void _walk_cursor(Game *game, Vec2 cell, AutoplayReport *report)
+{
+  while (game->cursor.x != cell.x)
+  {
+    game_handle_key(game, (game->cursor.x < cell.x) ? VK_RIGHT : VK_LEFT);
+    report->keys++;
+  }
+  while (game->cursor.y != cell.y)
+  {
+    game_handle_key(game, (game->cursor.y < cell.y) ? VK_DOWN : VK_UP);
+    report->keys++;
+  }
+}
+
+/*
+ * Plays until the game is over, flushing after every move. Unless it's headless, it waits
+ * `delay_ms` between moves, reading keys (Escape stops it) and following the console's size.
+ */
+static void _play(Game *game, int32_t delay_ms, bool headless, AutoplayReport *report)
+{
+  const Vec2 invalid_blessing = {.x = -1, .y = -1};
+  uint16_t columns, rows;
+
+  while (game->engine.state == ENGINE_PLAYING)
+  {
+    const uint64_t started_at = timer_now_us();
+    SolverMove move;
+
+    /* The first click goes on the blessing, where the cursor starts */
+    if (game->engine.revealed == 0 && !vec_cmpr(game->noguess_blessing, invalid_blessing))
+    {
+      move.cell = game->noguess_blessing;
+      move.flag = false;
+      move.tier = SOLVER_TIER_NONE;
+    }
+    else if (!solver_next_move(game->board, game->width, game->height, &move, &game->arena))
+      break;
+
+    _walk_cursor(game, move.cell, report);
+    game_handle_key(game, move.flag ? 'f' : VK_ENTER);
+    report->keys++;
+    report->moves++;
+    report->guesses += move.tier == SOLVER_TIER_GUESS;
+
+    /* Keep the clock on the GUI going */
+    game_tick(game);
+    console_flush();
+    report->play_us += timer_now_us() - started_at;
+
+    if (headless)
+      continue;
+
+    if (wait_key(delay_ms) && get_key() == VK_ESCAPE)
+      break;
+    if (console_resized() && console_get_size(&columns, &rows))
+      game_resize(game, columns, rows);
+  }
+
+  report->games++;
+  report->won += game->engine.state == ENGINE_WON;
+}
+
+/* Lets the win/lose animation play until it's over, any key skips it */
+static void _play_animation(Game *game)
+{
+  while (game->running && game->engine.state != ENGINE_PLAYING)
+  {
+    uint64_t deadline = game_next_deadline(game), now = timer_now_ms();
+    int32_t timeout = (deadline == TIMER_NEVER) ? -1 : ((deadline > now) ? deadline - now : 0);
+
+    if (wait_key(timeout))
+      game_handle_key(game, get_key());
+    else
+      game_tick(game);
+    console_flush();
+  }
+}
+
+/* Readies a game on the console (or the null backend if `counts` isn't NULL) */
+static bool _start(Game *game, const Template *templ, uint64_t seed, RenderCounts *counts)
+{
+  if (counts == NULL)
+  {
+    clear_screen();
+    console_color_reset();
+  }
+
+  if (!game_init(game, templ, templ->width, templ->height, templ->bomb_amount, seed))
+  {
+    printf("There was a problem generating the game, returning to the main menu...");
+    fflush(stdout);
+    csleep(2);
+    return false;
+  }
+
+  if (counts != NULL)
+    console_set_backend(&render_null_backend, counts);
+  else
+  {
+    uint16_t columns, rows;
+    console_set_frames(true);
+    if (console_get_size(&columns, &rows))
+      game_resize(game, columns, rows);
+  }
+
+  game_draw(game);
+  console_flush();
+  return true;
+}
+
+static void _stop(Game *game, RenderCounts *counts)
+{
+  if (counts != NULL)
+    console_set_backend(NULL, NULL);
+  else
+    console_set_frames(false);
+  game_free(game);
+}
+
+static void _print_report(const char *label, const AutoplayReport *report)
+{
+  double seconds = report->play_us / 1000000.0;
+
+  console_foreground_set(CC_YELLOW);
+  printf("%s: ", label);
+  console_foreground_reset();
+  printf("%u games, %u won, %u moves (%u guesses), %u keys in %.3fs\n", report->games, report->won,
+         report->moves, report->guesses, report->keys, seconds);
+  printf("| %.0f moves/s, %.0f keys/s\n", (seconds > 0) ? report->moves / seconds : 0.0,
+         (seconds > 0) ? report->keys / seconds : 0.0);
+}
+
+static void _wait_for_key()
+{
+  printf("\nPress any key to go back to the menu...");
+  fflush(stdout);
+  while (!wait_key(-1))
+    ;
+  get_key();
+}
+
+void autoplay_watch(const Template *templ, uint16_t moves_per_second)
+{
+  AutoplayReport report = {0};
+  Game game;
+
+  if (!_start(&game, templ, _seed(), NULL))
+    return;
+
+  _play(&game, (moves_per_second > 0) ? 1000 / moves_per_second : 0, false, &report);
+  _play_animation(&game);
+  _stop(&game, NULL);
+
+  clear_screen();
+  _print_report("Solver", &report);
+  _wait_for_key();
+}
+
+void autoplay_benchmark(const Template *templ, uint32_t games)
+{
+  AutoplayReport rendered = {0}, headless = {0};
+  RenderCounts counts = {0};
+  const uint64_t seed = _seed();
+
+  /* Same boards both times, only the rendering changes */
+  for (uint32_t i = 0; i < games * 2; i++)
+  {
+    bool is_headless = i >= games;
+    Game game;
+
+    if (!_start(&game, templ, seed + i % games, is_headless ? &counts : NULL))
+      return;
+    _play(&game, 0, is_headless, is_headless ? &headless : &rendered);
+    _stop(&game, is_headless ? &counts : NULL);
+  }
+
+  clear_screen();
+  _print_report("Rendered", &rendered);
+  _print_report("Headless", &headless);
+  printf("| %llu bytes would have been drawn headless\n", (unsigned long long)counts.bytes);
+  _wait_for_key();
+}
@@ -0,0 +1,49 @@
+#ifndef AUTOPLAY_H
+#define AUTOPLAY_H
+
+#include <stdint.h>
+
+#include "../classes/templates.h"
+
+/* Games played for each half of autoplay_benchmark */
+#define AUTOPLAY_BENCHMARK_GAMES 10
+
+/*
+ * Autoplay: the solver plays through game_handle_key, exactly like a player would
+ * (arrows to walk the cursor, Enter to show or sweep, F to flag), so the engine and
+ * everything that draws the game run the same way they do for a person playing.
+ */
+
+typedef struct
+{
+  uint32_t games;
+  uint32_t won;
+  /* Clicks and flags the solver made, and how many of those clicks were guesses */
+  uint32_t moves;
+  uint32_t guesses;
+  /* Keys sent to the game, walking the cursor included */
+  uint32_t keys;
+  /* Time spent playing, generating the boards and waiting between moves don't count */
+  uint64_t play_us;
+} AutoplayReport;
+
+/**
+ * autoplay_watch
+ * The solver plays a game of the template on the console, Escape stops it
+ * (and skips the animation at the end). Shows how it went afterwards.
+ * @param templ Template to play
+ * @param moves_per_second How fast it plays, 0 to play as fast as it can
+ */
+void autoplay_watch(const Template *templ, uint16_t moves_per_second);
+
+/**
+ * autoplay_benchmark
+ * Plays `games` games of the template drawn on the console as fast as possible, then the same
+ * seeds again with the null render backend (nothing is sent to the terminal), and compares
+ * the moves per second of both.
+ * @param templ Template to play
+ * @param games Games to play for each of the two
+ */
+void autoplay_benchmark(const Template *templ, uint32_t games);
+
+#endif /* AUTOPLAY_H */
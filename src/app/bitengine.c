@@ -0,0 +1,267 @@
+/**
+ * bitengine.c
+ * The game rules on bit planes.
+ *
+ * A flood reveal keeps a front of cells to show (scratch[0]): they're shown a word at a time,
+ * the 0s among them are grown by one cell in every direction (shifts of their row and the rows
+ * next to it) and that's the next front, until no 0 is left to grow. Only the rows the front
+ * is on get looked at. Both scratch planes are all 0 between calls.
+ */
+#include "bitengine.h"
+
+static uint64_t _tail_mask(const BitPlane *plane)
+{
+  const uint16_t used = plane->width & 63;
+  return used == 0 ? ~(uint64_t)0 : (((uint64_t)1 << used) - 1);
+}
+
+/* Word k of a row, grown by one column each way */
+static inline uint64_t _spread(const uint64_t *row, uint16_t k, uint16_t row_words)
+{
+  uint64_t right = (row[k] << 1) | (k > 0 ? row[k - 1] >> 63 : 0);
+  uint64_t left = (row[k] >> 1) | (k + 1 < row_words ? row[k + 1] << 63 : 0);
+  return row[k] | left | right;
+}
+
+/* Columns x - 1, x and x + 1 of row y as 3 bits, 0 outside the board */
+static inline uint32_t _row3(const BitPlane *plane, int32_t x, int32_t y)
+{
+  if (y < 0 || y >= plane->height)
+    return 0;
+
+  const uint64_t *row = &plane->words[y * plane->row_words];
+  uint32_t bits = ((row[x >> 6] >> (x & 63)) & 1) << 1;
+  if (x > 0)
+    bits |= (row[(x - 1) >> 6] >> ((x - 1) & 63)) & 1;
+  if (x + 1 < plane->width)
+    bits |= ((row[(x + 1) >> 6] >> ((x + 1) & 63)) & 1) << 2;
+  return bits;
+}
+
+/* Set bits around (x, y), not counting (x, y) itself */
+static inline uint8_t _around(const BitPlane *plane, uint16_t x, uint16_t y)
+{
+  return __builtin_popcount(_row3(plane, x, y - 1)) + __builtin_popcount(_row3(plane, x, y) & 5) +
+         __builtin_popcount(_row3(plane, x, y + 1));
+}
+
+/* Covered cells around (x, y) that aren't flagged */
+static uint8_t _hidden_around(const BitEngine *engine, uint16_t x, uint16_t y)
+{
+  const uint32_t columns = (x > 0 ? 1 : 0) | 2 | (x + 1 < engine->width ? 4 : 0);
+  uint8_t hidden = 0;
+
+  for (int32_t i = -1; i <= 1; i++)
+  {
+    if (y + i < 0 || y + i >= engine->height)
+      continue;
+    uint32_t covered = columns & ~_row3(&engine->planes.revealed, x, y + i) & ~_row3(&engine->planes.flags, x, y + i);
+    hidden += __builtin_popcount(i == 0 ? covered & 5 : covered);
+  }
+  return hidden;
+}
+
+/* Shows every cell on the front (rows top to bottom) and floods from the 0s, the front is left empty */
+static void _reveal(BitEngine *engine, int32_t top, int32_t bottom)
+{
+  BoardPlanes *planes = &engine->planes;
+  BitPlane *front = &planes->scratch[0];
+  BitPlane *grown = &planes->scratch[1];
+  const uint16_t row_words = front->row_words;
+  const uint64_t tail = _tail_mask(front);
+
+  while (true)
+  {
+    int32_t first = INT32_MAX, last = -1;
+
+    for (int32_t y = top; y <= bottom; y++)
+      for (uint16_t k = 0; k < row_words; k++)
+      {
+        const uint32_t i = y * row_words + k;
+        const uint64_t shown = front->words[i] & ~planes->revealed.words[i];
+        front->words[i] = 0;
+        if (shown == 0)
+          continue;
+
+        /* Showing a cell takes its flag off, 0s show their flagged neighbours too */
+        planes->revealed.words[i] |= shown;
+        engine->flags -= __builtin_popcountll(shown & planes->flags.words[i]);
+        planes->flags.words[i] &= ~shown;
+
+        /* Only clicked or swept cells can be bombs, a 0 never has one around */
+        engine->revealed += __builtin_popcountll(shown & ~planes->mines.words[i]);
+        if (shown & planes->mines.words[i])
+          engine->state = ENGINE_LOST;
+
+        if (shown & planes->zeros.words[i])
+        {
+          grown->words[i] = shown & planes->zeros.words[i];
+          first = (y < first) ? y : first;
+          last = y;
+        }
+      }
+
+    if (last < 0)
+      break;
+
+    /* The 0s just shown, grown by a cell, are the next front */
+    for (int32_t y = first; y <= last; y++)
+    {
+      const uint64_t *row = &grown->words[y * row_words];
+      for (uint16_t k = 0; k < row_words; k++)
+      {
+        const uint64_t spread = _spread(row, k, row_words) & ((k + 1 == row_words) ? tail : ~(uint64_t)0);
+        if (y > 0)
+          front->words[(y - 1) * row_words + k] |= spread;
+        front->words[y * row_words + k] |= spread;
+        if (y + 1 < front->height)
+          front->words[(y + 1) * row_words + k] |= spread;
+      }
+    }
+    for (int32_t y = first; y <= last; y++)
+      for (uint16_t k = 0; k < row_words; k++)
+        grown->words[y * row_words + k] = 0;
+
+    top = (first > 0) ? first - 1 : 0;
+    bottom = (last + 1 < front->height) ? last + 1 : last;
+  }
+}
+
+static bool _can_sweep(const BitEngine *engine, uint16_t x, uint16_t y)
+{
+  const uint8_t amount = _around(&engine->planes.mines, x, y);
+
+  return bitplane_get(&engine->planes.revealed, x, y) && !bitplane_get(&engine->planes.mines, x, y) && amount > 0 &&
+         _around(&engine->planes.flags, x, y) == amount && _hidden_around(engine, x, y) > 0;
+}
+
+/* Shows every neighbour that isn't flagged (see _sweep_field in engine.c) */
+static void _sweep(BitEngine *engine, uint16_t x, uint16_t y)
+{
+  if (!_can_sweep(engine, x, y))
+    return;
+
+  for (int32_t i = -1; i <= 1; i++)
+  {
+    if (y + i < 0 || y + i >= engine->height)
+      continue;
+    for (int32_t j = -1; j <= 1; j++)
+    {
+      if (x + j < 0 || x + j >= engine->width || (i == 0 && j == 0) || bitplane_get(&engine->planes.flags, x + j, y + i))
+        continue;
+      bitplane_set(&engine->planes.scratch[0], x + j, y + i);
+    }
+  }
+
+  _reveal(engine, (y > 0) ? y - 1 : 0, (y + 1 < engine->height) ? y + 1 : y);
+}
+
+/* Every safe cell is shown, the bombs left get flagged like in the original */
+static void _check_win(BitEngine *engine)
+{
+  if (engine->state != ENGINE_PLAYING || engine->revealed != (uint32_t)engine->width * engine->height - engine->bomb_amount)
+    return;
+
+  engine->state = ENGINE_WON;
+  const uint32_t words = (uint32_t)engine->planes.flags.row_words * engine->height;
+  for (uint32_t i = 0; i < words; i++)
+  {
+    engine->flags += __builtin_popcountll(engine->planes.mines.words[i] & ~engine->planes.flags.words[i]);
+    engine->planes.flags.words[i] |= engine->planes.mines.words[i];
+  }
+}
+
+bool bitengine_init(BitEngine *engine, Minefield **board, uint16_t width, uint16_t height, uint16_t bomb_amount)
+{
+  engine->width = width;
+  engine->height = height;
+  engine->bomb_amount = bomb_amount;
+  if (!board_planes_init(&engine->planes, width, height))
+    return false;
+
+  bitengine_load(engine, board, ENGINE_PLAYING);
+  return true;
+}
+
+void bitengine_free(BitEngine *engine)
+{
+  board_planes_free(&engine->planes);
+}
+
+void bitengine_load(BitEngine *engine, Minefield **board, EngineState state)
+{
+  board_planes_load(&engine->planes, board);
+  engine->revealed = board_planes_revealed_safe(&engine->planes);
+  engine->flags = bitplane_count(&engine->planes.flags);
+  engine->state = state;
+}
+
+void bitengine_click(BitEngine *engine, uint16_t x, uint16_t y)
+{
+  if (engine->state != ENGINE_PLAYING)
+    return;
+
+  if (bitplane_get(&engine->planes.mines, x, y))
+    engine->state = ENGINE_LOST;
+  else if (bitplane_get(&engine->planes.revealed, x, y))
+    _sweep(engine, x, y);
+  else if (!bitplane_get(&engine->planes.flags, x, y))
+  {
+    bitplane_set(&engine->planes.scratch[0], x, y);
+    _reveal(engine, y, y);
+  }
+
+  _check_win(engine);
+}
+
+void bitengine_flag(BitEngine *engine, uint16_t x, uint16_t y)
+{
+  if (engine->state != ENGINE_PLAYING || bitplane_get(&engine->planes.revealed, x, y))
+    return;
+
+  const uint64_t bit = (uint64_t)1 << (x & 63);
+  uint64_t *word = &engine->planes.flags.words[y * engine->planes.flags.row_words + (x >> 6)];
+  *word ^= bit;
+  engine->flags += (*word & bit) ? 1 : -1;
+}
+
+uint32_t bitengine_sweep_all(BitEngine *engine)
+{
+  if (engine->state != ENGINE_PLAYING)
+    return 0;
+
+  const BoardPlanes *planes = &engine->planes;
+  const uint16_t row_words = planes->revealed.row_words;
+  uint32_t swept = 0;
+
+  /* Shown numbers in board order, read again after every sweep since sweeping shows more of them */
+  for (uint16_t y = 0; y < engine->height && engine->state == ENGINE_PLAYING; y++)
+    for (uint16_t k = 0; k < row_words && engine->state == ENGINE_PLAYING; k++)
+    {
+      const uint32_t i = y * row_words + k;
+      uint64_t passed = 0;
+
+      while (engine->state == ENGINE_PLAYING)
+      {
+        const uint64_t numbers = planes->revealed.words[i] & ~planes->mines.words[i] & ~planes->zeros.words[i] & ~passed;
+        if (numbers == 0)
+          break;
+
+        const uint16_t bit = __builtin_ctzll(numbers);
+        passed = (bit == 63) ? ~(uint64_t)0 : ((uint64_t)2 << bit) - 1;
+        if (_can_sweep(engine, k * 64 + bit, y))
+        {
+          _sweep(engine, k * 64 + bit, y);
+          swept++;
+        }
+      }
+    }
+
+  _check_win(engine);
+  return swept;
+}
+
+uint8_t bitengine_amount(const BitEngine *engine, uint16_t x, uint16_t y)
+{
+  return _around(&engine->planes.mines, x, y) + bitplane_get(&engine->planes.mines, x, y);
+}
@@ -0,0 +1,69 @@
+#ifndef BITENGINE_H
+#define BITENGINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "engine.h"
+#include "../classes/bitplane.h"
+#include "../classes/minefield.h"
+
+/*
+ * The game rules on bit planes (see bitplane.h), for playing lots of games fast (solver self-play).
+ *
+ * Mines, revealed cells and flags are a bit each, so a flood reveal is the revealed plane growing
+ * through the zero plane a whole row at a time, and a cell's number is a popcount of the mine plane
+ * around it. Same rules as the engine for clicks, flags and engine_sweep_all, without undo/redo,
+ * 3BV or changed cells. The Minefield board is only read, by bitengine_init and bitengine_load.
+ */
+typedef struct
+{
+  uint16_t width;
+  uint16_t height;
+  uint16_t bomb_amount;
+  BoardPlanes planes;
+
+  /* Safe cells revealed and flags on the board, both kept with popcounts of what changed */
+  uint32_t revealed;
+  uint32_t flags;
+  EngineState state;
+} BitEngine;
+
+/**
+ * bitengine_init
+ * Sets an engine up on a board, with whatever is already revealed and flagged on it
+ * @return false if memory couldn't be allocated
+ */
+bool bitengine_init(BitEngine *engine, Minefield **board, uint16_t width, uint16_t height, uint16_t bomb_amount);
+void bitengine_free(BitEngine *engine);
+
+/**
+ * bitengine_load
+ * Picks a position up from a board of the same size (after an undo on the Minefield side, say)
+ * @param state The game's state, a bomb that was clicked isn't shown so the board doesn't tell
+ */
+void bitengine_load(BitEngine *engine, Minefield **board, EngineState state);
+
+/* Same as engine_click: shows a covered cell (flooding from 0s), sweeps a shown one, loses on a bomb */
+void bitengine_click(BitEngine *engine, uint16_t x, uint16_t y);
+
+/* Toggles the flag on (x, y) if it isn't shown */
+void bitengine_flag(BitEngine *engine, uint16_t x, uint16_t y);
+
+/* Same pass over the board as engine_sweep_all, returns how many numbers were swept */
+uint32_t bitengine_sweep_all(BitEngine *engine);
+
+/* Bombs around the cell (its own included, like Minefield) */
+uint8_t bitengine_amount(const BitEngine *engine, uint16_t x, uint16_t y);
+
+static inline bool bitengine_is_shown(const BitEngine *engine, uint16_t x, uint16_t y)
+{
+  return bitplane_get(&engine->planes.revealed, x, y);
+}
+
+static inline bool bitengine_is_flagged(const BitEngine *engine, uint16_t x, uint16_t y)
+{
+  return bitplane_get(&engine->planes.flags, x, y);
+}
+
+#endif /* BITENGINE_H */
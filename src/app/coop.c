@@ -0,0 +1,347 @@
+/**
+ * coop.c
+ * A board shared by many players at once, lock-free.
+ *
+ * Cells only ever change through a compare-and-swap of their byte. A reveal that loses the swap
+ * (someone else showed the cell first) stops right there, which is what lets flood reveals of
+ * different players run into each other without counting a cell twice. Whoever changes a cell
+ * marks it on every player's feed, the players poll their own feed to redraw just those cells.
+ */
+
+#include "coop.h"
+#include "../utils/profile.h"
+
+#define COOP_ALL_BITS UINT64_MAX
+
+static uint32_t _safe_cells(const CoopBoard *coop)
+{
+  return (uint32_t)coop->width * coop->height - coop->bomb_amount;
+}
+
+/* Marks the cell on the feed of every player on the board */
+static void _mark(CoopBoard *coop, uint32_t index)
+{
+  const uint32_t word = index / 64;
+  const uint64_t bit = (uint64_t)1 << (index % 64);
+
+  for (int32_t i = 0; i < COOP_MAX_PLAYERS; i++)
+  {
+    CoopPlayer *player = &coop->players[i];
+    if (!atomic_load_explicit(&player->joined, memory_order_acquire))
+      continue;
+
+    /* Only the first change to a word has to tell the summary, the word is already on it otherwise */
+    if (atomic_fetch_or(&player->dirty[word], bit) == 0)
+      atomic_fetch_or(&player->summary[word / 64], (uint64_t)1 << (word % 64));
+  }
+}
+
+/* The game is over, only the first one to end it counts (a win flags every bomb) */
+static void _finish(CoopBoard *coop, EngineState state)
+{
+  int expected = ENGINE_PLAYING;
+  if (!atomic_compare_exchange_strong(&coop->state, &expected, state) || state != ENGINE_WON)
+    return;
+
+  for (uint32_t i = 0; i < (uint32_t)coop->width * coop->height; i++)
+  {
+    /* A flag that was on its way when the game was won can still land, so this has to swap too */
+    uint8_t old = atomic_load(&coop->cells[i]);
+    bool flagged = false;
+    while ((old & COOP_BOMB) && !(old & COOP_FLAG) && !flagged)
+      flagged = atomic_compare_exchange_weak(&coop->cells[i], &old, old | COOP_FLAG);
+    if (!flagged)
+      continue;
+
+    atomic_fetch_add(&coop->flags, 1);
+    atomic_fetch_add(&coop->correct_flags, 1);
+    _mark(coop, i);
+  }
+}
+
+/*
+ * Shows a single cell, flags get taken off only when `over_flags` (a flood reveal does that, a sweep doesn't).
+ * Returns false if there was nothing to do, or someone else showed it first.
+ */
+static bool _reveal(CoopBoard *coop, uint32_t index, bool over_flags)
+{
+  uint8_t old = atomic_load(&coop->cells[index]);
+  do
+  {
+    if ((old & COOP_SHOWN) || ((old & COOP_FLAG) && !over_flags))
+      return false;
+  } while (!atomic_compare_exchange_weak(&coop->cells[index], &old, (old | COOP_SHOWN) & ~COOP_FLAG));
+
+  if (old & COOP_FLAG)
+  {
+    atomic_fetch_sub(&coop->flags, 1);
+    if (old & COOP_BOMB)
+      atomic_fetch_sub(&coop->correct_flags, 1);
+  }
+  _mark(coop, index);
+
+  if (old & COOP_BOMB)
+    _finish(coop, ENGINE_LOST);
+  else if (atomic_fetch_add(&coop->revealed, 1) + 1 == _safe_cells(coop))
+    _finish(coop, ENGINE_WON);
+  return true;
+}
+
+static bool _is_zero(const CoopBoard *coop, uint32_t index)
+{
+  return (atomic_load_explicit(&coop->cells[index], memory_order_relaxed) & (COOP_AMOUNT_MASK | COOP_BOMB)) == 0;
+}
+
+/* Shows the cell and floods from it if it's a 0, `stack` has room for every cell */
+static void _show(CoopBoard *coop, uint16_t x, uint16_t y, bool over_flags, uint32_t *stack)
+{
+  uint32_t index = (uint32_t)y * coop->width + x;
+  if (!_reveal(coop, index, over_flags) || !_is_zero(coop, index))
+    return;
+
+  /* Only cells this player showed get on its stack, so every cell is flooded from exactly once */
+  uint32_t count = 0;
+  stack[count++] = index;
+  while (count > 0)
+  {
+    index = stack[--count];
+    const int32_t cx = index % coop->width, cy = index / coop->width;
+
+    for (int32_t i = -1; i <= 1; i++)
+      for (int32_t j = -1; j <= 1; j++)
+      {
+        if (cy + i < 0 || cy + i >= coop->height || cx + j < 0 || cx + j >= coop->width || (i == 0 && j == 0))
+          continue;
+
+        uint32_t around = (uint32_t)(cy + i) * coop->width + cx + j;
+        if (_reveal(coop, around, true) && _is_zero(coop, around))
+          stack[count++] = around;
+      }
+  }
+}
+
+/*
+ * Whether sweeping the cell would show anything (see engine_can_sweep), `flagged` gets a bit for
+ * every neighbour that was flagged ((i + 1) * 3 + j + 1 for the neighbour at x + j, y + i)
+ */
+static bool _can_sweep(const CoopBoard *coop, uint16_t x, uint16_t y, uint16_t *flagged)
+{
+  uint8_t cell = atomic_load(&coop->cells[(uint32_t)y * coop->width + x]);
+  if (!(cell & COOP_SHOWN) || (cell & COOP_BOMB) || (cell & COOP_AMOUNT_MASK) == 0)
+    return false;
+
+  uint8_t flags = 0, hidden = 0;
+  *flagged = 0;
+  for (int32_t i = -1; i <= 1; i++)
+    for (int32_t j = -1; j <= 1; j++)
+    {
+      if (y + i < 0 || y + i >= coop->height || x + j < 0 || x + j >= coop->width || (i == 0 && j == 0))
+        continue;
+
+      uint8_t around = atomic_load(&coop->cells[(uint32_t)(y + i) * coop->width + x + j]);
+      if (around & COOP_FLAG)
+      {
+        flags++;
+        *flagged |= 1 << ((i + 1) * 3 + j + 1);
+      }
+      hidden += !(around & (COOP_FLAG | COOP_SHOWN));
+    }
+  return flags == (cell & COOP_AMOUNT_MASK) && hidden > 0;
+}
+
+/*
+ * Shows the neighbours that weren't flagged when the sweep was checked, a flag someone takes off
+ * in the meantime still counts (the player swept because of it)
+ */
+static void _sweep(CoopBoard *coop, uint16_t x, uint16_t y, uint16_t flagged, uint32_t *stack)
+{
+  for (int32_t i = -1; i <= 1; i++)
+    for (int32_t j = -1; j <= 1; j++)
+    {
+      if (y + i < 0 || y + i >= coop->height || x + j < 0 || x + j >= coop->width || (i == 0 && j == 0) ||
+          (flagged & (1 << ((i + 1) * 3 + j + 1))))
+        continue;
+      _show(coop, x + j, y + i, false, stack);
+    }
+}
+
+bool coop_init(CoopBoard *coop, Minefield **board, uint16_t width, uint16_t height, uint16_t bomb_amount, Arena *arena)
+{
+  const uint32_t cell_count = (uint32_t)width * height;
+
+  coop->width = width;
+  coop->height = height;
+  coop->bomb_amount = bomb_amount;
+  coop->dirty_words = (cell_count + 63) / 64;
+  coop->summary_words = (coop->dirty_words + 63) / 64;
+  atomic_init(&coop->revealed, 0);
+  atomic_init(&coop->flags, 0);
+  atomic_init(&coop->correct_flags, 0);
+  atomic_init(&coop->state, ENGINE_PLAYING);
+
+  coop->cells = arena_alloc(arena, sizeof(*coop->cells) * cell_count);
+  if (coop->cells == NULL)
+    return false;
+
+  for (uint16_t y = 0; y < height; y++)
+    for (uint16_t x = 0; x < width; x++)
+      atomic_init(&coop->cells[(uint32_t)y * width + x], (board[y][x].has_bomb ? COOP_BOMB : 0) | board[y][x].bomb_amount);
+
+  /* Every player's feed up front, joining never allocates */
+  for (int32_t i = 0; i < COOP_MAX_PLAYERS; i++)
+  {
+    CoopPlayer *player = &coop->players[i];
+    atomic_init(&player->joined, false);
+    player->dirty = arena_calloc(arena, coop->dirty_words, sizeof(*player->dirty));
+    player->summary = arena_calloc(arena, coop->summary_words, sizeof(*player->summary));
+    if (player->dirty == NULL || player->summary == NULL)
+      return false;
+  }
+
+  return true;
+}
+
+int32_t coop_join(CoopBoard *coop)
+{
+  for (int32_t i = 0; i < COOP_MAX_PLAYERS; i++)
+  {
+    CoopPlayer *player = &coop->players[i];
+    bool expected = false;
+    if (!atomic_compare_exchange_strong(&player->joined, &expected, true))
+      continue;
+
+    /* Everything is new to a player that just joined (the bits past the last cell are never set) */
+    const uint32_t cell_count = (uint32_t)coop->width * coop->height;
+    for (uint32_t word = 0; word < coop->dirty_words; word++)
+      atomic_store(&player->dirty[word], (word + 1) * 64 <= cell_count ? COOP_ALL_BITS : ((uint64_t)1 << (cell_count % 64)) - 1);
+    for (uint32_t word = 0; word < coop->summary_words; word++)
+      atomic_store(&player->summary[word], (word + 1) * 64 <= coop->dirty_words ? COOP_ALL_BITS : ((uint64_t)1 << (coop->dirty_words % 64)) - 1);
+    return i;
+  }
+
+  return -1;
+}
+
+void coop_leave(CoopBoard *coop, int32_t player)
+{
+  atomic_store_explicit(&coop->players[player].joined, false, memory_order_release);
+}
+
+EngineState coop_state(const CoopBoard *coop)
+{
+  return atomic_load(&coop->state);
+}
+
+void coop_cell(const CoopBoard *coop, uint16_t x, uint16_t y, Minefield *field)
+{
+  uint8_t cell = atomic_load(&coop->cells[(uint32_t)y * coop->width + x]);
+  field->has_bomb = (cell & COOP_BOMB) != 0;
+  field->is_flagged = (cell & COOP_FLAG) != 0;
+  field->is_mined = (cell & COOP_SHOWN) != 0;
+  field->bomb_amount = cell & COOP_AMOUNT_MASK;
+}
+
+void coop_click(CoopBoard *coop, uint16_t x, uint16_t y, Arena *scratch)
+{
+  if (coop_state(coop) != ENGINE_PLAYING)
+    return;
+
+  const uint64_t started_at = profile_start();
+  ArenaMark mark = arena_mark(scratch);
+  uint32_t *stack = arena_alloc(scratch, sizeof(uint32_t) * coop->width * coop->height);
+  uint8_t cell = atomic_load(&coop->cells[(uint32_t)y * coop->width + x]);
+
+  if (stack == NULL)
+    return;
+
+  /* Same order as engine_click: a bomb blows up flagged or not */
+  if (cell & COOP_BOMB)
+    _finish(coop, ENGINE_LOST);
+  else if (cell & COOP_SHOWN)
+  {
+    uint16_t flagged;
+    if (_can_sweep(coop, x, y, &flagged))
+      _sweep(coop, x, y, flagged, stack);
+  }
+  else
+    _show(coop, x, y, false, stack);
+
+  arena_rewind(scratch, mark);
+  profile_stop(PROFILE_REVEAL, started_at);
+}
+
+void coop_flag(CoopBoard *coop, uint16_t x, uint16_t y)
+{
+  if (coop_state(coop) != ENGINE_PLAYING)
+    return;
+
+  const uint32_t index = (uint32_t)y * coop->width + x;
+  uint8_t old = atomic_load(&coop->cells[index]);
+  do
+  {
+    if (old & COOP_SHOWN)
+      return;
+  } while (!atomic_compare_exchange_weak(&coop->cells[index], &old, old ^ COOP_FLAG));
+
+  const int step = (old & COOP_FLAG) ? -1 : 1;
+  atomic_fetch_add(&coop->flags, step);
+  if (old & COOP_BOMB)
+    atomic_fetch_add(&coop->correct_flags, step);
+  _mark(coop, index);
+}
+
+void coop_sweep_all(CoopBoard *coop, Arena *scratch)
+{
+  ArenaMark mark = arena_mark(scratch);
+  uint32_t *stack = arena_alloc(scratch, sizeof(uint32_t) * coop->width * coop->height);
+  if (stack == NULL)
+    return;
+
+  const uint64_t started_at = profile_start();
+  uint16_t flagged;
+  for (uint16_t y = 0; y < coop->height && coop_state(coop) == ENGINE_PLAYING; y++)
+    for (uint16_t x = 0; x < coop->width && coop_state(coop) == ENGINE_PLAYING; x++)
+      if (_can_sweep(coop, x, y, &flagged))
+        _sweep(coop, x, y, flagged, stack);
+
+  arena_rewind(scratch, mark);
+  profile_stop(PROFILE_REVEAL, started_at);
+}
+
+uint32_t coop_poll(CoopBoard *coop, int32_t player_index, uint32_t *cells, uint32_t capacity)
+{
+  CoopPlayer *player = &coop->players[player_index];
+  uint32_t count = 0;
+
+  for (uint32_t s = 0; s < coop->summary_words && count < capacity; s++)
+  {
+    uint64_t words = atomic_exchange(&player->summary[s], 0);
+    while (words != 0)
+    {
+      const uint32_t word = s * 64 + __builtin_ctzll(words);
+      uint64_t bits = atomic_exchange(&player->dirty[word], 0);
+
+      while (bits != 0 && count < capacity)
+      {
+        cells[count++] = word * 64 + __builtin_ctzll(bits);
+        bits &= bits - 1;
+      }
+
+      /* Out of room, whatever is left goes back on the feed for the next poll */
+      if (bits != 0)
+      {
+        atomic_fetch_or(&player->dirty[word], bits);
+        atomic_fetch_or(&player->summary[s], words);
+        return count;
+      }
+      words &= words - 1;
+      if (count == capacity && words != 0)
+      {
+        atomic_fetch_or(&player->summary[s], words);
+        return count;
+      }
+    }
+  }
+
+  return count;
+}
@@ -0,0 +1,107 @@
+#ifndef COOP_H
+#define COOP_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "engine.h"
+#include "../classes/arena.h"
+#include "../classes/minefield.h"
+
+/* Players that can be on a board at once */
+#define COOP_MAX_PLAYERS 64
+
+/* A cell is a single byte: the bombs around it (bomb included, like Minefield) and these bits */
+#define COOP_AMOUNT_MASK 0x0f
+#define COOP_BOMB 0x10
+#define COOP_FLAG 0x20
+#define COOP_SHOWN 0x40
+
+/*
+ * A player's change feed: one bit per cell that changed since the player last polled,
+ * and one bit per 64 cells telling where to look, so polling skips the quiet parts of the board
+ */
+typedef struct
+{
+  atomic_bool joined;
+  atomic_uint_fast64_t *dirty;
+  atomic_uint_fast64_t *summary;
+} CoopPlayer;
+
+/*
+ * Cooperative board: any amount of players (threads, server sessions) clicking and flagging
+ * on the same board at the same time, without any lock.
+ *
+ * Every change to a cell is a compare-and-swap of its byte, so when two players reveal the same
+ * cell (two flood reveals running into each other, say) only the one whose swap went through counts it
+ * and keeps flooding from it. The counters are atomic and the state only ever moves from
+ * ENGINE_PLAYING to WON or LOST once.
+ *
+ * Same rules as the engine, without undo/redo or 3BV. A sweep only shows the neighbours that weren't
+ * flagged when it counted the flags, so another player taking a flag off right then can't blow it up.
+ */
+typedef struct
+{
+  uint16_t width;
+  uint16_t height;
+  uint16_t bomb_amount;
+  _Atomic uint8_t *cells;
+
+  atomic_uint revealed;
+  atomic_uint flags;
+  atomic_uint correct_flags;
+  /* An EngineState */
+  atomic_int state;
+
+  /* 64 bit words of a player's dirty bits, and of its summary */
+  uint32_t dirty_words;
+  uint32_t summary_words;
+  CoopPlayer players[COOP_MAX_PLAYERS];
+} CoopBoard;
+
+/**
+ * coop_init
+ * Sets a shared board up from an already generated one (nothing revealed or flagged yet),
+ * its memory comes from the arena and goes away with it
+ * @return false if memory couldn't be allocated
+ */
+bool coop_init(CoopBoard *coop, Minefield **board, uint16_t width, uint16_t height, uint16_t bomb_amount, Arena *arena);
+
+/**
+ * coop_join
+ * Takes a free player slot, every cell starts marked as changed on its feed
+ * @return The player, -1 if the board is full
+ */
+int32_t coop_join(CoopBoard *coop);
+void coop_leave(CoopBoard *coop, int32_t player);
+
+/* The state of the game, an EngineState */
+EngineState coop_state(const CoopBoard *coop);
+
+/* Copies a cell's byte out into a Minefield */
+void coop_cell(const CoopBoard *coop, uint16_t x, uint16_t y, Minefield *field);
+
+/**
+ * coop_click
+ * Shows the cell (flooding from 0s), sweeps it if it's a number already shown, or blows up
+ * @param scratch Arena for the flood reveal's stack (given back before returning)
+ */
+void coop_click(CoopBoard *coop, uint16_t x, uint16_t y, Arena *scratch);
+
+/* Toggles the cell's flag if it isn't shown */
+void coop_flag(CoopBoard *coop, uint16_t x, uint16_t y);
+
+/* Sweeps every number that can be swept (see engine_sweep_all) */
+void coop_sweep_all(CoopBoard *coop, Arena *scratch);
+
+/**
+ * coop_poll
+ * Takes cells off the player's change feed, only the player itself may poll it
+ * @param cells Where the indexes (y * width + x) of the changed cells are written
+ * @param capacity Room in `cells`
+ * @return How many were written, 0 once nothing changed since the last poll
+ */
+uint32_t coop_poll(CoopBoard *coop, int32_t player, uint32_t *cells, uint32_t capacity);
+
+#endif /* COOP_H */
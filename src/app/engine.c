@@ -0,0 +1,1065 @@
+/**
+ * engine.c
+ * Minesweeper rules with incremental bookkeeping.
+ *
+ * Same rules game.c always had (showing, sweeping, flagging), but every counter the game
+ * needs is kept up to date cell by cell, so the cost of an action only depends on how many
+ * cells it changes and never on the size of the board.
+ */
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "engine.h"
+#include "metrics.h"
+#include "../utils/profile.h"
+#include "../utils/threads.h"
+
+/*
+ * Journal entries: the kind in the top bits, and either a cell's index or
+ * a state in the rest. Every action starts with a JOURNAL_ACTION entry.
+ */
+#define JOURNAL_KIND_SHIFT 29
+#define JOURNAL_PAYLOAD_MASK ((1u << JOURNAL_KIND_SHIFT) - 1)
+
+typedef enum
+{
+  /* Start of an action, with the state before it */
+  JOURNAL_ACTION,
+  /* The state the action left the game in, when it changed */
+  JOURNAL_STATE,
+  JOURNAL_FLAG,
+  JOURNAL_UNFLAG,
+  JOURNAL_REVEAL,
+  /* Reveal of the first cell of an opening (see metrics.h) */
+  JOURNAL_REVEAL_OPENING
+} JournalKind;
+
+/* Writes down a change of the action in progress, behind its JOURNAL_ACTION entry */
+static void _record(Engine *engine, JournalKind kind, uint32_t payload)
+{
+  if (!engine->recording)
+    return;
+
+  bool ok = true;
+  if (!engine->action_recorded)
+  {
+    ok = journal_push(&engine->journal, (JOURNAL_ACTION << JOURNAL_KIND_SHIFT) | engine->action_state);
+    engine->action_recorded = true;
+  }
+  ok = ok && journal_push(&engine->journal, (kind << JOURNAL_KIND_SHIFT) | payload);
+
+  /* Half an action can't be undone, without memory the history just starts over */
+  if (!ok)
+  {
+    journal_clear(&engine->journal);
+    engine->recording = false;
+  }
+}
+
+/*
+ * Every action counts as a click, but the ones that don't change anything aren't journaled,
+ * so the JOURNAL_ACTION entry waits for the first change
+ */
+static void _begin_action(Engine *engine)
+{
+  engine->clicks++;
+  engine->recording = true;
+  engine->action_recorded = false;
+  engine->action_state = engine->state;
+}
+
+static void _end_action(Engine *engine)
+{
+  if (engine->state != engine->action_state)
+    _record(engine, JOURNAL_STATE, engine->state);
+  engine->recording = false;
+}
+
+/* Remember a cell has to be redrawn */
+static void _mark_changed(Engine *engine, uint16_t x, uint16_t y)
+{
+  if (engine->changed_count >= (uint32_t)engine->width * engine->height)
+    return;
+
+  Vec2 cell = {.x = x, .y = y};
+  engine->changed[engine->changed_count++] = cell;
+}
+
+/*
+ * Adds to the flags_around/hidden_around of every neighbour of (x, y)
+ *
+ * This and _show_field are the hot loops, every board size goes through the same code: copies with the
+ * template sizes built in (constant offsets and divisions) were tried, and at -O2 they were no faster
+ * than skipping the bounds checks away from the edges, which every size gets.
+ */
+static void _update_around(Engine *engine, uint16_t x, uint16_t y, int8_t flags, int8_t hidden)
+{
+  const uint16_t width = engine->width, height = engine->height;
+  const uint32_t cell = (uint32_t)y * width + x;
+
+  /* Away from the edges every neighbour is there */
+  if (x > 0 && y > 0 && x + 1 < width && y + 1 < height)
+  {
+    const int32_t offsets[8] = {-width - 1, -width, -width + 1, -1, 1, width - 1, width, width + 1};
+    for (uint32_t k = 0; k < 8; k++)
+    {
+      engine->flags_around[cell + offsets[k]] += flags;
+      engine->hidden_around[cell + offsets[k]] += hidden;
+    }
+    return;
+  }
+
+  for (int32_t i = -1; i <= 1; i++)
+  {
+    /* Limit detection */
+    if (y + i < 0 || y + i >= height)
+      continue;
+    for (int32_t j = -1; j <= 1; j++)
+    {
+      if (x + j < 0 || x + j >= width || (i == 0 && j == 0))
+        continue;
+
+      uint32_t index = (uint32_t)(y + i) * width + (x + j);
+      engine->flags_around[index] += flags;
+      engine->hidden_around[index] += hidden;
+    }
+  }
+}
+
+/* Puts a flag on a covered field or takes it off, without journaling it */
+static void _flag_cell(Engine *engine, uint16_t x, uint16_t y, bool flagged)
+{
+  Minefield *field = &engine->board[y][x];
+
+  field->is_flagged = flagged;
+  engine->flags += flagged ? 1 : -1;
+  engine->correct_flags += field->has_bomb ? (flagged ? 1 : -1) : 0;
+  /* A flagged field isn't hidden anymore as far as sweeping goes */
+  _update_around(engine, x, y, flagged ? 1 : -1, flagged ? -1 : 1);
+}
+
+static void _set_flag(Engine *engine, uint16_t x, uint16_t y, bool flagged)
+{
+  if (engine->board[y][x].is_flagged == flagged)
+    return;
+
+  _record(engine, flagged ? JOURNAL_FLAG : JOURNAL_UNFLAG, (uint32_t)y * engine->width + x);
+  _flag_cell(engine, x, y, flagged);
+}
+
+/*
+ * Shows a covered cell or covers it back, updating every counter but the state, without journaling it.
+ * `opening` is whether the cell is the one that opens (or closes) its opening.
+ */
+static void _show_cell(Engine *engine, uint16_t x, uint16_t y, bool shown, bool opening)
+{
+  uint32_t index = (uint32_t)y * engine->width + x;
+  Minefield *field = &engine->board[0][index];
+  int32_t step = shown ? 1 : -1;
+
+  field->is_mined = shown;
+  _update_around(engine, x, y, 0, -step);
+  if (field->has_bomb)
+    return;
+
+  engine->revealed += step;
+  /* One click less (or more), either a lonely number or the first 0 of an opening */
+  if (engine->labels[index] == METRICS_LABEL_LONELY || opening)
+    engine->remaining_3bv -= step;
+  if (opening)
+    engine->opened[engine->labels[index]] = shown;
+}
+
+/* Shows a single covered cell and updates every counter it affects */
+static void _reveal_cell(Engine *engine, uint32_t index)
+{
+  const uint16_t x = index % engine->width, y = index / engine->width;
+  Minefield *field = &engine->board[0][index];
+  uint32_t label = engine->labels[index];
+
+  /* Showing a field removes its flag (0s show their flagged neighbours too) */
+  if (field->is_flagged)
+    _set_flag(engine, x, y, false);
+
+  bool opening = !field->has_bomb && label != METRICS_LABEL_LONELY && label != METRICS_LABEL_NONE && !engine->opened[label];
+  _record(engine, opening ? JOURNAL_REVEAL_OPENING : JOURNAL_REVEAL, index);
+  _show_cell(engine, x, y, true, opening);
+
+  if (field->has_bomb)
+    engine->state = ENGINE_LOST;
+  _mark_changed(engine, x, y);
+}
+
+/*
+PARALLEL FLOOD
+*/
+
+/*
+ * A flood too big for a single thread goes on with the board cut in FLOOD_TILE x FLOOD_TILE tiles.
+ *
+ * Only the worker running a tile touches its cells, so the board needs no atomics: cells across
+ * the edge go to the inbox of the tile they're in (a bit per cell) and that tile gets queued.
+ * Every worker has a queue of tiles and steals from the others' once it runs out. The flood is
+ * over once no tile is queued or running, then the neighbour counts of the tiles it went through
+ * get recounted (in parallel too) and the journal, the changed cells and the counters are written
+ * down on the calling thread, same as the serial flood would've.
+ */
+#define FLOOD_TILE 64
+/* Slots of the shown cell list the workers reserve at a time */
+#define FLOOD_CHUNK 1024
+/* Slot left unused at the end of a reservation */
+#define FLOOD_EMPTY UINT32_MAX
+/* On a shown cell, it had a flag (the flood takes it off) */
+#define FLOOD_UNFLAGGED (1u << 31)
+
+typedef enum
+{
+  FLOOD_IDLE,
+  FLOOD_QUEUED,
+  FLOOD_RUNNING
+} FloodTileState;
+
+typedef struct
+{
+  atomic_uint sequence;
+  uint32_t tile;
+} FloodSlot;
+
+/* Bounded lock-free queue of tiles, anybody can push and pop (a tile is on one queue at most, so it never fills up) */
+typedef struct
+{
+  FloodSlot *slots;
+  uint32_t mask;
+  atomic_uint head;
+  atomic_uint tail;
+} FloodQueue;
+
+typedef struct
+{
+  EngineFlood *flood;
+  uint32_t id;
+  /* Reserved part of the shown cell list */
+  uint32_t shown_at;
+  uint32_t shown_end;
+  /* Flood stack inside a tile, a cell goes on it once at most */
+  uint32_t stack[FLOOD_TILE * FLOOD_TILE];
+  Thread thread;
+} FloodWorker;
+
+struct EngineFlood
+{
+  Engine *engine;
+  uint32_t tiles_x;
+  uint32_t tiles_y;
+  uint32_t threads;
+  /* Cells to show (and flood from if they're 0s), a word per tile row with a bit per column */
+  atomic_uint_fast64_t *inbox;
+  /* A FloodTileState per tile */
+  atomic_uchar *state;
+  /* Tiles that had cells shown, only written by the worker running the tile */
+  bool *touched;
+  FloodQueue queues[ENGINE_MAX_FLOOD_THREADS];
+  FloodWorker *workers;
+  /* Tiles queued or running, the flood is over once it gets to 0 */
+  atomic_uint pending;
+  /* Next tile to recount the neighbour counts of */
+  atomic_uint next_recount;
+  /* Cells the workers showed, with FLOOD_UNFLAGGED and FLOOD_EMPTY slots */
+  uint32_t *shown;
+  atomic_uint shown_count;
+};
+
+static void _queue_reset(FloodQueue *queue)
+{
+  for (uint32_t i = 0; i <= queue->mask; i++)
+    atomic_init(&queue->slots[i].sequence, i);
+  atomic_init(&queue->head, 0);
+  atomic_init(&queue->tail, 0);
+}
+
+static void _queue_push(FloodQueue *queue, uint32_t tile)
+{
+  uint32_t position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  FloodSlot *slot;
+
+  while (true)
+  {
+    slot = &queue->slots[position & queue->mask];
+    int32_t lag = (int32_t)(atomic_load_explicit(&slot->sequence, memory_order_acquire) - position);
+    if (lag == 0 && atomic_compare_exchange_weak_explicit(&queue->tail, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+      break;
+    if (lag != 0)
+      position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  }
+
+  slot->tile = tile;
+  atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+}
+
+static bool _queue_pop(FloodQueue *queue, uint32_t *tile)
+{
+  uint32_t position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  FloodSlot *slot;
+
+  while (true)
+  {
+    slot = &queue->slots[position & queue->mask];
+    int32_t lag = (int32_t)(atomic_load_explicit(&slot->sequence, memory_order_acquire) - (position + 1));
+    if (lag < 0)
+      return false;
+    if (lag == 0 && atomic_compare_exchange_weak_explicit(&queue->head, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+      break;
+    if (lag != 0)
+      position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  }
+
+  *tile = slot->tile;
+  atomic_store_explicit(&slot->sequence, position + queue->mask + 1, memory_order_release);
+  return true;
+}
+
+/* Queues the tile on the given queue if nobody has it (a running tile looks at its inbox again once it's done) */
+static void _flood_wake(EngineFlood *flood, uint32_t queue, uint32_t tile)
+{
+  unsigned char expected = FLOOD_IDLE;
+  if (!atomic_compare_exchange_strong(&flood->state[tile], &expected, FLOOD_QUEUED))
+    return;
+
+  atomic_fetch_add(&flood->pending, 1);
+  _queue_push(&flood->queues[queue], tile);
+}
+
+/* Hands a cell over to whoever runs its tile */
+static void _flood_send(EngineFlood *flood, uint32_t queue, uint16_t x, uint16_t y)
+{
+  const uint32_t tile = (y / FLOOD_TILE) * flood->tiles_x + x / FLOOD_TILE;
+  atomic_fetch_or(&flood->inbox[tile * FLOOD_TILE + y % FLOOD_TILE], (uint64_t)1 << (x % FLOOD_TILE));
+  _flood_wake(flood, queue, tile);
+}
+
+/* Shows a cell of the worker's tile, the bookkeeping waits until the flood is over */
+static void _flood_show(FloodWorker *worker, uint16_t x, uint16_t y)
+{
+  EngineFlood *flood = worker->flood;
+  Minefield *field = &flood->engine->board[y][x];
+
+  if (worker->shown_at == worker->shown_end)
+  {
+    worker->shown_at = atomic_fetch_add(&flood->shown_count, FLOOD_CHUNK);
+    worker->shown_end = worker->shown_at + FLOOD_CHUNK;
+  }
+  flood->shown[worker->shown_at++] = ((uint32_t)y * flood->engine->width + x) | (field->is_flagged ? FLOOD_UNFLAGGED : 0);
+
+  field->is_flagged = false;
+  field->is_mined = true;
+}
+
+static void _flood_tile(FloodWorker *worker, uint32_t tile)
+{
+  EngineFlood *flood = worker->flood;
+  Engine *engine = flood->engine;
+  const int32_t x0 = (tile % flood->tiles_x) * FLOOD_TILE, y0 = (tile / flood->tiles_x) * FLOOD_TILE;
+  const int32_t x1 = (x0 + FLOOD_TILE < engine->width) ? x0 + FLOOD_TILE : engine->width;
+  const int32_t y1 = (y0 + FLOOD_TILE < engine->height) ? y0 + FLOOD_TILE : engine->height;
+
+  atomic_store(&flood->state[tile], FLOOD_RUNNING);
+  flood->touched[tile] = true;
+
+  for (int32_t row = 0; row < y1 - y0; row++)
+  {
+    uint64_t bits = atomic_exchange(&flood->inbox[tile * FLOOD_TILE + row], 0);
+    for (; bits != 0; bits &= bits - 1)
+    {
+      const uint16_t x = x0 + __builtin_ctzll(bits), y = y0 + row;
+      if (engine->board[y][x].is_mined)
+        continue;
+
+      uint32_t top = 0;
+      _flood_show(worker, x, y);
+      if (engine->board[y][x].bomb_amount == 0)
+        worker->stack[top++] = (uint32_t)y * engine->width + x;
+
+      while (top > 0)
+      {
+        const uint32_t index = worker->stack[--top];
+        const int32_t cx = index % engine->width, cy = index / engine->width;
+
+        for (int32_t i = -1; i <= 1; i++)
+          for (int32_t j = -1; j <= 1; j++)
+          {
+            const int32_t nx = cx + j, ny = cy + i;
+            if (ny < 0 || ny >= engine->height || nx < 0 || nx >= engine->width)
+              continue;
+            if (nx < x0 || nx >= x1 || ny < y0 || ny >= y1)
+            {
+              _flood_send(flood, worker->id, nx, ny);
+              continue;
+            }
+
+            Minefield *neighbour = &engine->board[ny][nx];
+            if (neighbour->is_mined)
+              continue;
+            _flood_show(worker, nx, ny);
+            if (neighbour->bomb_amount == 0)
+              worker->stack[top++] = (uint32_t)ny * engine->width + nx;
+          }
+      }
+    }
+  }
+
+  /* Cells sent while it ran are found right here, or get the tile queued by whoever sent them */
+  atomic_store(&flood->state[tile], FLOOD_IDLE);
+  for (int32_t row = 0; row < y1 - y0; row++)
+    if (atomic_load(&flood->inbox[tile * FLOOD_TILE + row]) != 0)
+    {
+      _flood_wake(flood, worker->id, tile);
+      break;
+    }
+  atomic_fetch_sub(&flood->pending, 1);
+}
+
+/* Whether the tile or one around it had cells shown */
+static bool _flood_near_touched(const EngineFlood *flood, uint32_t tile)
+{
+  const int32_t tx = tile % flood->tiles_x, ty = tile / flood->tiles_x;
+  for (int32_t i = -1; i <= 1; i++)
+    for (int32_t j = -1; j <= 1; j++)
+      if (ty + i >= 0 && ty + i < (int32_t)flood->tiles_y && tx + j >= 0 && tx + j < (int32_t)flood->tiles_x &&
+          flood->touched[(ty + i) * flood->tiles_x + tx + j])
+        return true;
+  return false;
+}
+
+/* Counts the flags and hidden cells around every cell of the tile again */
+static void _flood_recount(Engine *engine, const EngineFlood *flood, uint32_t tile)
+{
+  const int32_t x0 = (tile % flood->tiles_x) * FLOOD_TILE, y0 = (tile / flood->tiles_x) * FLOOD_TILE;
+
+  for (int32_t y = y0; y < y0 + FLOOD_TILE && y < engine->height; y++)
+    for (int32_t x = x0; x < x0 + FLOOD_TILE && x < engine->width; x++)
+    {
+      uint8_t flags = 0, hidden = 0;
+      for (int32_t i = -1; i <= 1; i++)
+        for (int32_t j = -1; j <= 1; j++)
+        {
+          if (y + i < 0 || y + i >= engine->height || x + j < 0 || x + j >= engine->width || (i == 0 && j == 0))
+            continue;
+          const Minefield *field = &engine->board[y + i][x + j];
+          flags += field->is_flagged;
+          hidden += !field->is_flagged && !field->is_mined;
+        }
+
+      engine->flags_around[(uint32_t)y * engine->width + x] = flags;
+      engine->hidden_around[(uint32_t)y * engine->width + x] = hidden;
+    }
+}
+
+static void _flood_worker(void *arg)
+{
+  FloodWorker *worker = arg;
+  EngineFlood *flood = worker->flood;
+  uint32_t tile;
+
+  while (atomic_load(&flood->pending) > 0)
+  {
+    /* Its own queue first, then the others' */
+    bool found = _queue_pop(&flood->queues[worker->id], &tile);
+    for (uint32_t i = 1; !found && i < flood->threads; i++)
+      found = _queue_pop(&flood->queues[(worker->id + i) % flood->threads], &tile);
+
+    if (found)
+      _flood_tile(worker, tile);
+    else
+      thread_yield();
+  }
+
+  while (worker->shown_at < worker->shown_end)
+    flood->shown[worker->shown_at++] = FLOOD_EMPTY;
+
+  /* Every cell stopped changing once nothing was pending, the counts around them can be redone */
+  while ((tile = atomic_fetch_add(&flood->next_recount, 1)) < flood->tiles_x * flood->tiles_y)
+    if (_flood_near_touched(flood, tile))
+      _flood_recount(flood->engine, flood, tile);
+}
+
+static EngineFlood *_flood_alloc(Engine *engine, Arena *arena)
+{
+  const uint32_t total = (uint32_t)engine->width * engine->height;
+  EngineFlood *flood = arena_calloc(arena, 1, sizeof(EngineFlood));
+  if (flood == NULL)
+    return NULL;
+
+  flood->tiles_x = (engine->width + FLOOD_TILE - 1) / FLOOD_TILE;
+  flood->tiles_y = (engine->height + FLOOD_TILE - 1) / FLOOD_TILE;
+  const uint32_t tile_count = flood->tiles_x * flood->tiles_y;
+
+  uint32_t capacity = 1;
+  while (capacity < tile_count)
+    capacity *= 2;
+
+  flood->inbox = arena_calloc(arena, tile_count * FLOOD_TILE, sizeof(*flood->inbox));
+  flood->state = arena_calloc(arena, tile_count, sizeof(*flood->state));
+  flood->touched = arena_calloc(arena, tile_count, sizeof(bool));
+  flood->workers = arena_alloc(arena, sizeof(FloodWorker) * ENGINE_MAX_FLOOD_THREADS);
+  flood->shown = arena_alloc(arena, sizeof(uint32_t) * (total + ENGINE_MAX_FLOOD_THREADS * FLOOD_CHUNK));
+  if (flood->inbox == NULL || flood->state == NULL || flood->touched == NULL || flood->workers == NULL || flood->shown == NULL)
+    return NULL;
+
+  for (uint32_t i = 0; i < ENGINE_MAX_FLOOD_THREADS; i++)
+  {
+    flood->queues[i].mask = capacity - 1;
+    flood->queues[i].slots = arena_alloc(arena, sizeof(FloodSlot) * capacity);
+    if (flood->queues[i].slots == NULL)
+      return NULL;
+  }
+
+  for (uint32_t i = 0; i < tile_count; i++)
+    atomic_init(&flood->state[i], FLOOD_IDLE);
+  return flood;
+}
+
+/* Shows the rest of a flood on every flood thread, the 0s on the stack (the first `top` cells) still have to be flooded from */
+static void _flood_parallel(Engine *engine, uint32_t top)
+{
+  EngineFlood *flood = engine->flood;
+  const uint32_t tile_count = flood->tiles_x * flood->tiles_y;
+
+  flood->engine = engine;
+  flood->threads = engine->flood_threads;
+  for (uint32_t i = 0; i < flood->threads; i++)
+    _queue_reset(&flood->queues[i]);
+  for (uint32_t i = 0; i < tile_count; i++)
+    flood->touched[i] = false;
+  atomic_init(&flood->pending, 0);
+  atomic_init(&flood->next_recount, 0);
+  atomic_init(&flood->shown_count, 0);
+
+  /* The covered neighbours of those 0s are where it starts, spread over every queue */
+  for (uint32_t k = 0; k < top; k++)
+  {
+    const int32_t cx = engine->stack[k] % engine->width, cy = engine->stack[k] / engine->width;
+    for (int32_t i = -1; i <= 1; i++)
+      for (int32_t j = -1; j <= 1; j++)
+        if (cy + i >= 0 && cy + i < engine->height && cx + j >= 0 && cx + j < engine->width && !engine->board[cy + i][cx + j].is_mined)
+          _flood_send(flood, k % flood->threads, cx + j, cy + i);
+  }
+
+  /* This thread is worker 0, whoever doesn't get a thread has its queue emptied by the others */
+  uint32_t started = 1;
+  for (uint32_t i = 0; i < flood->threads; i++)
+  {
+    FloodWorker *worker = &flood->workers[i];
+    worker->flood = flood;
+    worker->id = i;
+    worker->shown_at = worker->shown_end = 0;
+    if (i > 0 && i == started && thread_start(&worker->thread, _flood_worker, worker))
+      started++;
+  }
+  _flood_worker(&flood->workers[0]);
+  for (uint32_t i = 1; i < started; i++)
+    thread_join(&flood->workers[i].thread);
+
+  /* Everything the serial flood does per cell, but the neighbour counts (already redone) */
+  const uint32_t shown_count = atomic_load(&flood->shown_count);
+  for (uint32_t k = 0; k < shown_count; k++)
+  {
+    if (flood->shown[k] == FLOOD_EMPTY)
+      continue;
+
+    const uint32_t index = flood->shown[k] & ~FLOOD_UNFLAGGED;
+    const uint32_t label = engine->labels[index];
+    const bool opening = label != METRICS_LABEL_LONELY && label != METRICS_LABEL_NONE && !engine->opened[label];
+
+    if (flood->shown[k] & FLOOD_UNFLAGGED)
+    {
+      _record(engine, JOURNAL_UNFLAG, index);
+      engine->flags--;
+    }
+    _record(engine, opening ? JOURNAL_REVEAL_OPENING : JOURNAL_REVEAL, index);
+
+    engine->revealed++;
+    if (label == METRICS_LABEL_LONELY || opening)
+      engine->remaining_3bv--;
+    if (opening)
+      engine->opened[label] = true;
+    _mark_changed(engine, index % engine->width, index / engine->width);
+  }
+}
+
+/**
+ * Mine function for a field. Shows or 'mines' a field
+ *
+ * If the current space's bomb amount is 0, it shows all the surrounding fields
+ * to create the 'island' effect on the original minesweeper. It used to be recursive,
+ * now every cell is revealed when it's pushed to the stack so it can never be pushed twice.
+ *
+ * The flood ignores flags while sweeping doesn't, think about this position:
+ * [ ][F][F]
+ * [ ][2][0]
+ * [ ][1][1]
+ *
+ * Since the expected behaviour when mining a 0 is to show ALL surrounding fields (they don't have bombs anyway)
+ * if we don't ignore the flags, we'll get a weird situation, where you have to un-flag the fields to actually
+ * reveal them, instead of the seamless way 0s normally work. Sweeping a number on the other hand must
+ * never show the flagged spaces (they're the ones the player says contain bombs).
+ *
+ * @param engine The engine
+ * @param x The x coordinate of the field
+ * @param y The y coordinate of the field
+ */
+static void _show_field(Engine *engine, uint16_t x, uint16_t y)
+{
+  const uint16_t width = engine->width, height = engine->height;
+  /* Rows are one after the other (see minefield_board_alloc), cells go by index */
+  Minefield *cells = engine->board[0];
+  const uint32_t start = (uint32_t)y * width + x;
+  if (cells[start].is_mined)
+    return;
+
+  uint32_t top = 0, shown = 1;
+  _reveal_cell(engine, start);
+  if (cells[start].bomb_amount == 0)
+    engine->stack[top++] = start;
+
+  while (top > 0)
+  {
+    /* A huge opening, the rest of it goes on every core */
+    if (shown >= ENGINE_PARALLEL_FLOOD && engine->flood != NULL && engine->flood_threads > 1)
+    {
+      _flood_parallel(engine, top);
+      return;
+    }
+
+    uint32_t index = engine->stack[--top];
+    uint16_t cx = index % width;
+    uint16_t cy = index / width;
+
+    /* Away from the edges every neighbour is there */
+    if (cx > 0 && cy > 0 && cx + 1 < width && cy + 1 < height)
+    {
+      const int32_t offsets[8] = {-width - 1, -width, -width + 1, -1, 1, width - 1, width, width + 1};
+      for (uint32_t k = 0; k < 8; k++)
+      {
+        const uint32_t neighbour = index + offsets[k];
+        if (cells[neighbour].is_mined)
+          continue;
+
+        _reveal_cell(engine, neighbour);
+        shown++;
+        if (cells[neighbour].bomb_amount == 0)
+          engine->stack[top++] = neighbour;
+      }
+      continue;
+    }
+
+    for (int32_t i = -1; i <= 1; i++)
+    {
+      /* Limit detection */
+      if (cy + i < 0 || cy + i >= height)
+        continue;
+      for (int32_t j = -1; j <= 1; j++)
+      {
+        /* Limit detection */
+        if (cx + j < 0 || cx + j >= width)
+          continue;
+
+        const uint32_t neighbour = (uint32_t)(cy + i) * width + (cx + j);
+        if (cells[neighbour].is_mined)
+          continue;
+
+        _reveal_cell(engine, neighbour);
+        shown++;
+        if (cells[neighbour].bomb_amount == 0)
+          engine->stack[top++] = neighbour;
+      }
+    }
+  }
+}
+
+/**
+ * For sweeping a field, a.k.a you already placed enough flags around it to just show the rest of
+ * spaces.
+ *
+ * Imagine a situation like this:
+ * [ ][ ][ ]
+ * [ ][1][F]
+ * [ ][ ][ ]
+ *
+ * You already know that the mine is on the 'F' square, but you now need to painstakingly reveal the
+ * rest of spaces one by one, with this function, these cases are detected and triggered when
+ * pressing enter (a.k.a mining) on an already shown SAFE space, this way, revealing every other square
+ * at once, which greatly improves the player's speed and experience.
+ *
+ * Note: You can also do what's known as 'false sweeping', when the amount of flags around the square
+ * corresponds to the bomb amount around the field, but the flags are simply wrong, in this case, the spot
+ * with the bomb will also be revealed and such losing you the game (the state turns to ENGINE_LOST).
+ * @param engine The engine
+ * @param x The x coordinate of the field
+ * @param y The y coordinate of the field
+ */
+static void _sweep_field(Engine *engine, uint16_t x, uint16_t y)
+{
+  /* The flags around are always counted, no need to look at the neighbours to know */
+  if (!engine_can_sweep(engine, x, y))
+    return;
+
+  for (int32_t i = -1; i <= 1; i++)
+  {
+    /* Limit detection */
+    if (y + i < 0 || y + i >= engine->height)
+      continue;
+    for (int32_t j = -1; j <= 1; j++)
+    {
+      /* Limit detection */
+      if (x + j < 0 || x + j >= engine->width)
+        continue;
+
+      /* ONLY surrounding fields, and not the flagged ones */
+      if ((i == 0 && j == 0) || engine->board[y + i][x + j].is_flagged)
+        continue;
+
+      _show_field(engine, x + j, y + i);
+    }
+  }
+}
+
+/* Flags every bomb left, like the original minesweeper does when you win */
+static void _flag_remaining_bombs(Engine *engine)
+{
+  for (uint16_t i = 0; i < engine->height; i++)
+    for (uint16_t j = 0; j < engine->width; j++)
+      if (engine->board[i][j].has_bomb && !engine->board[i][j].is_flagged)
+      {
+        _set_flag(engine, j, i, true);
+        _mark_changed(engine, j, i);
+      }
+}
+
+/* Win condition, every safe field is shown */
+static void _check_win(Engine *engine)
+{
+  if (engine->state == ENGINE_PLAYING && engine->revealed == (uint32_t)engine->width * engine->height - engine->bomb_amount)
+  {
+    engine->state = ENGINE_WON;
+    _flag_remaining_bombs(engine);
+  }
+}
+
+static void _debug_check(const Engine *engine)
+{
+#ifdef CSWEEPER_DEBUG
+  if (!engine_verify(engine))
+    abort();
+#else
+  (void)engine;
+#endif
+}
+
+bool engine_init(Engine *engine, Minefield **board, uint16_t width, uint16_t height, uint16_t bomb_amount, Arena *arena, Arena *journal_arena)
+{
+  const uint32_t total = (uint32_t)width * height;
+
+  engine->board = board;
+  engine->width = width;
+  engine->height = height;
+  engine->bomb_amount = bomb_amount;
+
+  engine->revealed = 0;
+  engine->flags = 0;
+  engine->correct_flags = 0;
+  engine->clicks = 0;
+  engine->state = ENGINE_PLAYING;
+  engine->changed_count = 0;
+
+  journal_init(&engine->journal, journal_arena);
+  engine->recording = false;
+  engine->action_recorded = false;
+
+  engine->labels = arena_alloc(arena, sizeof(uint32_t) * total);
+  engine->opened = arena_calloc(arena, total, sizeof(bool));
+  engine->stack = arena_alloc(arena, sizeof(uint32_t) * total);
+  engine->changed = arena_alloc(arena, sizeof(Vec2) * total);
+  engine->flags_around = arena_calloc(arena, total, sizeof(uint8_t));
+  engine->hidden_around = arena_calloc(arena, total, sizeof(uint8_t));
+  if (engine->labels == NULL || engine->opened == NULL || engine->stack == NULL || engine->changed == NULL ||
+      engine->flags_around == NULL || engine->hidden_around == NULL ||
+      !metrics_label_cells(board, width, height, engine->labels, arena))
+    return false;
+
+  engine->flood_threads = thread_cpu_count();
+  if (engine->flood_threads > ENGINE_MAX_FLOOD_THREADS)
+    engine->flood_threads = ENGINE_MAX_FLOOD_THREADS;
+  engine->flood = NULL;
+  if (total >= ENGINE_PARALLEL_CELLS && (engine->flood = _flood_alloc(engine, arena)) == NULL)
+    return false;
+
+  /* Nothing is shown or flagged yet, every neighbour is hidden */
+  for (uint16_t i = 0; i < height; i++)
+    for (uint16_t j = 0; j < width; j++)
+      _update_around(engine, j, i, 0, 1);
+
+  /* Every opening and every lonely number is a click left */
+  engine->remaining_3bv = 0;
+  for (uint32_t index = 0; index < total; index++)
+    engine->remaining_3bv += engine->labels[index] == METRICS_LABEL_LONELY || engine->labels[index] == index;
+
+  return true;
+}
+
+void engine_click(Engine *engine, uint16_t x, uint16_t y)
+{
+  if (engine->state != ENGINE_PLAYING)
+    return;
+
+  const uint64_t started_at = profile_start();
+  _begin_action(engine);
+  Minefield *field = &engine->board[y][x];
+
+  /* Depending of the state of the mine, we do certain actions */
+  if (field->has_bomb)
+    engine->state = ENGINE_LOST;
+  else if (field->is_mined)
+    _sweep_field(engine, x, y);
+  else if (!field->is_flagged)
+    _show_field(engine, x, y);
+
+  _check_win(engine);
+  _end_action(engine);
+
+  profile_stop(PROFILE_REVEAL, started_at);
+  _debug_check(engine);
+}
+
+bool engine_can_sweep(const Engine *engine, uint16_t x, uint16_t y)
+{
+  const Minefield *field = &engine->board[y][x];
+  const uint32_t index = (uint32_t)y * engine->width + x;
+
+  return field->is_mined && !field->has_bomb && field->bomb_amount > 0 &&
+         engine->flags_around[index] == field->bomb_amount && engine->hidden_around[index] > 0;
+}
+
+/* Cells engine_sweep_all checks at once, a uint64_t of counts */
+#define SWEEP_BLOCK 8
+#define SWEEP_HIGH_BITS 0x8080808080808080ull
+
+/* The high bit of every byte of `bytes` that isn't 0 */
+static inline uint64_t _nonzero_bytes(uint64_t bytes)
+{
+  const uint64_t low = 0x7f7f7f7f7f7f7f7full;
+  return (((bytes & low) + low) | bytes) & SWEEP_HIGH_BITS;
+}
+
+uint32_t engine_sweep_all(Engine *engine)
+{
+  if (engine->state != ENGINE_PLAYING)
+    return 0;
+
+  const uint64_t started_at = profile_start();
+  _begin_action(engine);
+  const uint32_t total = (uint32_t)engine->width * engine->height;
+  uint32_t swept = 0;
+
+  /*
+   * Only cells with flags and covered cells around them can be swept, and both counts are flat
+   * byte arrays: 8 cells get checked at once and the rest of engine_can_sweep only runs for those.
+   * Sweeping never adds flags or covered cells, so a block's candidates can only go away while
+   * it's being swept, and engine_can_sweep still has the last word on each of them.
+   */
+  for (uint32_t block = 0; block < total && engine->state == ENGINE_PLAYING; block += SWEEP_BLOCK)
+  {
+    uint64_t candidates;
+    if (total - block >= SWEEP_BLOCK)
+    {
+      uint64_t flags, hidden;
+      memcpy(&flags, &engine->flags_around[block], sizeof(flags));
+      memcpy(&hidden, &engine->hidden_around[block], sizeof(hidden));
+      candidates = _nonzero_bytes(flags) & _nonzero_bytes(hidden);
+    }
+    else
+      candidates = SWEEP_HIGH_BITS;
+
+    for (; candidates != 0 && engine->state == ENGINE_PLAYING; candidates &= candidates - 1)
+    {
+      const uint32_t index = block + (uint32_t)__builtin_ctzll(candidates) / 8;
+      const uint16_t x = index % engine->width, y = index / engine->width;
+      if (index < total && engine_can_sweep(engine, x, y))
+      {
+        _sweep_field(engine, x, y);
+        swept++;
+      }
+    }
+  }
+
+  _check_win(engine);
+  _end_action(engine);
+
+  profile_stop(PROFILE_REVEAL, started_at);
+  _debug_check(engine);
+  return swept;
+}
+
+void engine_flag(Engine *engine, uint16_t x, uint16_t y)
+{
+  Minefield *field = &engine->board[y][x];
+
+  /* Only if it hasn't been shown yet */
+  if (engine->state != ENGINE_PLAYING || field->is_mined)
+    return;
+
+  _begin_action(engine);
+  _set_flag(engine, x, y, !field->is_flagged);
+  _end_action(engine);
+
+  _mark_changed(engine, x, y);
+  _debug_check(engine);
+}
+
+bool engine_undo(Engine *engine)
+{
+  uint32_t entry;
+  while (journal_back(&engine->journal, &entry))
+  {
+    const uint32_t payload = entry & JOURNAL_PAYLOAD_MASK;
+    const uint16_t x = payload % engine->width;
+    const uint16_t y = payload / engine->width;
+
+    switch (entry >> JOURNAL_KIND_SHIFT)
+    {
+    case JOURNAL_ACTION:
+      engine->state = payload;
+      _debug_check(engine);
+      return true;
+
+    case JOURNAL_FLAG:
+      _flag_cell(engine, x, y, false);
+      break;
+
+    case JOURNAL_UNFLAG:
+      _flag_cell(engine, x, y, true);
+      break;
+
+    case JOURNAL_REVEAL:
+    case JOURNAL_REVEAL_OPENING:
+      _show_cell(engine, x, y, false, entry >> JOURNAL_KIND_SHIFT == JOURNAL_REVEAL_OPENING);
+      break;
+
+    default:
+      /* The state comes back with the JOURNAL_ACTION entry */
+      continue;
+    }
+    _mark_changed(engine, x, y);
+  }
+
+  return false;
+}
+
+bool engine_redo(Engine *engine)
+{
+  uint32_t entry;
+
+  /* Every action starts with its JOURNAL_ACTION entry and ends right before the next one */
+  if (!journal_forward(&engine->journal, &entry))
+    return false;
+
+  while (journal_peek(&engine->journal, &entry) && entry >> JOURNAL_KIND_SHIFT != JOURNAL_ACTION)
+  {
+    journal_forward(&engine->journal, &entry);
+
+    const uint32_t payload = entry & JOURNAL_PAYLOAD_MASK;
+    const uint16_t x = payload % engine->width;
+    const uint16_t y = payload / engine->width;
+
+    switch (entry >> JOURNAL_KIND_SHIFT)
+    {
+    case JOURNAL_FLAG:
+      _flag_cell(engine, x, y, true);
+      break;
+
+    case JOURNAL_UNFLAG:
+      _flag_cell(engine, x, y, false);
+      break;
+
+    case JOURNAL_REVEAL:
+    case JOURNAL_REVEAL_OPENING:
+      _show_cell(engine, x, y, true, entry >> JOURNAL_KIND_SHIFT == JOURNAL_REVEAL_OPENING);
+      break;
+
+    default:
+      engine->state = payload;
+      continue;
+    }
+    _mark_changed(engine, x, y);
+  }
+
+  _debug_check(engine);
+  return true;
+}
+
+void engine_clear_changes(Engine *engine)
+{
+  engine->changed_count = 0;
+}
+
+bool engine_verify(const Engine *engine)
+{
+  const uint32_t total = (uint32_t)engine->width * engine->height;
+  uint32_t revealed = 0, flags = 0, correct_flags = 0, remaining_3bv = 0;
+
+  bool *opened = calloc(total, sizeof(bool));
+  if (opened == NULL)
+    return true; /* Can't check, don't blame the engine for it */
+
+  for (uint16_t i = 0; i < engine->height; i++)
+    for (uint16_t j = 0; j < engine->width; j++)
+    {
+      const Minefield *field = &engine->board[i][j];
+      uint32_t label = engine->labels[i * engine->width + j];
+
+      revealed += field->is_mined && !field->has_bomb;
+      flags += field->is_flagged;
+      correct_flags += field->is_flagged && field->has_bomb;
+
+      if (label == METRICS_LABEL_LONELY)
+        remaining_3bv += !field->is_mined;
+      else if (label != METRICS_LABEL_NONE && field->is_mined)
+        opened[label] = true;
+    }
+
+  for (uint32_t index = 0; index < total; index++)
+    remaining_3bv += engine->labels[index] == index && !opened[index];
+  free(opened);
+
+  bool ok = revealed == engine->revealed && flags == engine->flags &&
+            correct_flags == engine->correct_flags && remaining_3bv == engine->remaining_3bv;
+  if (!ok)
+    fprintf(stderr, "engine mismatch: revealed %u/%u, flags %u/%u, correct flags %u/%u, 3BV left %u/%u\n",
+            engine->revealed, revealed, engine->flags, flags, engine->correct_flags, correct_flags,
+            engine->remaining_3bv, remaining_3bv);
+
+  /* Neighbour counts, recounted the slow way */
+  for (int32_t i = 0; i < engine->height; i++)
+    for (int32_t j = 0; j < engine->width; j++)
+    {
+      uint8_t flags_around = 0, hidden_around = 0;
+      for (int32_t y = i - 1; y <= i + 1; y++)
+        for (int32_t x = j - 1; x <= j + 1; x++)
+        {
+          if (y < 0 || y >= engine->height || x < 0 || x >= engine->width || (y == i && x == j))
+            continue;
+          flags_around += engine->board[y][x].is_flagged;
+          hidden_around += !engine->board[y][x].is_flagged && !engine->board[y][x].is_mined;
+        }
+
+      uint32_t index = (uint32_t)i * engine->width + j;
+      if (flags_around != engine->flags_around[index] || hidden_around != engine->hidden_around[index])
+      {
+        fprintf(stderr, "engine mismatch at (%d, %d): flags around %u/%u, hidden around %u/%u\n", j, i,
+                engine->flags_around[index], flags_around, engine->hidden_around[index], hidden_around);
+        ok = false;
+      }
+    }
+  return ok;
+}
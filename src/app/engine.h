@@ -0,0 +1,135 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../classes/arena.h"
+#include "../classes/journal.h"
+#include "../classes/minefield.h"
+#include "../classes/vec.h"
+
+/* Boards with at least this many cells can flood in parallel (see EngineFlood in engine.c) */
+#define ENGINE_PARALLEL_CELLS (1 << 18)
+/* A flood goes parallel once it showed this many cells on its own */
+#define ENGINE_PARALLEL_FLOOD (1 << 14)
+#define ENGINE_MAX_FLOOD_THREADS 32
+
+typedef struct EngineFlood EngineFlood;
+
+typedef enum
+{
+  ENGINE_PLAYING,
+  ENGINE_WON,
+  ENGINE_LOST
+} EngineState;
+
+/*
+ * The game rules, without any drawing.
+ *
+ * Every counter is updated as cells change, so no action ever needs to look
+ * at the whole board. Building with -DCSWEEPER_DEBUG (make build DEBUG=1) cross-checks
+ * all of them against a full scan after every action.
+ */
+typedef struct
+{
+  /* The board isn't owned by the engine, whoever allocated it frees it */
+  Minefield **board;
+  uint16_t width;
+  uint16_t height;
+  uint16_t bomb_amount;
+
+  /* Safe cells revealed, the game is won when this reaches width * height - bomb_amount */
+  uint32_t revealed;
+  /* Flags on the board, and how many of them are on a bomb */
+  uint32_t flags;
+  uint32_t correct_flags;
+  /* Clicks still needed to clear the board (see metrics.h) */
+  uint32_t remaining_3bv;
+  /* Clicks, flags and sweeps the player made while the game was on, undone ones included */
+  uint32_t clicks;
+  EngineState state;
+
+  /* Opening of every cell or a METRICS_LABEL value, and which openings were opened already */
+  uint32_t *labels;
+  bool *opened;
+  /* Flood reveal stack */
+  uint32_t *stack;
+  /*
+   * Big boards only (NULL otherwise): a huge opening is shown tile by tile on `flood_threads` threads
+   * instead (every CPU by default, 1 keeps every flood on the calling thread)
+   */
+  EngineFlood *flood;
+  uint32_t flood_threads;
+
+  /*
+   * Flags around every cell, and covered cells around it that aren't flagged (the ones a sweep
+   * would show), kept up to date on every flag and reveal so checking a sweep never scans neighbours
+   */
+  uint8_t *flags_around;
+  uint8_t *hidden_around;
+
+  /* Cells changed by the actions since the last engine_clear_changes, for redrawing */
+  Vec2 *changed;
+  uint32_t changed_count;
+
+  /*
+   * Every cell each action changed (a whole flood reveal included), so undoing
+   * and redoing only costs as much as the action did
+   */
+  Journal journal;
+  /* An action is being journaled, whether it changed anything yet, and the state before it */
+  bool recording;
+  bool action_recorded;
+  EngineState action_state;
+} Engine;
+
+/**
+ * engine_init
+ * Sets an engine up on an already generated board (nothing revealed or flagged yet),
+ * its memory comes from the arena and goes away with it
+ * @param journal_arena Where the undo journal grows, it takes more memory the longer the game goes on
+ * @return false if memory couldn't be allocated
+ */
+bool engine_init(Engine *engine, Minefield **board, uint16_t width, uint16_t height, uint16_t bomb_amount, Arena *arena, Arena *journal_arena);
+
+/**
+ * engine_click
+ * What pressing enter on (x, y) does: shows a covered field, sweeps an already shown one
+ * (see _sweep_field in game.c) and loses the game if (x, y) has a bomb.
+ */
+void engine_click(Engine *engine, uint16_t x, uint16_t y);
+
+/* Toggles the flag on (x, y), if it hasn't been shown yet */
+void engine_flag(Engine *engine, uint16_t x, uint16_t y);
+
+/* Whether clicking (x, y) would sweep something: a shown number with as many flags around as its bomb amount */
+bool engine_can_sweep(const Engine *engine, uint16_t x, uint16_t y);
+
+/**
+ * engine_sweep_all
+ * Sweeps every number that can be swept (see engine_can_sweep) in a single pass over the board, in
+ * row order. Numbers this pass shows further on get swept by it too if they can be, the ones it shows
+ * on cells it already went past are left for the next pass.
+ * @return How many numbers were swept
+ */
+uint32_t engine_sweep_all(Engine *engine);
+
+/**
+ * engine_undo
+ * Takes back the last click, flag or sweep (the end of the game included, the state goes back too),
+ * the cells it changed are marked as changed again. Actions that changed nothing don't count.
+ * @return false if there's nothing to undo
+ */
+bool engine_undo(Engine *engine);
+
+/* Does the last undone action again, returns false if there's nothing to redo (any new action drops what was undone) */
+bool engine_redo(Engine *engine);
+
+/* Forget about the changed cells (call it after redrawing them) */
+void engine_clear_changes(Engine *engine);
+
+/* Recounts everything from scratch, returns false (and prints what's wrong) on a mismatch */
+bool engine_verify(const Engine *engine);
+
+#endif /* ENGINE_H */
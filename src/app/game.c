@@ -1,23 +1,35 @@
 /**
  * game.c
- * Implementation of the Minesweeper game logic and rendering.
+ * Implementation of the Minesweeper game flow and rendering.
  *
- * This file contains the core logic for the Minesweeper game, including game initialization,
+ * This file contains the game flow for the Minesweeper game, including game initialization,
  * rendering, user input handling, and game state management. It provides functions to start
  * a custom or templated game, manage the game loop, handle user interactions, and render
- * the game board and GUI.
+ * the game board and GUI. The rules themselves live in engine.c.
+ *
+ * Every function works on a Game struct, so the same code runs the local game and
+ * every session of the server (see server.c).
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
-#include <stdlib.h>
 #include <string.h>
 
 #include "game.h"
+#include "animation.h"
+#include "coop.h"
+#include "engine.h"
+#include "generator.h"
+#include "metrics.h"
+#include "sampler.h"
 #include "../classes/minefield.h"
 #include "../classes/vec.h"
 #include "../utils/consoleutils.h"
+#include "../utils/frame.h"
 #include "../utils/input.h"
+#include "../utils/profile.h"
+#include "../utils/render.h"
+#include "../utils/timer.h"
 
 /*
  * Little macro to clamp a value between 2 limits
@@ -29,6 +41,26 @@
  */
 #define repeat(x) for (int32_t _rrxvalno_ = 0; _rrxvalno_ < x; _rrxvalno_++)
 
+/* The on-screen timer stops here */
+#define MAX_SECONDS 9999
+
+/*
+ * The GUI goes right below the part of the board that fits on screen (see game_resize),
+ * 2 rows for the GUI, 2 for the win/lose message and 1 for the performance overlay
+ */
+#define GUI_ROW(game) ((game)->frame.view_height + 1)
+#define GUI_WIDTH(game) ((game)->frame.view_width * 3)
+#define GUI_HEIGHT 5
+
+/* Cells taken off a shared board's change feed at a time */
+#define COOP_SYNC_CELLS 256
+
+/* Characters the performance overlay takes (shorter text is padded to erase the old one) */
+#define OVERLAY_WIDTH 56
+
+/* How often the bomb odds overlay shows the sampler's progress */
+#define ODDS_REFRESH_MS 100
+
 /* For text drawing purposes */
 typedef enum
 {
@@ -41,150 +73,149 @@ typedef enum
 static uint8_t mine_colors[] = {
     CC_LIGHT_GRAY, CC_BLUE, CC_GREEN, CC_RED, CC_CYAN, CC_YELLOW, CC_MAGENTA, CC_LIGHT_GRAY, CC_DARK_GRAY};
 
+/* Shorthand for the keyframes below */
+#define LOOK(glyph, fg, bg) {glyph, fg, bg, fg, bg}
+
+/* Every bomb turns red for 4 seconds */
+static const Keyframe game_over_keyframes[] = {
+    {LOOK('X', CC_WHITE, CC_RED), 4000},
+};
+
+/* Every bomb blinks blue and yellow 10 times, the last one stays for 2 more seconds */
+static const Keyframe win_keyframes[] = {
+    {LOOK('!', CC_BLUE, CC_YELLOW), 500},
+    {LOOK('!', CC_YELLOW, CC_BLUE), 500},
+    {LOOK('!', CC_BLUE, CC_YELLOW), 500},
+    {LOOK('!', CC_YELLOW, CC_BLUE), 500},
+    {LOOK('!', CC_BLUE, CC_YELLOW), 500},
+    {LOOK('!', CC_YELLOW, CC_BLUE), 500},
+    {LOOK('!', CC_BLUE, CC_YELLOW), 500},
+    {LOOK('!', CC_YELLOW, CC_BLUE), 500},
+    {LOOK('!', CC_BLUE, CC_YELLOW), 500},
+    {LOOK('!', CC_YELLOW, CC_BLUE), 2500},
+};
+
 /*
  * Ok, so let's actually explain everything going on here
  * start_game() is the final function that uses the attributes set by the header's functions
  * start_template_game() and start_custom_game()
- * this function does NOT set the current_template, width, height and bomb_amount attributes
  *
- * What this function is responsible of is allocating the game board (with _allocate_board),
- * call the generate_bombs and generate_blessing functions to ready up everything and finally
- * entering game_loop
+ * What this function is responsible of is readying up the game (with game_init, which
+ * allocates the board and calls the generator, see generator.h) and finally entering game_loop
  *
- * When game_loop stops, this function is the responsible of deallocating the board.
+ * When game_loop stops, this function is the responsible of writing the result down
+ * (see stats.h) and deallocating the game.
  */
-static void start_game();
+static void start_game(const Template *templ, uint16_t width, uint16_t height, uint16_t bomb_amount, StatsStore *stats);
 
 /*
- * game_loop() contains all the game logic that runs consistently: inputs, cursor movement
+ * game_loop() sleeps until either a key arrives or the next deadline on its scheduler
+ * (see timer.h) passes, it never polls. Keys go to game_handle_key,
+ * which contains all the game logic that runs consistently: inputs, cursor movement
  * and calls the appropriate functions to actually run the game, also uses the _draw functions
  * to update whatever's going on in the board.
  *
  * It is basically the responsible of handling everything after the game has started,
- * when do_game_loop is set to false, the game loop breaks and the board is deallocated through start_game
+ * when game->running is set to false, the game loop breaks and the game is deallocated through start_game
  */
-static void game_loop();
+static void game_loop(Game *game);
 
 /*
- * Both of these functions are really similar, just hardcoded win and lose animations here
- * EVERYTHING is in these functions, so if you want to edit the length of the wait after winning/losing
- * the colors, the messages, these functions are your friends, they themselves set do_game_loop to false.
- * They're usually called from game_loop() and so you can just check the code in there to see how they're called.
- *
- * One last thing, _game_over_animation can ALSO be triggered through _mine_field, which is something I didn't necessarily
- * want to do, but when you trigger a false sweep (the flag amount a free space is accurate to the mine count but their positions aren't)
- * _game_over_animation is also called, you can go check in _mine_field. In any other case, it's impossible to trigger it from there
- * since do_game_loop doesn't call _mine_field when you try to show a field with a mine on it.
- */
-static void _game_over_animation();
-static void _win_animation();
-
-/**
- * For sweeping a field, a.k.a you already placed enough flags around it to just show the rest of
- * spaces.
- *
- * Imagine a situation like this:
- * [ ][ ][ ]
- * [ ][1][F]
- * [ ][ ][ ]
+ * Both of these functions are really similar, they draw the win and lose messages and start the animations,
+ * if you want to edit the length of the wait after winning/losing or the colors, go to the keyframes
+ * at the top of the file, the messages are in these functions.
  *
- * You already know that the mine is on the 'F' square, but you now need to painstakingly reveal the
- * rest of spaces one by one, with this function, these cases are detected and triggered when
- * pressing enter (a.k.a mining) on an already shown SAFE space, this way, revealing every other square
- * at once, which greatly improves the player's speed and experience.
+ * Both of them are triggered by game_handle_key when the engine's state changes to ENGINE_LOST or ENGINE_WON,
+ * which includes a false sweep (the flag amount around a free space is accurate to the mine count but their positions aren't)
  *
- * Note: You can also do what's known as 'false sweeping', when the case previously known is TRUE,
- * meaning that the amount of flags around the square corresponds to the bomb amount around the field,
- * but that guess simply being wrong, in this case, the spot with the bomb will also be revealed and such
- * losing you the game, this will trigger a _game_over_animation as said in that functions's section.
- * @param x The x coordinate of the field
- * @param y The y coordinate of the field
+ * Nothing sleeps, the animation is advanced by game_tick and game->running turns false when it ends
+ * (or right away if a key is pressed to skip it).
  */
-static void _sweep_field(uint16_t x, uint16_t y);
+static void _game_over_animation(Game *game);
+static void _win_animation(Game *game);
 
-/**
- * Mine function for a field. Pretty simple. Shows or 'mines' a field
- *
- * Contains a fail safe to not act on already-shown spaces, thus preventing
- * an infinite recursion bug paired with _show_surrounding_fields.
- *
- * If the current space's bomb amount is 0, it will recursively use _show_surrounding_fields
- * to create the 'island' effect on the original minesweeper.
- * @param x The x coordinate of the field
- * @param y The y coordinate of the field
+/*
+ * Draws the cells an action (or its undo) changed, and starts the win/lose animation if the game just ended
+ * or gets the timer going again if the end of the game was taken back. `before` is the state before the action.
  */
-static void _show_field(uint16_t x, uint16_t y);
+static void _after_action(Game *game, EngineState before);
 
-/**
- * Shows all surrounding fields around the field on (x, y), pretty simple too.
- *
- * The 'bypass_flags' argument exists due to weird interactions when working with both sweeping and showing:
- *
- * Let's think about this position:
- *
- * [F][F][ ]
- * [2][2][1]
- * [0][1][ ]
- *
- * When sweeping the center 2, the top-right and bottom-right spaces need to be shown,
- * the ones without flags, but the already flagged spaces (which contain bombs) must not be shown.
- * This means that we don't ignore the flags, then: bypass_flags = false.
- *
- * But why don't we just not show flagged fields at all then?? Well, let's think:
- * [ ][F][F]
- * [ ][2][ ]
- * [ ][1][1]
- *
- * This is just a silly position where the user placed two flags randomly around the 2, but
- * let's imagine that the middle-right square is actually a 0:
- * [ ][F][F]
- * [ ][2][0]
- * [ ][1][1]
- *
- * Since the expected behaviour when mining a 0 is to show ALL surrounding fields (they don't have bombs anyway)
- * if we don't ignore the flags, we'll get a weird situation, where you have to un-flag the fields to actually
- * reveal them, instead of the seamless way 0s normally work, so, in this case, we actually WANT to ignore
- * the flags, threfore bypass_flags = true.
- *
- * @param x The x coordinate of the center field
- * @param y The y coordinate of the center field
- * @param bypass_flags Whether to show flagged fields anyway
+/* Takes back the last action, or does the last undone one again */
+static void _undo_redo(Game *game, bool undo);
+
+/* Everything game_init and game_init_coop do once the board is there: engine, frame, cursor and timer */
+static bool _game_setup(Game *game, const GeneratorResult *generated);
+
+/*
+ * Copies what changed on the shared board (by any player) into the game's board and draws it,
+ * then does what _after_action does if the game just ended. Returns false if nothing changed.
  */
-static void _show_surrounding_fields(uint16_t x, uint16_t y, bool bypass_flags);
+static bool _coop_sync(Game *game);
+
+/* Starts the animation on every bomb of the board */
+static void _animate_bombs(Game *game, const Keyframe *keyframes, uint32_t keyframe_count);
 
 /**
- * Draws the cell at the (x, y) position on the board, used to draw the whole board and to update
- * fields when stuff happens to them (being shown, cursor hovering over them)
+ * Draws the cell at the (x, y) position on the board (on the frame, see frame.h), used to draw the
+ * whole board and to update fields when stuff happens to them (being shown, cursor hovering over them)
  *
  * Highlight is a color you can use to simulate the cursor or simply any highlight you want,
  * it will ONLY affect the brackets '[ ]' and by default will be set to the background, while
  * the text itself will always be white
  *
  * also, this method is NOT used to draw the game over and winning animations,
- * due to them requiring to paint the whole cell in a different way, they do it
- * differently.
- *
- * Final note: The reason why you also need to pass the board pointer is a weird artifact
- * dating to the first time I implemented this. Since I did it so without using any static variables
- * I had to pass EVERYTHING EVERYTIME, thankfully I eventually decided to just have the necessary game info
- * available to all functions but this fucker still remains, alongside other functions
+ * due to them requiring to paint the whole cell in a different way, they have keyframes.
  *
- * @param board The game board
+ * @param game The game
  * @param x The x coordinate of the cell
  * @param y The y coordinate of the cell
  * @param highlight Highlight color (0 for none)
  */
-static void _draw_cell(Minefield **board, uint16_t x, uint16_t y, uint8_t highlight);
+static void _draw_cell(Game *game, uint16_t x, uint16_t y, uint8_t highlight);
+
+/*
+ * Draws every cell the engine changed since the last call and clears the list
+ */
+static void _draw_changes(Game *game);
 
 /*
- * Draws the board using the variables defined in Game Info
+ * Draws the whole board
  */
-static void _draw_board();
+static void _draw_board(Game *game);
+
+/*
+ * Puts every cell that changed on the frame on screen and
+ * leaves the console cursor below everything, returns how many cells were drawn
+ */
+static uint32_t _present(Game *game);
 
 /*
  * Draws the game GUI, the part below the board hehehhehehehehheheh
  */
-static void _draw_game_gui();
+static void _draw_game_gui(Game *game);
+
+/*
+ * Draws the win/lose message below the GUI (nothing while the game is being played)
+ */
+static void _draw_result(Game *game);
+
+/*
+ * Draws the performance overlay under everything (the last frame's time, the p99 of
+ * the recent ones, the bytes the last frame took and about how many writes), or erases it
+ */
+static void _draw_overlay(Game *game, bool shown);
+
+/*
+ * Draws the chance of the cell under the cursor having a bomb on the overlay's row
+ * (see sampler.h), how far off it could be, and how many layouts it took
+ */
+static void _draw_odds(Game *game, const Sampler *sampler);
+
+/*
+ * Moves the view (see frame.h) just enough for the cursor to be on screen,
+ * the cells are redrawn by the next _present
+ */
+static void _scroll_to_cursor(Game *game);
 
 /**
  * Text drawing utility,
@@ -202,669 +233,974 @@ static void _draw_game_gui();
  */
 static void _draw_text(const char *text, uint16_t x, uint16_t y, TextAlign alignment);
 
-/**
- * Creates a dynamically allocated 2D array of the Minefield type,
- * returns NULL if allocation was unsuccesful, this is used and checked in
- * start_game which also sets it to the 'game_board' variable.
- *
- * This function only CREATES the array, it doesn't set it to anything by default
- * this behaviour is done in start_game
- *
- * @param width The width of the board
- * @param height The height of the board
- * @return Pointer to the allocated board, or NULL on failure
- */
-static Minefield **_allocate_board(uint16_t width, uint16_t height);
-
-/**
- * Sets up bomb amounts and bombs in the given board 2D pointer
- *
- * Basically just generates an array with field IDs and then shuffles it,
- * the first `bomb_amount` fields on the array will be the elected bombs,
- * then you just turn up the bomb_amount on all their neighbours.
- *
- * @param board The game board
- * @param width The width of the board
- * @param height The height of the board
- * @param bomb_amount The number of bombs to place
- */
-static void _generate_bombs(Minefield **board, uint16_t width, uint16_t height, uint16_t bomb_amount);
-/*
- * Fills the noguess_blessing variable, you can read its documentation
- * for better info about what's going on.
- */
-static void _generate_blessing();
-
-/* All Game info */
-
-/* Dynamically allocated game board 2D array */
-static Minefield **game_board = NULL;
-/* Current template pointer (set by start_template_game), ALWAYS check if NULL */
-static Template *current_template = NULL;
-/* Game dimensions */
-static uint16_t game_width = 0;
-static uint16_t game_height = 0;
-static uint16_t game_bomb_amount = 0;
-/* Cursor position used in _game_loop and a lot other functions */
-static Vec2 cursor_position;
-/* Starting time for the game, useful for calculating seconds_passed */
-static time_t start_timestamp = 0;
-/* Time you see on-screen when playing */
-static uint16_t seconds_passed = 0;
-/*
- * Var set in _show_field useful to detect the win condition
- * (correct_guesses == game_width * game_height - bomb_amount)
- * which means that every single field that wasn't a bomb was discovered
- *
- * This exact code sample exists in _game_loop
- */
-static uint16_t correct_guesses = 0;
-/* Control variable useful to the _draw_gui function */
-static uint16_t flags_placed = 0;
-/*
- * Although the game is not TRULY a no guessing mode
- * (erradicating the 50/50s and guesses in general would require for me to build a solver)
- * the No Guess Blessing is a vector that contains one randomly chosen 0 space.
- *
- * This way, you can get a guaranteed* island at the start of the game.
- * Your cursor will also be placed automatically on the blessing at the beginning of the game.
- *
- * asterisk: The blessing is not guaranteed, if there are no 0 spaces when first building the board
- * the blessing will stay at -1, -1 and nothing will be highlighted at the start.
- *
- * The cursor will be placed at 0, 0 if this does happen.
- */
-static Vec2 noguess_blessing = {.x = -1, .y = -1};
-/* Variable to control the game flow (turn false to stop the game) */
-static bool do_game_loop = true;
-
 /* EXCESSIVE COMMENTING ENDS NOW! most of the code should be really clear */
 
 /* Separate functions to prevent redundant arguments */
 
 /* Start a custom game (no templates) */
-void start_custom_game(uint16_t width, uint16_t height, uint16_t bomb_amount)
+void start_custom_game(uint16_t width, uint16_t height, uint16_t bomb_amount, StatsStore *stats)
 {
-  /* Set the game variables */
-  game_width = width;
-  game_height = height;
-  game_bomb_amount = bomb_amount;
-  /* Set no template */
-  current_template = NULL;
-
-  start_game();
+  start_game(NULL, width, height, bomb_amount, stats);
 }
 
 /* Start a templated game */
-void start_template_game(Template *templ)
+void start_template_game(Template *templ, StatsStore *stats)
 {
-  /* Set the game variables */
-  game_width = templ->width;
-  game_height = templ->height;
-  game_bomb_amount = templ->bomb_amount;
-  /* Set the template (for drawing purposes) */
-  current_template = templ;
-
-  start_game();
+  start_game(templ, templ->width, templ->height, templ->bomb_amount, stats);
 }
 
-/* Start a game with the set game variables */
-static void start_game()
+/* Start a local game */
+static void start_game(const Template *templ, uint16_t width, uint16_t height, uint16_t bomb_amount, StatsStore *stats)
 {
   clear_screen();
   console_color_reset();
 
   /* Introduce randomness */
-  srand(time(0));
+  uint64_t seed = (uint64_t)time(0) ^ ((uint64_t)clock() << 32);
 
-  /* Let's create the board */
-  game_board = _allocate_board(game_width, game_height);
-  if (game_board == NULL)
+  Game game;
+  if (!game_init(&game, templ, width, height, bomb_amount, seed))
   {
     printf("There was a problem generating the game, returning to the main menu...");
+    fflush(stdout);
     csleep(2);
     return;
   }
 
-  /* If we reach this point, all memory was succesfully allocated */
-  _generate_bombs(game_board, game_width, game_height, game_bomb_amount);
-  _generate_blessing(); /* No guess mode */
-
-  game_loop();
+  game_loop(&game);
+  if (stats != NULL)
+    game_record(&game, stats);
 
   /* Let's free all the memory */
-  for (uint16_t i = 0; i < game_height; i++)
-    free(game_board[i]);
-  free(game_board);
+  game_free(&game);
 }
 
-// static void game_draw(const uint16_t width, const uint16_t height)
-// {
-// }
+/* Everything but the board's bombs, false if the board couldn't be allocated (nothing has to be freed then) */
+static bool _game_begin(Game *game, const Template *templ, uint16_t width, uint16_t height, uint16_t bomb_amount)
+{
+  game->template = templ;
+  game->width = width;
+  game->height = height;
+  game->bomb_amount = bomb_amount;
+  game->running = true;
+  animation_init(&game->animation);
+  arena_init(&game->arena, 0);
+  arena_init(&game->journal_arena, 0);
+
+  /* Let's create the board */
+  game->board = minefield_board_alloc(width, height, &game->arena);
+  if (game->board == NULL)
+  {
+    arena_free(&game->arena);
+    arena_free(&game->journal_arena);
+    return false;
+  }
+  return true;
+}
 
-static void game_loop()
+bool game_init(Game *game, const Template *templ, uint16_t width, uint16_t height, uint16_t bomb_amount, uint64_t seed)
 {
-  /* If blessing exists, set current position to it, else, to 0 0 */
-  Vec2 invalid_blessing = {.x = -1, .y = -1};
+  if (!_game_begin(game, templ, width, height, bomb_amount))
+    return false;
+
+  /* Custom games don't have a template, so make one up for the generator */
+  Template custom;
+  if (templ == NULL)
+  {
+    template_init(&custom, "Custom", width, height, bomb_amount);
+    templ = &custom;
+  }
+
+  GeneratorResult generated;
+  const uint64_t started_at = profile_start();
+  bool generated_ok = generator_generate(templ, seed, game->board, &generated, &game->arena);
+  profile_stop(PROFILE_GENERATE, started_at);
+
+  if (!generated_ok || !_game_setup(game, &generated))
+  {
+    arena_free(&game->arena);
+    arena_free(&game->journal_arena);
+    return false;
+  }
+
+  return true;
+}
+
+bool game_init_generated(Game *game, const Template *templ, uint16_t width, uint16_t height, uint16_t bomb_amount,
+                         const GeneratorResult *generated)
+{
+  if (!_game_begin(game, templ, width, height, bomb_amount))
+    return false;
 
-  if (!vec_cmpr(noguess_blessing, invalid_blessing))
+  /* The board's own seed, no search this time (a different blessing means the shuffle had no memory) */
+  const Vec2 blessing = generator_fill(game->board, width, height, bomb_amount, generated->seed, &game->arena);
+  if (!vec_cmpr(blessing, generated->blessing) || !_game_setup(game, generated))
   {
-    cursor_position.x = noguess_blessing.x;
-    cursor_position.y = noguess_blessing.y;
+    arena_free(&game->arena);
+    arena_free(&game->journal_arena);
+    return false;
   }
+
+  return true;
+}
+
+bool game_init_coop(Game *game, const Template *templ, CoopBoard *coop, const GeneratorResult *generated)
+{
+  game->template = templ;
+  game->width = coop->width;
+  game->height = coop->height;
+  game->bomb_amount = coop->bomb_amount;
+  game->running = true;
+  animation_init(&game->animation);
+  arena_init(&game->arena, 0);
+  arena_init(&game->journal_arena, 0);
+
+  /* The game's own copy starts covered, the first sync shows whatever the other players did already */
+  game->board = minefield_board_alloc(coop->width, coop->height, &game->arena);
+  for (uint16_t i = 0; game->board != NULL && i < coop->height; i++)
+    for (uint16_t j = 0; j < coop->width; j++)
+    {
+      coop_cell(coop, j, i, &game->board[i][j]);
+      game->board[i][j].is_mined = false;
+      game->board[i][j].is_flagged = false;
+    }
+
+  if (game->board == NULL || !_game_setup(game, generated) || (game->coop_player = coop_join(coop)) < 0)
+  {
+    arena_free(&game->arena);
+    arena_free(&game->journal_arena);
+    return false;
+  }
+
+  game->coop = coop;
+  return true;
+}
+
+static bool _game_setup(Game *game, const GeneratorResult *generated)
+{
+  game->coop = NULL;
+  if (!engine_init(&game->engine, game->board, game->width, game->height, game->bomb_amount, &game->arena, &game->journal_arena) ||
+      !frame_init(&game->frame, game->width, game->height, &game->arena))
+    return false;
+
+  /* If we reach this point, the board is ready (and rated) */
+  game->seed = generated->seed;
+  game->metrics = generated->metrics;
+  game->noguess_blessing = generated->blessing; /* No guess mode */
+
+  /* If blessing exists, set current position to it, else, to 0 0 */
+  Vec2 invalid_blessing = {.x = -1, .y = -1};
+
+  if (!vec_cmpr(game->noguess_blessing, invalid_blessing))
+    game->cursor = game->noguess_blessing;
   else
   {
-    cursor_position.x = 0;
-    cursor_position.y = 0;
+    game->cursor.x = 0;
+    game->cursor.y = 0;
   }
 
   /* Timer purposes */
-  start_timestamp = time(0);
+  stopwatch_start(&game->stopwatch);
+  game->seconds_passed = 0;
+  game->last_time_update = -1;
 
-  /* Cooldowns */
-  int32_t last_time_update = -1;
+  return true;
+}
 
-  /* Assure some variables are in their correct starting values */
-  correct_guesses = 0;
-  do_game_loop = true;
-  flags_placed = 0;
+void game_free(Game *game)
+{
+  if (game->coop != NULL)
+    coop_leave(game->coop, game->coop_player);
+  animation_free(&game->animation);
+  /* Board, engine and frame, all in one go */
+  arena_free(&game->arena);
+  arena_free(&game->journal_arena);
+  game->board = NULL;
+}
 
-  _draw_board();
+void game_stats_name(const Game *game, char name[STATS_NAME_LENGTH])
+{
+  if (game->template != NULL)
+    snprintf(name, STATS_NAME_LENGTH, "%s", game->template->name);
+  else
+    snprintf(name, STATS_NAME_LENGTH, "Custom %dx%d/%d", game->width, game->height, game->bomb_amount);
+}
+
+bool game_record(const Game *game, StatsStore *stats)
+{
+  if (game->engine.state == ENGINE_PLAYING)
+    return true;
+
+  StatsResult result = {
+      .seed = game->seed,
+      .time_ms = stopwatch_ms(&game->stopwatch),
+      .three_bv = game->metrics.three_bv,
+      .clicks = game->engine.clicks,
+      .won = game->engine.state == ENGINE_WON};
+  game_stats_name(game, result.name);
+
+  return stats_record(stats, &result);
+}
+
+void game_draw(Game *game)
+{
+  clear_screen();
+  frame_invalidate(&game->frame);
+  _draw_board(game);
   /* Draw the initial position of the cursor */
-  _draw_cell(game_board, cursor_position.x, cursor_position.y, CC_DARK_GREEN);
+  _draw_cell(game, game->cursor.x, game->cursor.y, CC_DARK_GREEN);
+  /* Draw GUI */
+  _draw_game_gui(game);
+  _draw_result(game);
+  game->last_time_update = game->seconds_passed;
+  _present(game);
+}
 
-  /* Game Loop */
-  while (do_game_loop)
+void game_resize(Game *game, uint16_t columns, uint16_t rows)
+{
+  const uint16_t old_row = GUI_ROW(game), old_width = GUI_WIDTH(game);
+
+  /* Whatever fits, leaving room for the GUI below */
+  uint16_t view_width = columns / 3;
+  uint16_t view_height = (rows > GUI_HEIGHT) ? rows - GUI_HEIGHT : 1;
+  frame_set_view(&game->frame, game->frame.view_x, game->frame.view_y, view_width, view_height);
+  _scroll_to_cursor(game);
+
+  if (GUI_ROW(game) == old_row && GUI_WIDTH(game) == old_width)
   {
-    seconds_passed = difftime(time(0), start_timestamp);
-    seconds_passed = (seconds_passed > 9999) ? 9999 : seconds_passed;
+    _present(game);
+    return;
+  }
 
-    Vec2 old_cursor_position = cursor_position;
+  /* The GUI moved, wipe it from where it was (cells drawn over it next take care of the rest) */
+  for (uint16_t row = old_row; row < old_row + GUI_HEIGHT && row <= rows; row++)
+  {
+    console_gotoxy(1, row);
+    console_print("%*s", old_width, "");
+  }
 
-    /* Get key presses */
-    vkey_t key = get_key();
+  _draw_game_gui(game);
+  _draw_result(game);
+  _present(game);
+}
 
-    if (key == VK_ESCAPE)
-      break;
+bool game_snapshot(Game *game, const char *name)
+{
+  RenderScreen screen;
+  if (!render_screen_init(&screen, game->width * 3, game->height + GUI_HEIGHT))
+    return false;
+
+  /* The whole board, not only what fits on the terminal */
+  const Frame view = game->frame;
+  frame_set_view(&game->frame, 0, 0, game->width, game->height);
+
+  void *context;
+  const RenderBackend *backend = console_get_backend(&context);
+  console_set_backend(&render_screen_backend, &screen);
+  game_draw(game);
+  console_set_backend(backend, context);
+
+  /* game_draw forgot what's on the terminal, draw it back */
+  frame_set_view(&game->frame, view.view_x, view.view_y, view.view_width, view.view_height);
+  game_draw(game);
+
+  bool saved = true;
+  const char *extensions[] = {"txt", "ppm"};
+  for (int32_t i = 0; i < 2; i++)
+  {
+    char path[256];
+    snprintf(path, sizeof(path), "%s.%s", name, extensions[i]);
 
-    /* Refresh display */
-    if (key == 'r' || key == 'R')
+    FILE *file = fopen(path, (i == 0) ? "w" : "wb");
+    if (file == NULL)
     {
-      /* Reset the screen */
-      clear_screen();
-      _draw_board();
-      /* Draw the initial position of the cursor */
-      _draw_cell(game_board, cursor_position.x, cursor_position.y, CC_DARK_GREEN);
-      /* Draw GUI */
-      _draw_game_gui();
+      saved = false;
+      continue;
     }
+    saved &= (i == 0) ? render_screen_write_text(&screen, file) : render_screen_write_ppm(&screen, file);
+    saved &= fclose(file) == 0;
+  }
 
-    /* Flag a field */
-    if (key == 'f' || key == 'F')
-    {
-      Minefield *field = &game_board[cursor_position.y][cursor_position.x];
-      /* Only if it hasn't been shown yet */
-      if (!field->is_mined)
-      {
-        /* Toggle flag */
-        field->is_flagged = !field->is_flagged;
-        /* This little trick will take 1 from flags if it's a 0, and add 1 if it's a 1*/
-        flags_placed += (int8_t)((field->is_flagged - 0.5) * 2.0);
-      }
+  render_screen_free(&screen);
+  return saved;
+}
 
-      /* Let's go update it */
-      _draw_cell(game_board, cursor_position.x, cursor_position.y, CC_DARK_GREEN);
-      /* And update the GUI */
-      _draw_game_gui();
-    }
+/* The local game's timer, keeps itself scheduled as long as the timer (or an animation) runs */
+typedef struct
+{
+  Game *game;
+  uint32_t deadline;
+  uint64_t deadline_at;
+} LocalTimer;
 
-    /* Movement Logic */
-    if (key != VK_NONE)
-    {
-      /* Move mouse according to the key pressed */
-      switch (key)
-      {
-      case (VK_LEFT):
-        cursor_position.x--;
-        break;
+static void _local_tick(Scheduler *scheduler, void *arg);
 
-      case (VK_RIGHT):
-        cursor_position.x++;
-        break;
+/* Schedules the game's next deadline, unless there's already one as soon as that */
+static void _local_schedule(Scheduler *scheduler, LocalTimer *timer)
+{
+  uint64_t next = game_next_deadline(timer->game);
+  if (next == TIMER_NEVER || (timer->deadline != 0 && timer->deadline_at <= next))
+    return;
 
-      case (VK_UP):
-        cursor_position.y--;
-        break;
+  if (timer->deadline != 0)
+    scheduler_cancel(scheduler, timer->deadline);
+  timer->deadline = scheduler_add(scheduler, next, _local_tick, timer);
+  timer->deadline_at = next;
+}
 
-      case (VK_DOWN):
-        cursor_position.y++;
-        break;
+static void _local_tick(Scheduler *scheduler, void *arg)
+{
+  LocalTimer *timer = arg;
 
-      default:
-        break;
-      }
+  timer->deadline = 0;
+  game_tick(timer->game);
+  _local_schedule(scheduler, timer);
+}
 
-      /* Clamp the values to the appropriate limits */
-      cursor_position.x = clamp(0, game_width - 1, cursor_position.x);
-      cursor_position.y = clamp(0, game_height - 1, cursor_position.y);
-    }
+/* The bomb odds overlay: a sampler on the board as it was when it was started, redrawn while it samples */
+typedef struct
+{
+  Game *game;
+  Sampler sampler;
+  bool running;
+  uint32_t clicks;
+  uint32_t revealed;
+  uint32_t deadline;
+} LocalOdds;
+
+static void _odds_tick(Scheduler *scheduler, void *arg)
+{
+  LocalOdds *odds = arg;
 
-    if (key == VK_ENTER)
-    {
-      Minefield *field = &game_board[cursor_position.y][cursor_position.x];
-
-      /* Depending of the state of the mine, we do certain actions */
-      if (field->has_bomb)
-        _game_over_animation();
-      else if (field->is_mined)
-        _sweep_field(cursor_position.x, cursor_position.y);
-      else if (!field->is_flagged)
-        _show_field(cursor_position.x, cursor_position.y);
-
-      /* Show cursor again */
-      _draw_cell(game_board, cursor_position.x, cursor_position.y, CC_DARK_GREEN);
-      /* Win condition */
-      if (correct_guesses == (game_width * game_height) - game_bomb_amount)
-        _win_animation();
-    }
+  /* Nothing to do here, waking the loop up is enough for it to get drawn */
+  odds->deadline = 0;
+  if (odds->running && !sampler_done(&odds->sampler))
+    odds->deadline = scheduler_add(scheduler, timer_now_ms() + ODDS_REFRESH_MS, _odds_tick, odds);
+}
+
+static void _odds_stop(Scheduler *scheduler, LocalOdds *odds)
+{
+  if (odds->deadline != 0)
+    scheduler_cancel(scheduler, odds->deadline);
+  odds->deadline = 0;
 
-    if (!vec_cmpr(cursor_position, old_cursor_position))
+  if (odds->running)
+    sampler_stop(&odds->sampler);
+  odds->running = false;
+}
+
+/* Samples the board again if a click (or an undo) changed it since */
+static void _odds_update(Scheduler *scheduler, LocalOdds *odds)
+{
+  const Game *game = odds->game;
+  if (odds->running && odds->clicks == game->engine.clicks && odds->revealed == game->engine.revealed)
+    return;
+
+  _odds_stop(scheduler, odds);
+  odds->clicks = game->engine.clicks;
+  odds->revealed = game->engine.revealed;
+  odds->running = sampler_start(&odds->sampler, game->board, game->width, game->height, game->bomb_amount, thread_cpu_count(),
+                                game->seed ^ ((uint64_t)odds->clicks << 32 | odds->revealed));
+  if (odds->running)
+    _odds_tick(scheduler, odds);
+}
+
+static void game_loop(Game *game)
+{
+  Scheduler scheduler;
+  scheduler_init(&scheduler);
+
+  LocalTimer timer = {.game = game, .deadline = 0};
+  /* Every flush below shows up on screen at once */
+  console_set_frames(true);
+
+  /* Only the part of the board that fits gets drawn */
+  uint16_t columns, rows;
+  if (console_get_size(&columns, &rows))
+    game_resize(game, columns, rows);
+  game_draw(game);
+
+  /* Performance overlay, toggled with O, and the bomb odds on the same row instead, toggled with B */
+  bool overlay = false;
+  LocalOdds odds = {.game = game, .running = false, .deadline = 0};
+
+  /* Game Loop */
+  while (game->running)
+  {
+    /* A key may have (un)paused the timer or started an animation */
+    _local_schedule(&scheduler, &timer);
+
+    /* Sleep until there's something to do */
+    bool key_ready = wait_key(scheduler_timeout_ms(&scheduler, timer_now_ms()));
+    profile_frame_begin();
+
+    uint64_t key_read_at = 0;
+    if (key_ready)
     {
-      _draw_cell(game_board, old_cursor_position.x, old_cursor_position.y, false);
-      _draw_cell(game_board, cursor_position.x, cursor_position.y, CC_DARK_GREEN);
-    }
+      key_read_at = profile_start();
+      vkey_t key = get_key();
+      profile_count(PROFILE_KEYS, 1);
 
-    /* Only redraw GUI if time is outdated */
-    if (last_time_update != seconds_passed)
+      /* Only the local game saves snapshots, sessions can't write files on the server */
+      if (key == 's' || key == 'S')
+      {
+        char name[48];
+        snprintf(name, sizeof(name), "csweeper_%llu", (unsigned long long)game->seed);
+        game_snapshot(game, name);
+      }
+      else if (key == 'o' || key == 'O')
+      {
+        overlay = !overlay;
+        _odds_stop(&scheduler, &odds);
+        /* Erase it right away, drawing it happens below */
+        if (!overlay)
+          _draw_overlay(game, false);
+      }
+      else if (key == 'b' || key == 'B')
+      {
+        overlay = false;
+        if (odds.running)
+        {
+          _odds_stop(&scheduler, &odds);
+          _draw_overlay(game, false);
+        }
+        else
+          _odds_update(&scheduler, &odds);
+      }
+      else if (key != VK_NONE)
+        game_handle_key(game, key);
+    }
+    /* Relayout right away, no need to press R */
+    if (console_resized() && console_get_size(&columns, &rows))
+      game_resize(game, columns, rows);
+    scheduler_run(&scheduler, timer_now_ms());
+
+    if (overlay)
+      _draw_overlay(game, true);
+    else if (odds.running)
     {
-      last_time_update = seconds_passed;
-      _draw_game_gui();
+      _odds_update(&scheduler, &odds);
+      if (odds.running)
+        _draw_odds(game, &odds.sampler);
     }
 
     /* Flush the standard output to get everything drawn instantly thrown on screen */
-    console_gotoxy(1, game_height + 3);
-    fflush(stdout);
+    console_flush();
+
+    /* The key's effect is on the terminal now */
+    if (key_read_at != 0)
+      profile_stop(PROFILE_LATENCY, key_read_at);
+    profile_frame_end();
   }
+
+  _odds_stop(&scheduler, &odds);
+  console_set_frames(false);
+  scheduler_free(&scheduler);
 }
 
-static void _game_over_animation()
+uint64_t game_next_deadline(const Game *game)
 {
-  for (uint16_t i = 0; i < game_height; i++)
-    for (uint16_t j = 0; j < game_width; j++)
-    {
-      if (!game_board[i][j].has_bomb)
-        continue;
-
-      console_gotoxy(j * 3 + 1, i + 1);
+  if (game->animation.running)
+    return animation_next_deadline(&game->animation);
+  if (!game->running || game->stopwatch.paused || game->seconds_passed >= MAX_SECONDS)
+    return TIMER_NEVER;
 
-      console_foreground_set(CC_WHITE);
-      console_background_set(CC_RED);
+  /* Right when the next second starts */
+  return timer_now_ms() + (1000 - stopwatch_ms(&game->stopwatch) % 1000);
+}
 
-      printf("[X]");
-    }
+bool game_tick(Game *game)
+{
+  if (game->animation.running)
+  {
+    /* The game is over once the animation is */
+    if (!animation_advance(&game->animation, timer_now_ms()))
+      game->running = false;
+    return _present(game) > 0;
+  }
 
-  console_color_reset();
+  uint64_t seconds = stopwatch_ms(&game->stopwatch) / 1000;
+  game->seconds_passed = (seconds > MAX_SECONDS) ? MAX_SECONDS : seconds;
 
-  console_foreground_set(CC_YELLOW);
-  _draw_text("Better luck next time!", (game_width * 3) / 2.0 + 1, game_height + 3, CENTER);
-  console_color_reset();
+  /* Only redraw GUI if time is outdated */
+  if (!game->running || game->last_time_update == game->seconds_passed)
+    return false;
 
-  fflush(stdout);
-  csleep(4);
-  do_game_loop = false;
+  game->last_time_update = game->seconds_passed;
+  _draw_game_gui(game);
+  console_gotoxy(1, GUI_ROW(game) + 2);
+  return true;
 }
 
-static void _win_animation()
+void game_handle_key(Game *game, vkey_t key)
 {
-  flags_placed = game_bomb_amount;
-  _draw_game_gui();
+  Vec2 old_cursor_position = game->cursor;
 
-  console_foreground_set(CC_BLUE);
-  _draw_text("YOU WON!", (game_width * 3) / 2.0 + 1, game_height + 3, CENTER);
+  if (key == VK_ESCAPE)
+  {
+    game->running = false;
+    return;
+  }
 
-  console_foreground_set(CC_GREEN);
-  _draw_text("good job!", (game_width * 3) / 2.0 + 1, game_height + 4, CENTER);
+  /*
+   * Undo (U) and redo (Y), they work during the win/lose animation too, to take back the end of the game
+   * (not on a shared board, other players may have played on top of it)
+   */
+  if ((key == 'u' || key == 'U' || key == 'y' || key == 'Y') && game->coop == NULL &&
+      !(game->stopwatch.paused && game->engine.state == ENGINE_PLAYING))
+  {
+    _undo_redo(game, key == 'u' || key == 'U');
+    _present(game);
+    return;
+  }
 
-  uint16_t iterations = 0;
-  repeat(10)
+  /* Any key skips the win/lose animation (and ends the game) */
+  if (game->animation.running)
   {
-    for (uint16_t i = 0; i < game_height; i++)
-      for (uint16_t j = 0; j < game_width; j++)
-      {
-        if (!game_board[i][j].has_bomb)
-          continue;
+    animation_skip(&game->animation);
+    game->running = false;
+    _present(game);
+    return;
+  }
 
-        console_gotoxy(j * 3 + 1, i + 1);
+  /* Refresh display */
+  if (key == 'r' || key == 'R')
+    game_draw(game);
 
-        // Color changing animation
-        if (iterations % 2 == 0)
-        {
-          console_foreground_set(CC_BLUE);
-          console_background_set(CC_YELLOW);
-        }
-        else
-        {
-          console_foreground_set(CC_YELLOW);
-          console_background_set(CC_BLUE);
-        }
+  /* Pause the timer, the board can't be touched until it's resumed */
+  if (key == 'p' || key == 'P')
+  {
+    if (game->stopwatch.paused)
+      stopwatch_resume(&game->stopwatch);
+    else
+      stopwatch_pause(&game->stopwatch);
 
-        printf("[!]");
-      }
+    _draw_game_gui(game);
+    console_gotoxy(1, GUI_ROW(game) + 2);
+  }
 
-    fflush(stdout);
-    csleep(0.5);
+  if (game->stopwatch.paused)
+    return;
 
-    iterations++;
+  /* Flag a field */
+  if (key == 'f' || key == 'F')
+  {
+    /* Toggle flag (only if it hasn't been shown yet) */
+    if (game->coop != NULL)
+    {
+      coop_flag(game->coop, game->cursor.x, game->cursor.y);
+      _coop_sync(game);
+    }
+    else
+    {
+      engine_flag(&game->engine, game->cursor.x, game->cursor.y);
+
+      /* Let's go update it */
+      _draw_changes(game);
+      _draw_cell(game, game->cursor.x, game->cursor.y, CC_DARK_GREEN);
+      /* And update the GUI */
+      _draw_game_gui(game);
+    }
   }
 
-  console_color_reset();
-  csleep(2);
+  /* Movement Logic */
+  /* Move mouse according to the key pressed */
+  switch (key)
+  {
+  case (VK_LEFT):
+    game->cursor.x--;
+    break;
+
+  case (VK_RIGHT):
+    game->cursor.x++;
+    break;
 
-  do_game_loop = false;
+  case (VK_UP):
+    game->cursor.y--;
+    break;
+
+  case (VK_DOWN):
+    game->cursor.y++;
+    break;
+
+  default:
+    break;
+  }
+
+  /* Clamp the values to the appropriate limits */
+  game->cursor.x = clamp(0, game->width - 1, game->cursor.x);
+  game->cursor.y = clamp(0, game->height - 1, game->cursor.y);
+  _scroll_to_cursor(game);
+
+  if (key == VK_ENTER || key == 'c' || key == 'C')
+  {
+    /* Show, sweep or blow up, depending of the state of the field (C sweeps every number that can be) */
+    const EngineState before = game->engine.state;
+    if (game->coop != NULL)
+    {
+      if (key == VK_ENTER)
+        coop_click(game->coop, game->cursor.x, game->cursor.y, &game->arena);
+      else
+        coop_sweep_all(game->coop, &game->arena);
+      _coop_sync(game);
+    }
+    else
+    {
+      if (key == VK_ENTER)
+        engine_click(&game->engine, game->cursor.x, game->cursor.y);
+      else
+        engine_sweep_all(&game->engine);
+      _after_action(game, before);
+    }
+  }
+
+  if (!vec_cmpr(game->cursor, old_cursor_position))
+  {
+    _draw_cell(game, old_cursor_position.x, old_cursor_position.y, false);
+    _draw_cell(game, game->cursor.x, game->cursor.y, CC_DARK_GREEN);
+  }
+
+  _present(game);
 }
 
-/* 'Sweep' a mine field (equivalent to shift-click on og minesweeper) */
-static void _sweep_field(uint16_t x, uint16_t y)
+bool game_coop_sync(Game *game)
 {
-  if (!game_board[y][x].is_mined)
-    return;
+  if (!_coop_sync(game))
+    return false;
+
+  _present(game);
+  return true;
+}
 
-  uint8_t flag_count = 0;
+static bool _coop_sync(Game *game)
+{
+  const EngineState before = game->engine.state;
+  const uint32_t flags_before = game->engine.flags;
+  uint32_t cells[COOP_SYNC_CELLS];
+  uint32_t count, changed = 0;
 
-  for (int32_t i = -1; i <= 1; i++)
+  while ((count = coop_poll(game->coop, game->coop_player, cells, COOP_SYNC_CELLS)) > 0)
   {
-    /* Limit detection */
-    if (y + i < 0 || y + i >= game_height)
-      continue;
-    for (int32_t j = -1; j <= 1; j++)
+    for (uint32_t i = 0; i < count; i++)
     {
-      /* Limit detection */
-      if (x + j < 0 || x + j >= game_width)
-        continue;
-      flag_count += game_board[y + i][x + j].is_flagged;
-      ;
+      uint16_t x = cells[i] % game->width, y = cells[i] / game->width;
+      coop_cell(game->coop, x, y, &game->board[y][x]);
+      /* The win/lose animation is painting the bombs, flags landing after the end of the game stay under it */
+      if (!game->animation.running)
+        _draw_cell(game, x, y, false);
     }
+    changed += count;
   }
 
-  if (flag_count == game_board[y][x].bomb_amount)
-    _show_surrounding_fields(x, y, false);
+  /* Blowing up doesn't change any cell, so the state has to be looked at every time */
+  game->engine.flags = atomic_load(&game->coop->flags);
+  game->engine.state = coop_state(game->coop);
+  if (changed == 0 && game->engine.state == before && game->engine.flags == flags_before)
+    return false;
+
+  if (game->engine.flags != flags_before)
+    _draw_game_gui(game);
+  _after_action(game, before);
+  return true;
 }
 
-static void _show_field(uint16_t x, uint16_t y)
+static void _after_action(Game *game, EngineState before)
 {
-  if (game_board[y][x].is_mined)
+  _draw_changes(game);
+
+  /* Show cursor again */
+  _draw_cell(game, game->cursor.x, game->cursor.y, CC_DARK_GREEN);
+
+  if (game->engine.state == before)
     return;
 
-  game_board[y][x].is_mined = true;
-  game_board[y][x].is_flagged = false;
-  /* Update the cell */
-  _draw_cell(game_board, x, y, false);
-  if (!game_board[y][x].has_bomb)
-    correct_guesses++;
+  /* The time is final once the game is over (and goes on if that gets undone) */
+  if (game->engine.state == ENGINE_PLAYING)
+  {
+    stopwatch_resume(&game->stopwatch);
+    _draw_result(game);
+  }
   else
-    /* You lost */
-    _game_over_animation();
+    stopwatch_pause(&game->stopwatch);
 
-  /* If the field has no bombs surrounding it, show all surrounding fields */
-  if (game_board[y][x].bomb_amount == 0)
-    _show_surrounding_fields(x, y, true);
+  if (game->engine.state == ENGINE_LOST)
+    _game_over_animation(game);
+  else if (game->engine.state == ENGINE_WON)
+    _win_animation(game);
 }
 
-static void _show_surrounding_fields(uint16_t x, uint16_t y, bool bypass_flags)
+static void _undo_redo(Game *game, bool undo)
 {
-  for (int32_t i = -1; i <= 1; i++)
+  const EngineState before = game->engine.state;
+  if (!(undo ? engine_undo(&game->engine) : engine_redo(&game->engine)))
+    return;
+
+  /* The animation painted over the bombs, so the whole board goes back on the frame */
+  if (game->animation.running)
   {
-    /* Limit detection */
-    if (y + i < 0 || y + i >= game_height)
-      continue;
-    for (int32_t j = -1; j <= 1; j++)
-    {
-      /* Limit detection */
-      if (x + j < 0 || x + j >= game_width)
-        continue;
+    animation_free(&game->animation);
+    _draw_board(game);
+  }
 
-      /* ONLY surrounding fields */
-      if (i == 0 && j == 0)
-        continue;
+  _after_action(game, before);
+  _draw_game_gui(game);
+}
 
-      /* If bypass_flags is off */
-      if (!bypass_flags && game_board[y + i][x + j].is_flagged)
-        continue;
+static void _animate_bombs(Game *game, const Keyframe *keyframes, uint32_t keyframe_count)
+{
+  /* Only needed until the animation copies it */
+  const ArenaMark mark = arena_mark(&game->arena);
+  Vec2 *bombs = arena_alloc(&game->arena, sizeof(Vec2) * game->bomb_amount);
+  uint32_t bomb_count = 0;
 
-      _show_field(x + j, y + i);
-    }
+  if (bombs != NULL)
+  {
+    for (uint16_t i = 0; i < game->height; i++)
+      for (uint16_t j = 0; j < game->width; j++)
+        if (game->board[i][j].has_bomb && bomb_count < game->bomb_amount)
+        {
+          Vec2 bomb = {.x = j, .y = i};
+          bombs[bomb_count++] = bomb;
+        }
   }
+
+  /* Without memory there's no animation, the game just ends */
+  if (bombs == NULL || !animation_start(&game->animation, &game->frame, bombs, bomb_count, keyframes, keyframe_count, timer_now_ms()))
+    game->running = false;
+  arena_rewind(&game->arena, mark);
+}
+
+static void _game_over_animation(Game *game)
+{
+  _animate_bombs(game, game_over_keyframes, sizeof(game_over_keyframes) / sizeof(Keyframe));
+  _draw_result(game);
+}
+
+static void _win_animation(Game *game)
+{
+  /* The engine flagged every bomb left when the game was won */
+  _draw_game_gui(game);
+  _draw_result(game);
+
+  _animate_bombs(game, win_keyframes, sizeof(win_keyframes) / sizeof(Keyframe));
 }
 
-static void _draw_cell(Minefield **board, uint16_t x, uint16_t y, uint8_t highlight)
+static void _draw_cell(Game *game, uint16_t x, uint16_t y, uint8_t highlight)
 {
-  console_gotoxy(x * 3 + 1, y + 1);
+  const Minefield *field = &game->board[y][x];
+  FrameCell cell = {' ', FRAME_DEFAULT_COLOR, FRAME_DEFAULT_COLOR, FRAME_DEFAULT_COLOR, FRAME_DEFAULT_COLOR};
+
   if (highlight)
   {
-    console_background_set(highlight);
-    console_foreground_set(CC_WHITE);
-    printf("[ ]");
-    console_color_reset();
-  }
-  else
-  {
-    console_color_reset();
-    printf("[ ]");
+    cell.bracket_fg = CC_WHITE;
+    cell.bracket_bg = highlight;
   }
 
-  console_gotoxy(x * 3 + 2, y + 1);
-
   // Example: show covered cell, revealed cell, or flagged cell
-  if (board[y][x].is_mined)
+  if (field->is_mined)
   {
-    if (board[y][x].has_bomb)
-    {
-      printf("X");
-    }
+    if (field->has_bomb)
+      cell.glyph = 'X';
     else
     {
-      console_foreground_set(mine_colors[board[y][x].bomb_amount]);
-      printf("%d", board[y][x].bomb_amount);
+      cell.glyph = '0' + field->bomb_amount;
+      cell.glyph_fg = mine_colors[field->bomb_amount];
     }
   }
-  else if (board[y][x].is_flagged)
+  else if (field->is_flagged)
   {
-
-    console_background_set(CC_RED);
-    console_foreground_set(CC_WHITE);
-    printf("F");
+    cell.glyph = 'F';
+    cell.glyph_fg = CC_WHITE;
+    cell.glyph_bg = CC_RED;
   }
   else
   {
     Vec2 pos_as_vec = {.x = x, .y = y};
-    if (vec_cmpr(noguess_blessing, pos_as_vec))
+    if (vec_cmpr(game->noguess_blessing, pos_as_vec))
     {
-      console_foreground_set(CC_GREEN);
-      printf("X");
+      cell.glyph = 'X';
+      cell.glyph_fg = CC_GREEN;
     }
-    else
-      printf(" ");
   }
-  console_color_reset();
+
+  frame_set(&game->frame, x, y, cell);
 }
 
-static void _draw_board()
+static void _draw_changes(Game *game)
 {
-  /* Go to the start */
-  console_pos_reset();
-  for (uint16_t i = 0; i < game_height; i++)
-  {
-    for (uint16_t j = 0; j < game_width; j++)
-    {
-      _draw_cell(game_board, j, i, false);
-    }
-    printf("\n");
-  }
+  for (uint32_t i = 0; i < game->engine.changed_count; i++)
+    _draw_cell(game, game->engine.changed[i].x, game->engine.changed[i].y, false);
+  engine_clear_changes(&game->engine);
+}
+
+static void _draw_board(Game *game)
+{
+  for (uint16_t i = 0; i < game->height; i++)
+    for (uint16_t j = 0; j < game->width; j++)
+      _draw_cell(game, j, i, false);
+}
+
+static uint32_t _present(Game *game)
+{
+  const uint64_t started_at = profile_start();
+  uint32_t drawn = frame_present(&game->frame);
+  profile_stop(PROFILE_RENDER, started_at);
+  console_gotoxy(1, GUI_ROW(game) + 2);
+  return drawn;
 }
 
-static void _draw_game_gui()
+static void _draw_game_gui(Game *game)
 {
   /* Clean the old GUI up */
-  console_gotoxy(1, game_height + 1);
+  console_gotoxy(1, GUI_ROW(game));
   repeat(2)
   {
     /* Basically print enough spaces to get rid of anything drawn before */
-    char override[game_width * 3 + 1];
-    memset(override, ' ', game_width * 3);
-    override[game_width * 3] = '\0';
-
-    printf("%s\n", override);
+    console_print("%*s\n", GUI_WIDTH(game), "");
   }
 
   console_color_reset();
 
   /* Draw the GUI */
   char flags_strings[20];
-  sprintf(flags_strings, "%d/%d mines", flags_placed, game_bomb_amount);
-  _draw_text(flags_strings, 1, game_height + 1, RIGHT);
+  sprintf(flags_strings, "%d/%d mines", game->engine.flags, game->bomb_amount);
+  _draw_text(flags_strings, 1, GUI_ROW(game), RIGHT);
 
   /* Draw the seconds passed */
   char time_string[10];
-  sprintf(time_string, "%04d", seconds_passed);
-  _draw_text(time_string, game_width * 3 + 1, game_height + 1, LEFT);
+  sprintf(time_string, "%04d", game->seconds_passed);
+  /* Paused timers are yellow */
+  if (game->stopwatch.paused && game->engine.state == ENGINE_PLAYING)
+    console_foreground_set(CC_YELLOW);
+  _draw_text(time_string, GUI_WIDTH(game) + 1, GUI_ROW(game), LEFT);
+  console_color_reset();
+
+  /* Draw the board difficulty next to the timer */
+  char difficulty_string[24];
+  sprintf(difficulty_string, "3BV:%d T%d ", game->metrics.three_bv, game->metrics.solver.max_tier);
+  _draw_text(difficulty_string, GUI_WIDTH(game) + 1 - strlen(time_string), GUI_ROW(game), LEFT);
+
+  char openings_string[24];
+  sprintf(openings_string, "%dop %disl", game->metrics.openings, game->metrics.islands);
+  _draw_text(openings_string, GUI_WIDTH(game) + 1, GUI_ROW(game) + 1, LEFT);
 
   /* Draw the template */
-  if (current_template != NULL)
+  if (game->template != NULL)
   {
-    console_foreground_set(current_template->fg_color);
-    console_background_set(current_template->bg_color);
+    console_foreground_set(game->template->fg_color);
+    console_background_set(game->template->bg_color);
   }
-  _draw_text((current_template == NULL) ? "Custom" : current_template->name, (game_width * 3) / 2.0 + 1, game_height + 2, CENTER);
+  _draw_text((game->template == NULL) ? "Custom" : game->template->name, GUI_WIDTH(game) / 2.0 + 1, GUI_ROW(game) + 1, CENTER);
   console_color_reset();
 }
 
-static void _draw_text(const char *text, uint16_t x, uint16_t y, TextAlign alignment)
+static void _draw_result(Game *game)
 {
-  int32_t starting_x;
-
-  /* Get the starting x */
-  switch (alignment)
+  /* Undoing the end of the game takes the message back */
+  if (game->engine.state == ENGINE_PLAYING)
   {
-  case (RIGHT):
-    starting_x = x;
-    break;
-
-  case (LEFT):
-    starting_x = x - strlen(text);
-    break;
-
-  case (CENTER):
-    starting_x = (x - strlen(text) / 2.0) + 0.5;
-    break;
+    console_gotoxy(1, GUI_ROW(game) + 2);
+    console_print("%*s", GUI_WIDTH(game), "");
+    console_gotoxy(1, GUI_ROW(game) + 3);
+    console_print("%*s", GUI_WIDTH(game), "");
   }
+  else if (game->engine.state == ENGINE_LOST)
+  {
+    console_foreground_set(CC_YELLOW);
+    _draw_text("Better luck next time!", GUI_WIDTH(game) / 2.0 + 1, GUI_ROW(game) + 2, CENTER);
+  }
+  else if (game->engine.state == ENGINE_WON)
+  {
+    console_foreground_set(CC_BLUE);
+    _draw_text("YOU WON!", GUI_WIDTH(game) / 2.0 + 1, GUI_ROW(game) + 2, CENTER);
 
-  if (starting_x <= 0)
-    return;
-
-  console_gotoxy(starting_x, y);
-  printf("%s", text);
+    console_foreground_set(CC_GREEN);
+    _draw_text("good job!", GUI_WIDTH(game) / 2.0 + 1, GUI_ROW(game) + 3, CENTER);
+  }
+  console_color_reset();
 }
 
-/* Function to allocate all the memory for the game and initialize all fields */
-static Minefield **_allocate_board(uint16_t width, uint16_t height)
+static void _draw_overlay(Game *game, bool shown)
 {
-  Minefield **board = malloc(sizeof(Minefield *) * height);
-  if (board == NULL)
-  {
-    return NULL;
-  }
-
-  for (uint16_t i = 0; i < height; i++)
+  char text[OVERLAY_WIDTH + 1] = "";
+  if (shown)
   {
-    board[i] = malloc(sizeof(Minefield) * width);
+    ProfileStats frame;
+    uint64_t bytes, syscalls;
+    profile_stats(PROFILE_FRAME, &frame);
+    profile_last_frame(&bytes, &syscalls);
 
-    if (board[i] == NULL)
-    {
-      /* Free all the memory that was succesfully allocated */
-      for (uint16_t j = i - 1; j >= 0; j++)
-        free(board[j]);
-      free(board);
-      return NULL;
-    }
-    else
-      /* Init every space in the row */
-      for (uint16_t j = 0; j < width; j++)
-        init_minefield(&board[i][j]);
+    snprintf(text, sizeof(text), "frame %.2fms (p99 %.2fms) %lluB ~%llu writes (est.)",
+             frame.last_us / 1000.0, frame.p99_us / 1000.0, (unsigned long long)bytes, (unsigned long long)syscalls);
   }
 
-  return board;
+  console_gotoxy(1, GUI_ROW(game) + GUI_HEIGHT - 1);
+  console_foreground_set(CC_DARK_GRAY);
+  console_print("%-*s", OVERLAY_WIDTH, text);
+  console_color_reset();
 }
 
-/* Functions related to in-game stuff */
-static void _generate_bombs(Minefield **board, uint16_t width, uint16_t height, uint16_t bomb_amount)
+static void _draw_odds(Game *game, const Sampler *sampler)
 {
-  uint32_t arr[width * height];
+  char text[OVERLAY_WIDTH + 1];
+  double chance, margin;
+  const char *done = sampler_done(sampler) ? ", done" : "";
+
+  if (sampler_estimate(sampler, game->cursor.x, game->cursor.y, &chance, &margin))
+    snprintf(text, sizeof(text), "bomb %.1f%% (+-%.1f%%), %llu layouts%s", chance * 100, margin * 100,
+             (unsigned long long)sampler_samples(sampler), done);
+  else
+    snprintf(text, sizeof(text), "bomb odds: %s, %llu layouts%s",
+             (sampler->variable[game->cursor.y * game->width + game->cursor.x] == SAMPLER_SHOWN) ? "shown" : "sampling",
+             (unsigned long long)sampler_samples(sampler), done);
 
-  /* Create index of all bombs */
-  for (uint32_t i = 0; i < width * height; i++)
-    arr[i] = i;
+  console_gotoxy(1, GUI_ROW(game) + GUI_HEIGHT - 1);
+  console_foreground_set(CC_DARK_GRAY);
+  console_print("%-*s", OVERLAY_WIDTH, text);
+  console_color_reset();
+}
 
-  /* Shuffle the array */
-  for (uint32_t i = 0; i < width * height - 1; i++)
-  {
-    uint32_t j = rand() % (width * height);
-    int t = arr[j];
-    arr[j] = arr[i];
-    arr[i] = t;
-  }
+static void _scroll_to_cursor(Game *game)
+{
+  const Frame *frame = &game->frame;
+  uint16_t x = frame->view_x, y = frame->view_y;
 
-  /* Now convert the indexes generated to actual coordinates and populate the minefield */
-  for (uint16_t i = 0; i < bomb_amount; i++)
-  {
-    uint16_t index = arr[i];
-    uint16_t y = index / width;
-    uint16_t x = index % width;
-    board[y][x].has_bomb = 1;
+  if (game->cursor.x < x)
+    x = game->cursor.x;
+  else if (game->cursor.x >= x + frame->view_width)
+    x = game->cursor.x - frame->view_width + 1;
 
-    /* Up neighbours's bomb amount */
-    for (int32_t k = -1; k <= 1; k++)
-    {
-      /* Limit detection */
-      if (y + k < 0 || y + k >= height)
-        continue;
-      for (int32_t l = -1; l <= 1; l++)
-      {
-        if (x + l < 0 || x + l >= width)
-          continue;
+  if (game->cursor.y < y)
+    y = game->cursor.y;
+  else if (game->cursor.y >= y + frame->view_height)
+    y = game->cursor.y - frame->view_height + 1;
 
-        board[y + k][x + l].bomb_amount++;
-      }
-    }
-  }
+  frame_set_view(&game->frame, x, y, frame->view_width, frame->view_height);
 }
 
-static void _generate_blessing()
+static void _draw_text(const char *text, uint16_t x, uint16_t y, TextAlign alignment)
 {
-  /* Let's get the eligible spaces */
-  Vec2 eligibles[game_width * game_height];
-  uint16_t eligible_count = 0;
-
-  for (uint16_t i = 0; i < game_height; i++)
-    for (uint16_t j = 0; j < game_width; j++)
-      /* If it has no stuff around it, make it eligible */
-      if (game_board[i][j].bomb_amount == 0)
-      {
-        Vec2 eligible_coords = {.x = j, .y = i};
-        /* Set the coordinates */
-        eligibles[eligible_count] = eligible_coords;
-        eligible_count++;
-      }
+  int32_t starting_x;
 
-  /* Shuffle the array */
-  for (uint32_t i = 0; i < eligible_count; i++)
+  /* Get the starting x */
+  switch (alignment)
   {
-    uint32_t j = rand() % eligible_count;
-    Vec2 t = eligibles[j];
-    eligibles[j] = eligibles[i];
-    eligibles[i] = t;
+  case (RIGHT):
+    starting_x = x;
+    break;
+
+  case (LEFT):
+    starting_x = x - strlen(text);
+    break;
+
+  case (CENTER):
+    starting_x = (x - strlen(text) / 2.0) + 0.5;
+    break;
   }
 
-  /* First element is our blessing */
-  if (eligible_count > 0)
-    noguess_blessing = eligibles[0];
-}
\ No newline at end of file
+  if (starting_x <= 0)
+    return;
+
+  console_gotoxy(starting_x, y);
+  console_print("%s", text);
+}
@@ -1,9 +1,87 @@
 #ifndef GAME_H
 #define GAME_H
 
+#include <stdbool.h>
 #include <stdint.h>
-
+#include "animation.h"
+#include "coop.h"
+#include "engine.h"
+#include "generator.h"
+#include "metrics.h"
+#include "stats.h"
+#include "../classes/arena.h"
+#include "../classes/minefield.h"
 #include "../classes/templates.h"
+#include "../classes/vec.h"
+#include "../utils/frame.h"
+#include "../utils/input.h"
+#include "../utils/timer.h"
+
+/*
+ * Everything a single game needs, every running game (the local one or
+ * each session of the server) has its own
+ */
+typedef struct
+{
+  /*
+   * Owns all of the game's memory (board, engine, frame buffers) and the scratch space
+   * the generator, solver and drawing need, game_free gives it all back at once
+   */
+  Arena arena;
+  /* Only for the engine's undo journal, the one thing that keeps growing while the game is played */
+  Arena journal_arena;
+  /* Game board 2D array (in the arena) */
+  Minefield **board;
+  /* Template the game was started with (for drawing purposes), ALWAYS check if NULL */
+  const Template *template;
+  /* Game dimensions */
+  uint16_t width;
+  uint16_t height;
+  uint16_t bomb_amount;
+  /* Cursor position used in game_handle_key and a lot other functions */
+  Vec2 cursor;
+  /* Game time in milliseconds, stopped while paused and once the game is over */
+  Stopwatch stopwatch;
+  /* Time you see on-screen when playing (seconds) */
+  uint16_t seconds_passed;
+  /* Last time drawn on the GUI, -1 if it was never drawn */
+  int32_t last_time_update;
+  /*
+   * The rules of the game (showing, sweeping and flagging fields) and all the counters
+   * the GUI and the win condition use, see engine.h
+   */
+  Engine engine;
+  /*
+   * Board shared with other players and this game's player on it (see coop.h), NULL when the game
+   * has a board of its own. The game then plays on the shared board and `board` is just its copy
+   * for drawing, the engine only keeps the flags and the state for the GUI.
+   */
+  CoopBoard *coop;
+  int32_t coop_player;
+  /*
+   * Although the game is not TRULY a no guessing mode
+   * the No Guess Blessing is a vector that contains one randomly chosen 0 space.
+   *
+   * This way, you can get a guaranteed* island at the start of the game.
+   * Your cursor will also be placed automatically on the blessing at the beginning of the game.
+   *
+   * asterisk: The blessing is not guaranteed, if there are no 0 spaces when first building the board
+   * the blessing will stay at -1, -1 and nothing will be highlighted at the start.
+   *
+   * The cursor will be placed at 0, 0 if this does happen.
+   */
+  Vec2 noguess_blessing;
+  /* How hard the board is, calculated right after generating it (see metrics.h) */
+  BoardMetrics metrics;
+  /* Seed the board was generated from */
+  uint64_t seed;
+  /* What the board looks like on screen, every board cell is drawn through it */
+  Frame frame;
+  /* Win/lose animation, the game keeps running (without taking moves) while it plays */
+  Animation animation;
+  /* Turns false when the game is over (or the player left) */
+  bool running;
+} Game;
 
 /**
  * start_custom_game
@@ -11,14 +89,102 @@
  * @param width The width of the game board
  * @param height The height of the game board
  * @param bomb_amount The number of bombs to place
+ * @param stats Where the result is written down, NULL to not keep it
  */
-void start_custom_game(uint16_t width, uint16_t height, uint16_t bomb_amount);
+void start_custom_game(uint16_t width, uint16_t height, uint16_t bomb_amount, StatsStore *stats);
 
 /**
  * start_template_game
  * Start a templated game
  * @param templ Pointer to the template to use for the game
+ * @param stats Where the result is written down, NULL to not keep it
+ */
+void start_template_game(Template *templ, StatsStore *stats);
+
+/**
+ * game_init
+ * Generates the board and readies a game up without drawing anything
+ * @param game The game to set up
+ * @param templ Template to use, NULL for a custom game
+ * @param width The width of the game board
+ * @param height The height of the game board
+ * @param bomb_amount The number of bombs to place
+ * @param seed Seed for the generator
+ * @return false if there was a problem generating the game (nothing has to be freed then)
  */
-void start_template_game(Template *templ);
+bool game_init(Game *game, const Template *templ, uint16_t width, uint16_t height, uint16_t bomb_amount, uint64_t seed);
+
+/**
+ * game_init_generated
+ * Readies a game up on a board generator_generate already picked, without drawing anything.
+ * The board is just filled back from the result's seed, which takes no time next to generating it.
+ * @param game The game to set up
+ * @param templ Template the board was generated with, NULL for a custom game
+ * @param width The width of the game board
+ * @param height The height of the game board
+ * @param bomb_amount The number of bombs to place
+ * @param generated What the generator said about the board (blessing, metrics and seed)
+ * @return false if there was no memory (nothing has to be freed then)
+ */
+bool game_init_generated(Game *game, const Template *templ, uint16_t width, uint16_t height, uint16_t bomb_amount,
+                         const GeneratorResult *generated);
+
+/**
+ * game_init_coop
+ * Readies a game up on a shared board as a new player on it, without drawing anything
+ * @param game The game to set up
+ * @param templ Template the shared board was generated with, NULL for a custom one
+ * @param coop The shared board
+ * @param generated What the generator said about the shared board (blessing, metrics and seed)
+ * @return false if there was no memory or the board has no room for another player (nothing has to be freed then)
+ */
+bool game_init_coop(Game *game, const Template *templ, CoopBoard *coop, const GeneratorResult *generated);
+void game_free(Game *game);
+
+/* Name the game goes by on the results log: the template's, or its size if it's a custom game */
+void game_stats_name(const Game *game, char name[STATS_NAME_LENGTH]);
+
+/**
+ * game_record
+ * Writes the game down on the results log, if it's over (games left halfway don't count)
+ * @return false if it couldn't be written
+ */
+bool game_record(const Game *game, StatsStore *stats);
+
+/* Draws the whole game (board, cursor and GUI) on the current console output */
+void game_draw(Game *game);
+
+/**
+ * game_resize
+ * Fits the game on a console of the given size: only the part of the board around the cursor
+ * that fits is drawn, with the GUI right below it. Cells that weren't on screen before get drawn,
+ * the rest is left alone.
+ * @param game The game to lay out
+ * @param columns Console width
+ * @param rows Console height
+ */
+void game_resize(Game *game, uint16_t columns, uint16_t rows);
+
+/**
+ * game_snapshot
+ * Draws the whole board and GUI with the snapshot render backend and saves it as
+ * <name>.txt and <name>.ppm, then draws the game back on the current console
+ * @param game The game to save
+ * @param name Path of the files, without the extension
+ * @return false if the screen couldn't be allocated or a file couldn't be written
+ */
+bool game_snapshot(Game *game, const char *name);
+
+/* Everything a single key press does, drawing included */
+void game_handle_key(Game *game, vkey_t key);
+
+/* Updates the timer and the animation, returns true if anything had to be redrawn */
+bool game_tick(Game *game);
+
+/* Draws what changed on a shared board since the last call (whoever changed it), returns true if anything had to be redrawn */
+bool game_coop_sync(Game *game);
+
+/* When (on the timer_now_ms clock) game_tick has something to redraw next, TIMER_NEVER if it won't */
+uint64_t game_next_deadline(const Game *game);
 
-#endif /* GAME_H */
\ No newline at end of file
+#endif /* GAME_H */
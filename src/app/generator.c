@@ -0,0 +1,236 @@
+/**
+ * generator.c
+ * Board generation, plain and difficulty targeted.
+ *
+ * Targeted generation is just rejection sampling, but spread over all the cores:
+ * every worker grabs the next attempt number from a shared counter, builds that board
+ * on its own scratch board and rates it, the first one to match copies its board out
+ * and tells everybody else to stop. The 3BV check every attempt goes through runs on
+ * bit planes of the board (see bitplane.h), only the boards that pass it get solved.
+ */
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "generator.h"
+#include "../classes/bitplane.h"
+#include "../classes/rng.h"
+#include "../utils/threads.h"
+
+/* More workers than this just fight over memory bandwidth */
+#define GENERATOR_MAX_THREADS 32
+
+/* Shared state of a targeted search */
+typedef struct
+{
+  const Template *templ;
+  uint64_t seed;
+  Minefield **board;
+  GeneratorResult *result;
+
+  atomic_uint next_attempt;
+  atomic_bool found;
+  atomic_bool out_of_memory;
+} Search;
+
+/* A thread of the search, and the arena it takes its memory from */
+typedef struct
+{
+  Search *search;
+  Arena *arena;
+} Worker;
+
+Vec2 generator_fill(Minefield **board, uint16_t width, uint16_t height, uint16_t bomb_amount, uint64_t seed, Arena *scratch)
+{
+  const uint32_t total = (uint32_t)width * height;
+  Vec2 blessing = {.x = -1, .y = -1};
+
+  const ArenaMark mark = arena_mark(scratch);
+  uint32_t *arr = arena_alloc(scratch, sizeof(uint32_t) * total);
+  if (arr == NULL)
+    return blessing;
+
+  Rng rng;
+  rng_seed(&rng, seed);
+
+  /* Create index of all fields */
+  for (uint32_t i = 0; i < total; i++)
+    arr[i] = i;
+
+  /* Partial Fisher-Yates, only the first bomb_amount spots matter */
+  for (uint32_t i = 0; i < bomb_amount; i++)
+  {
+    uint32_t j = i + rng_below(&rng, total - i);
+    uint32_t t = arr[j];
+    arr[j] = arr[i];
+    arr[i] = t;
+  }
+
+  /* Now convert the indexes generated to actual coordinates and populate the minefield */
+  for (uint16_t i = 0; i < bomb_amount; i++)
+  {
+    uint16_t y = arr[i] / width;
+    uint16_t x = arr[i] % width;
+    board[y][x].has_bomb = true;
+
+    /* Up neighbours's bomb amount */
+    for (int32_t k = -1; k <= 1; k++)
+    {
+      /* Limit detection */
+      if (y + k < 0 || y + k >= height)
+        continue;
+      for (int32_t l = -1; l <= 1; l++)
+      {
+        if (x + l < 0 || x + l >= width)
+          continue;
+
+        board[y + k][x + l].bomb_amount++;
+      }
+    }
+  }
+  arena_rewind(scratch, mark);
+
+  /* The blessing is a random 0 (the bomb field's bomb_amount doesn't matter, skip them) */
+  uint32_t zero_count = 0;
+  for (uint16_t i = 0; i < height; i++)
+    for (uint16_t j = 0; j < width; j++)
+      zero_count += !board[i][j].has_bomb && board[i][j].bomb_amount == 0;
+
+  if (zero_count == 0)
+    return blessing;
+
+  uint32_t chosen = rng_below(&rng, zero_count);
+  for (uint16_t i = 0; i < height; i++)
+    for (uint16_t j = 0; j < width; j++)
+      if (!board[i][j].has_bomb && board[i][j].bomb_amount == 0 && chosen-- == 0)
+      {
+        blessing.x = j;
+        blessing.y = i;
+        return blessing;
+      }
+
+  return blessing;
+}
+
+static bool _has_target(const Template *templ)
+{
+  return templ->min_3bv != 0 || templ->max_3bv != 0 || templ->max_tier != SOLVER_TIER_NONE;
+}
+
+static bool _in_3bv_range(const Template *templ, const BoardMetrics *metrics)
+{
+  if (templ->min_3bv != 0 && metrics->three_bv < templ->min_3bv)
+    return false;
+  if (templ->max_3bv != 0 && metrics->three_bv > templ->max_3bv)
+    return false;
+  return true;
+}
+
+static void _search_worker(void *arg)
+{
+  Worker *worker = arg;
+  Search *search = worker->search;
+  const Template *templ = search->templ;
+
+  /* Nothing is allocated between attempts, everything is given back at the end */
+  const ArenaMark mark = arena_mark(worker->arena);
+  Minefield **scratch = minefield_board_alloc(templ->width, templ->height, worker->arena);
+  BoardPlanes planes;
+  if (scratch == NULL || !board_planes_init(&planes, templ->width, templ->height))
+  {
+    atomic_store(&search->out_of_memory, true);
+    arena_rewind(worker->arena, mark);
+    return;
+  }
+
+  while (!atomic_load_explicit(&search->found, memory_order_relaxed))
+  {
+    uint32_t attempt = atomic_fetch_add(&search->next_attempt, 1);
+    if (attempt >= GENERATOR_MAX_ATTEMPTS)
+      break;
+
+    for (uint16_t i = 0; i < templ->height; i++)
+      for (uint16_t j = 0; j < templ->width; j++)
+        init_minefield(&scratch[i][j]);
+
+    uint64_t seed = search->seed + attempt;
+    Vec2 blessing = generator_fill(scratch, templ->width, templ->height, templ->bomb_amount, seed, worker->arena);
+
+    /* Cheap check first, only run the solver on boards with the right 3BV */
+    BoardMetrics metrics;
+    uint32_t lonely;
+    board_planes_load(&planes, scratch);
+    if (!board_planes_3bv(&planes, worker->arena, &metrics.openings, &lonely, &metrics.islands))
+      continue;
+    metrics.three_bv = metrics.openings + lonely;
+    if (!_in_3bv_range(templ, &metrics))
+      continue;
+    if (!solver_analyze(scratch, templ->width, templ->height, blessing, &metrics.solver, worker->arena))
+      continue;
+    if (templ->max_tier != SOLVER_TIER_NONE && metrics.solver.max_tier > templ->max_tier)
+      continue;
+
+    /* Only the first match gets to write the result */
+    if (!atomic_exchange(&search->found, true))
+    {
+      minefield_board_copy(search->board, scratch, templ->width, templ->height);
+      search->result->blessing = blessing;
+      search->result->metrics = metrics;
+      search->result->seed = seed;
+      search->result->attempts = attempt + 1;
+      search->result->on_target = true;
+    }
+  }
+
+  board_planes_free(&planes);
+  arena_rewind(worker->arena, mark);
+}
+
+bool generator_generate(const Template *templ, uint64_t seed, Minefield **board, GeneratorResult *result, Arena *scratch)
+{
+  result->on_target = false;
+
+  if (_has_target(templ))
+  {
+    Search search = {.templ = templ, .seed = seed, .board = board, .result = result};
+    atomic_init(&search.next_attempt, 0);
+    atomic_init(&search.found, false);
+    atomic_init(&search.out_of_memory, false);
+
+    uint32_t thread_count = thread_cpu_count();
+    if (thread_count > GENERATOR_MAX_THREADS)
+      thread_count = GENERATOR_MAX_THREADS;
+
+    /* The calling thread works too (with the caller's arena), so only thread_count - 1 extra workers */
+    Thread threads[GENERATOR_MAX_THREADS];
+    Arena arenas[GENERATOR_MAX_THREADS];
+    Worker workers[GENERATOR_MAX_THREADS];
+    uint32_t started = 0;
+    while (started < thread_count - 1)
+    {
+      arena_init(&arenas[started], 0);
+      workers[started] = (Worker){.search = &search, .arena = &arenas[started]};
+      if (!thread_start(&threads[started], _search_worker, &workers[started]))
+        break;
+      started++;
+    }
+
+    Worker caller = {.search = &search, .arena = scratch};
+    _search_worker(&caller);
+    for (uint32_t i = 0; i < started; i++)
+    {
+      thread_join(&threads[i]);
+      arena_free(&arenas[i]);
+    }
+
+    if (result->on_target)
+      return true;
+    if (atomic_load(&search.out_of_memory) && started == 0)
+      return false;
+  }
+
+  /* No range (or nothing matched it), a single board will do */
+  result->seed = seed;
+  result->attempts = _has_target(templ) ? GENERATOR_MAX_ATTEMPTS : 1;
+  result->blessing = generator_fill(board, templ->width, templ->height, templ->bomb_amount, seed, scratch);
+  return metrics_compute(&result->metrics, board, templ->width, templ->height, result->blessing, scratch);
+}
@@ -0,0 +1,65 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "metrics.h"
+#include "../classes/arena.h"
+#include "../classes/minefield.h"
+#include "../classes/templates.h"
+#include "../classes/vec.h"
+
+/*
+ * Attempts (over all threads) before giving up on a template's difficulty range,
+ * the generator then just hands out a board without checking it
+ */
+#define GENERATOR_MAX_ATTEMPTS 20000
+
+typedef struct
+{
+  /* The no guess blessing, -1, -1 if the board has no 0s */
+  Vec2 blessing;
+  BoardMetrics metrics;
+  /* Seed that recreates this exact board through generator_fill */
+  uint64_t seed;
+  /* Boards generated until one matched */
+  uint32_t attempts;
+  /* false if no board in the template's range was found */
+  bool on_target;
+} GeneratorResult;
+
+/**
+ * generator_fill
+ * Places the bombs, their neighbour counts and picks the no guess blessing.
+ * The same seed always gives the same board. The board must be freshly initialized.
+ *
+ * @param board The game board
+ * @param width The width of the board
+ * @param height The height of the board
+ * @param bomb_amount The number of bombs to place
+ * @param seed Seed for the board
+ * @param scratch Arena for the shuffle (given back before returning)
+ * @return The no guess blessing (a random 0), -1, -1 if there are none (or if there was no memory)
+ */
+Vec2 generator_fill(Minefield **board, uint16_t width, uint16_t height, uint16_t bomb_amount, uint64_t seed, Arena *scratch);
+
+/**
+ * generator_generate
+ * Generates a board for the template inside its difficulty range (min_3bv, max_3bv, max_tier).
+ *
+ * When the template has a range, candidates are generated speculatively on every core at once
+ * and the first board that matches wins, the rest of the workers stop right after.
+ * Templates without a range just get a single board, no threads involved.
+ * The calling thread works with the given arena, every extra worker brings its own.
+ *
+ * @param templ Size, bomb amount and difficulty range
+ * @param seed Base seed, attempt N uses seed + N
+ * @param board The board to write the result into (freshly initialized, template sized)
+ * @param result Blessing, metrics and seed of the generated board
+ * @param scratch Arena for the temporary memory (given back before returning)
+ * @return false if memory couldn't be allocated
+ */
+bool generator_generate(const Template *templ, uint64_t seed, Minefield **board, GeneratorResult *result, Arena *scratch);
+
+#endif /* GENERATOR_H */
@@ -33,6 +33,11 @@ void main_menu()
 
   console_foreground_reset();
   printf("| 3. ");
+  console_foreground_set(CC_YELLOW);
+  printf("Watch the Solver Play\n");
+
+  console_foreground_reset();
+  printf("| 4. ");
   console_foreground_set(CC_RED);
   printf("Exit\n");
 
@@ -41,7 +46,7 @@ void main_menu()
   printf("\n");
 }
 
-void template_menu(Template *templates, uint8_t template_count)
+void template_menu(Template *templates, uint8_t template_count, const StatsStore *stats)
 {
   clear_screen();
   console_foreground_set(CC_MAGENTA);
@@ -63,7 +68,24 @@ void template_menu(Template *templates, uint8_t template_count)
 
     printf("%s", templates[i].name);
     console_color_reset();
-    printf(" - (%d x %d), %d bombs\n", templates[i].width, templates[i].height, templates[i].bomb_amount);
+    printf(" - (%d x %d), %d bombs", templates[i].width, templates[i].height, templates[i].bomb_amount);
+
+    /* Straight from the index, no matter how many games were played */
+    const StatsEntry *entry = (stats != NULL) ? stats_find(stats, templates[i].name) : NULL;
+    if (entry != NULL && entry->wins > 0)
+    {
+      console_foreground_set(CC_DARK_GRAY);
+      printf("  best %.1fs, median %.1fs, %u/%u won", entry->best_ms / 1000.0,
+             stats_percentile(entry, 50) / 1000.0, entry->wins, entry->games);
+      console_color_reset();
+    }
+    else if (entry != NULL)
+    {
+      console_foreground_set(CC_DARK_GRAY);
+      printf("  0/%u won", entry->games);
+      console_color_reset();
+    }
+    printf("\n");
   }
 
   printf("\n");
@@ -80,4 +102,20 @@ void custom_menu()
   printf("v 1.0, by @sea2horses\n");
   console_color_reset();
   printf("\n\n");
-}
\ No newline at end of file
+}
+void autoplay_menu()
+{
+  printf("\nHow should the solver play?\n");
+
+  printf("| 1. ");
+  console_foreground_set(CC_YELLOW);
+  printf("Watch it play\n");
+
+  console_foreground_reset();
+  printf("| 2. ");
+  console_foreground_set(CC_YELLOW);
+  printf("Benchmark (drawn vs. headless)\n");
+
+  console_color_reset();
+  printf("\n");
+}
@@ -1,10 +1,13 @@
 #ifndef MENUS_H
 #define MENUS_H
 
+#include "stats.h"
 #include "../classes/templates.h"
 
 void main_menu();
-void template_menu(Template *templates, uint8_t template_count);
+/* The templates, with the best times on them if `stats` isn't NULL */
+void template_menu(Template *templates, uint8_t template_count, const StatsStore *stats);
 void custom_menu();
+void autoplay_menu();
 
 #endif /* MENUS_H */
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include <stdlib.h>
+
+#include "metrics.h"
+
+/* What kind of cell each position is, as far as 3BV is concerned */
+typedef enum
+{
+  CELL_BOMB,
+  CELL_ZERO,
+  CELL_BORDER, /* A number touching a 0, it gets opened for free */
+  CELL_LONELY  /* A number that costs its own click */
+} CellKind;
+
+/* Union-find with path halving */
+static uint32_t _find(uint32_t *parent, uint32_t index)
+{
+  while (parent[index] != index)
+  {
+    parent[index] = parent[parent[index]];
+    index = parent[index];
+  }
+  return index;
+}
+
+static void _union(uint32_t *parent, uint32_t a, uint32_t b)
+{
+  a = _find(parent, a);
+  b = _find(parent, b);
+  /* Always keep the smallest index as root so the result doesn't depend on the order */
+  if (a < b)
+    parent[b] = a;
+  else if (b < a)
+    parent[a] = b;
+}
+
+/*
+ * Sorts every cell out and joins neighbouring 0s (and neighbouring lonely numbers) into groups,
+ * the root of each group is its smallest index
+ */
+static void _label(Minefield **board, uint16_t width, uint16_t height, uint32_t *parent, uint8_t *kind)
+{
+  /* Sort the cells out, numbers start as lonely until a 0 claims them */
+  for (uint16_t i = 0; i < height; i++)
+    for (uint16_t j = 0; j < width; j++)
+    {
+      uint32_t index = i * width + j;
+      parent[index] = index;
+
+      if (board[i][j].has_bomb)
+        kind[index] = CELL_BOMB;
+      else if (board[i][j].bomb_amount == 0)
+        kind[index] = CELL_ZERO;
+      else
+        kind[index] = CELL_LONELY;
+    }
+
+  for (uint16_t i = 0; i < height; i++)
+    for (uint16_t j = 0; j < width; j++)
+    {
+      if (kind[i * width + j] != CELL_ZERO)
+        continue;
+
+      for (int32_t k = -1; k <= 1; k++)
+      {
+        /* Limit detection */
+        if (i + k < 0 || i + k >= height)
+          continue;
+        for (int32_t l = -1; l <= 1; l++)
+        {
+          if (j + l < 0 || j + l >= width)
+            continue;
+
+          uint32_t neighbour = (i + k) * width + (j + l);
+          if (kind[neighbour] == CELL_LONELY)
+            kind[neighbour] = CELL_BORDER;
+        }
+      }
+    }
+
+  /*
+   * Linear labeling pass, every cell only looks at the neighbours that were already visited
+   * (left, up-left, up, up-right), the other four will look back at it later
+   */
+  static const int8_t previous[4][2] = {{-1, 0}, {-1, -1}, {0, -1}, {1, -1}};
+  for (uint16_t i = 0; i < height; i++)
+    for (uint16_t j = 0; j < width; j++)
+    {
+      uint32_t index = i * width + j;
+      if (kind[index] != CELL_ZERO && kind[index] != CELL_LONELY)
+        continue;
+
+      for (uint8_t k = 0; k < 4; k++)
+      {
+        int32_t x = j + previous[k][0];
+        int32_t y = i + previous[k][1];
+        if (x < 0 || x >= width || y < 0)
+          continue;
+
+        uint32_t neighbour = y * width + x;
+        if (kind[neighbour] == kind[index])
+          _union(parent, index, neighbour);
+      }
+    }
+}
+
+bool metrics_compute_3bv(BoardMetrics *metrics, Minefield **board, uint16_t width, uint16_t height, Arena *scratch)
+{
+  const uint32_t total = (uint32_t)width * height;
+  const ArenaMark mark = arena_mark(scratch);
+  uint32_t *parent = arena_alloc(scratch, sizeof(uint32_t) * total);
+  uint8_t *kind = arena_alloc(scratch, sizeof(uint8_t) * total);
+  if (parent == NULL || kind == NULL)
+  {
+    arena_rewind(scratch, mark);
+    return false;
+  }
+
+  _label(board, width, height, parent, kind);
+
+  metrics->three_bv = 0;
+  metrics->openings = 0;
+  metrics->islands = 0;
+
+  for (uint32_t index = 0; index < total; index++)
+  {
+    if (kind[index] == CELL_LONELY)
+    {
+      metrics->three_bv++;
+      if (_find(parent, index) == index)
+        metrics->islands++;
+    }
+    else if (kind[index] == CELL_ZERO && _find(parent, index) == index)
+      metrics->openings++;
+  }
+  metrics->three_bv += metrics->openings;
+
+  arena_rewind(scratch, mark);
+  return true;
+}
+
+bool metrics_label_cells(Minefield **board, uint16_t width, uint16_t height, uint32_t *labels, Arena *scratch)
+{
+  const uint32_t total = (uint32_t)width * height;
+  const ArenaMark mark = arena_mark(scratch);
+  uint8_t *kind = arena_alloc(scratch, sizeof(uint8_t) * total);
+  if (kind == NULL)
+    return false;
+
+  /* The labels array doubles as the union-find parents */
+  _label(board, width, height, labels, kind);
+
+  /* Groups never mix kinds, so overwriting the numbers can't break a 0's chain */
+  for (uint32_t index = 0; index < total; index++)
+  {
+    if (kind[index] == CELL_ZERO)
+      labels[index] = _find(labels, index);
+    else if (kind[index] == CELL_LONELY)
+      labels[index] = METRICS_LABEL_LONELY;
+    else
+      labels[index] = METRICS_LABEL_NONE;
+  }
+
+  arena_rewind(scratch, mark);
+  return true;
+}
+
+bool metrics_compute(BoardMetrics *metrics, Minefield **board, uint16_t width, uint16_t height, Vec2 start, Arena *scratch)
+{
+  return metrics_compute_3bv(metrics, board, width, height, scratch) &&
+         solver_analyze(board, width, height, start, &metrics->solver, scratch);
+}
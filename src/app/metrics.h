@@ -0,0 +1,76 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../classes/arena.h"
+#include "../classes/minefield.h"
+#include "../classes/vec.h"
+#include "solver.h"
+
+/*
+ * How hard a board is
+ *
+ * 3BV:      the minimum amount of clicks needed to clear the board without flags,
+ *           one per opening plus one per number that isn't touching any opening
+ * openings: 8-connected groups of 0s (one click opens the whole group and its border)
+ * islands:  8-connected groups of those lonely numbers
+ */
+typedef struct
+{
+  uint32_t three_bv;
+  uint32_t openings;
+  uint32_t islands;
+  SolverReport solver;
+} BoardMetrics;
+
+/* Values metrics_label_cells gives to cells that aren't part of an opening */
+#define METRICS_LABEL_NONE UINT32_MAX         /* Bombs and numbers opened by an opening */
+#define METRICS_LABEL_LONELY (UINT32_MAX - 1) /* Numbers that cost a click of their own */
+
+/**
+ * metrics_label_cells
+ * Writes, for every cell (y * width + x), the opening it belongs to (the index of the opening's
+ * first cell, same for all its 0s) or one of the METRICS_LABEL values above.
+ *
+ * @param board The game board (bombs and bomb amounts must already be generated)
+ * @param width The width of the board
+ * @param height The height of the board
+ * @param labels Array of width * height labels to fill
+ * @param scratch Arena for the temporary memory (given back before returning)
+ * @return false if memory couldn't be allocated
+ */
+bool metrics_label_cells(Minefield **board, uint16_t width, uint16_t height, uint32_t *labels, Arena *scratch);
+
+/**
+ * metrics_compute_3bv
+ * Only the union-find labeling pass (3BV, openings and islands), the solver report is left untouched.
+ * It's a lot cheaper than the full metrics_compute, so generators can reject boards with it first
+ * (board_planes_3bv counts the same on bit planes, even faster, that's the one the generator uses).
+ *
+ * @param metrics Where to write the results
+ * @param board The game board (bombs and bomb amounts must already be generated)
+ * @param width The width of the board
+ * @param height The height of the board
+ * @param scratch Arena for the temporary memory (given back before returning)
+ * @return false if memory couldn't be allocated
+ */
+bool metrics_compute_3bv(BoardMetrics *metrics, Minefield **board, uint16_t width, uint16_t height, Arena *scratch);
+
+/**
+ * metrics_compute
+ * Labels openings and islands with a single union-find pass over the board, then
+ * lets the solver play it from `start` to get the tier breakdown.
+ *
+ * @param metrics Where to write the results
+ * @param board The game board (bombs and bomb amounts must already be generated)
+ * @param width The width of the board
+ * @param height The height of the board
+ * @param start The first cell the player will click (usually the no guess blessing)
+ * @param scratch Arena for the temporary memory (given back before returning)
+ * @return false if memory couldn't be allocated
+ */
+bool metrics_compute(BoardMetrics *metrics, Minefield **board, uint16_t width, uint16_t height, Vec2 start, Arena *scratch);
+
+#endif /* METRICS_H */
@@ -0,0 +1,588 @@
+/**
+ * sampler.c
+ * Monte Carlo estimate of the bomb chances on the frontier.
+ *
+ * A chain's layout always fits every number. A move takes a block of up to SAMPLER_BLOCK variables
+ * of a component (all of it if it's small enough, otherwise the ones a breadth first search from
+ * a random one gets to first), finds every way of laying bombs out on it that fits with everything
+ * else as it is, and picks one of them. A way is as likely as the ways the interior can hold the
+ * bombs it leaves, so that's what picking one weighs them by (Gibbs sampling, one block at a time).
+ *
+ * Layouts that only differ on more variables at once than a block holds (a long chain of 50/50s,
+ * say) can't be moved between, every thread starts off from a random one of its own though. The
+ * layout is counted once per sweep (enough moves to get to every variable twice on average).
+ */
+#include "sampler.h"
+#include "../classes/rng.h"
+
+/* Variables a move lays bombs out on */
+#define SAMPLER_BLOCK 16
+/* Ways a block can be laid out at most, a move with more than that does nothing */
+#define SAMPLER_WAYS 4096
+/* Variables set per variable of a component before searching for a first layout of it starts over */
+#define SAMPLER_SEARCH 1024
+/* How much less likely a layout gets per bomb the interior can't take (or is short of) */
+#define SAMPLER_COOL 0.15
+/* Layouts counted between publishing them */
+#define SAMPLER_BATCH 32
+/* 1.96 squared, for 95% intervals */
+#define SAMPLER_Z2 3.8416
+
+struct SamplerWorker
+{
+  Sampler *sampler;
+  Rng rng;
+  /* Current layout: a bomb or not per variable, bombs around every equation, and bombs on the frontier */
+  uint8_t *bombs;
+  uint8_t *counts;
+  uint32_t placed;
+  /* How many bombs the interior is short of room for (or has too few), it's only counted when 0 */
+  uint32_t range;
+  /* Variables of every equation not set yet, all 0 between moves */
+  uint8_t *open;
+  /* The move's block, the ways it can be laid out, and how likely each amount of bombs on it is */
+  uint32_t block[SAMPLER_BLOCK];
+  uint32_t block_size;
+  uint16_t ways[SAMPLER_WAYS];
+  uint32_t way_count;
+  double weights[SAMPLER_BLOCK + 1];
+  /* Counted since the last publish */
+  uint32_t *hits;
+  uint64_t interior_hits;
+  uint32_t samples;
+  Thread thread;
+};
+
+static double _uniform(Rng *rng)
+{
+  return (rng_next(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* No libm here, Newton's method is plenty for margins */
+static double _root(double value)
+{
+  if (value <= 0)
+    return 0;
+
+  double root = (value > 1) ? value : 1;
+  for (int32_t i = 0; i < 64; i++)
+  {
+    double next = (root + value / root) / 2;
+    if (next >= root)
+      break;
+    root = next;
+  }
+  return root;
+}
+
+/* How far the bombs left for the interior are from fitting in it */
+static uint32_t _range(const Sampler *sampler, uint32_t placed)
+{
+  const int64_t left = (int64_t)sampler->bombs - placed;
+  return (left < 0) ? -left : (left > sampler->interior_count) ? left - sampler->interior_count : 0;
+}
+
+/*
+ * How much likelier a layout gets with one more bomb on the frontier: C(interior, left - 1) / C(interior, left),
+ * out of range it's all SAMPLER_COOL (the ways at either end are 1)
+ */
+static double _one_more(const Sampler *sampler, uint32_t placed)
+{
+  const uint32_t before = _range(sampler, placed), after = _range(sampler, placed + 1);
+  const int64_t left = (int64_t)sampler->bombs - placed;
+
+  if (before == 0 && after == 0)
+    return (double)left / (sampler->interior_count - left + 1);
+  return (after > before) ? SAMPLER_COOL : 1 / SAMPLER_COOL;
+}
+
+static void _toggle(SamplerWorker *worker, uint32_t variable)
+{
+  const Sampler *sampler = worker->sampler;
+  const int32_t step = worker->bombs[variable] ? -1 : 1;
+
+  worker->bombs[variable] ^= 1;
+  worker->placed += step;
+  worker->range = _range(sampler, worker->placed);
+  for (uint8_t i = 0; i < sampler->variable_equation_counts[variable]; i++)
+    worker->counts[sampler->variable_equations[variable * 8 + i]] += step;
+}
+
+/*
+ * Sets a variable (bomb or not) on top of what's set already and tells if every number around it
+ * can still fit, `open` has to count it as not set yet
+ */
+static bool _set(SamplerWorker *worker, uint32_t variable, uint8_t bomb)
+{
+  const Sampler *sampler = worker->sampler;
+  const uint32_t *equations = &sampler->variable_equations[variable * 8];
+  bool fits = true;
+
+  if (bomb)
+    _toggle(worker, variable);
+  for (uint8_t i = 0; i < sampler->variable_equation_counts[variable]; i++)
+  {
+    const uint32_t equation = equations[i];
+    worker->open[equation]--;
+    fits = fits && worker->counts[equation] <= sampler->equation_bombs[equation] &&
+           worker->counts[equation] + worker->open[equation] >= sampler->equation_bombs[equation];
+  }
+  return fits;
+}
+
+static void _unset(SamplerWorker *worker, uint32_t variable, uint8_t bomb)
+{
+  const Sampler *sampler = worker->sampler;
+
+  for (uint8_t i = 0; i < sampler->variable_equation_counts[variable]; i++)
+    worker->open[sampler->variable_equations[variable * 8 + i]]++;
+  if (bomb)
+    _toggle(worker, variable);
+}
+
+/* Every way of laying the block out from its variable `index` on, bit i for block[i] */
+static bool _ways(SamplerWorker *worker, uint32_t index, uint16_t way)
+{
+  if (index == worker->block_size)
+  {
+    if (worker->way_count == SAMPLER_WAYS)
+      return false;
+    worker->ways[worker->way_count++] = way;
+    return true;
+  }
+
+  for (uint8_t bomb = 0; bomb <= 1; bomb++)
+  {
+    const bool within = !_set(worker, worker->block[index], bomb) || _ways(worker, index + 1, way | bomb << index);
+    _unset(worker, worker->block[index], bomb);
+    if (!within)
+      return false;
+  }
+  return true;
+}
+
+/* The block: the whole component, or SAMPLER_BLOCK variables around one of it (the block is the search's queue) */
+static void _pick_block(SamplerWorker *worker, uint32_t variable)
+{
+  const Sampler *sampler = worker->sampler;
+  const uint32_t component = sampler->variable_component[variable];
+  const uint32_t first = sampler->components[component], size = sampler->components[component + 1] - first;
+
+  if (size <= SAMPLER_BLOCK)
+  {
+    for (uint32_t i = 0; i < size; i++)
+      worker->block[i] = sampler->component_variables[first + i];
+    worker->block_size = size;
+    return;
+  }
+
+  worker->block[0] = variable;
+  worker->block_size = 1;
+  for (uint32_t head = 0; head < worker->block_size && worker->block_size < SAMPLER_BLOCK; head++)
+  {
+    const uint32_t *equations = &sampler->variable_equations[worker->block[head] * 8];
+    for (uint8_t j = 0; j < sampler->variable_equation_counts[worker->block[head]] && worker->block_size < SAMPLER_BLOCK; j++)
+      for (uint8_t k = 0; k < sampler->equation_sizes[equations[j]] && worker->block_size < SAMPLER_BLOCK; k++)
+      {
+        const uint32_t next = sampler->equation_variables[equations[j] * 8 + k];
+        uint32_t i = 0;
+        while (i < worker->block_size && worker->block[i] != next)
+          i++;
+        if (i == worker->block_size)
+          worker->block[worker->block_size++] = next;
+      }
+  }
+}
+
+/* Lays a block around a random variable out again */
+static void _move(SamplerWorker *worker)
+{
+  const Sampler *sampler = worker->sampler;
+  _pick_block(worker, rng_below(&worker->rng, sampler->frontier_count));
+
+  /* The block comes off the board, every way is then laid on top of the rest */
+  uint16_t current = 0;
+  for (uint32_t i = 0; i < worker->block_size; i++)
+  {
+    const uint32_t variable = worker->block[i];
+    current |= worker->bombs[variable] << i;
+    _unset(worker, variable, worker->bombs[variable]);
+  }
+
+  worker->way_count = 0;
+  uint16_t picked = current;
+  if (_ways(worker, 0, 0))
+  {
+    /* Weights relative to no bomb on the block */
+    worker->weights[0] = 1;
+    for (uint32_t m = 0; m < worker->block_size; m++)
+      worker->weights[m + 1] = worker->weights[m] * _one_more(sampler, worker->placed + m);
+
+    double total = 0;
+    for (uint32_t i = 0; i < worker->way_count; i++)
+      total += worker->weights[__builtin_popcount(worker->ways[i])];
+    double left = _uniform(&worker->rng) * total;
+    for (uint32_t i = 0; i < worker->way_count; i++)
+    {
+      picked = worker->ways[i];
+      left -= worker->weights[__builtin_popcount(picked)];
+      if (left < 0)
+        break;
+    }
+  }
+
+  /* Back on the board, it fits since every way does */
+  for (uint32_t i = 0; i < worker->block_size; i++)
+    _set(worker, worker->block[i], picked >> i & 1);
+}
+
+/*
+ * Depth first search for a first layout of the component, from its variable `index` on, bombs or not
+ * tried in a random order so every thread starts off somewhere else
+ * @param budget Variables it may still set, it gives up (and undoes everything) once it's out
+ */
+static bool _search(SamplerWorker *worker, uint32_t component, uint32_t index, uint32_t *budget)
+{
+  const Sampler *sampler = worker->sampler;
+  const uint32_t first = sampler->components[component];
+  if (first + index == sampler->components[component + 1])
+    return true;
+  if (*budget == 0)
+    return false;
+  (*budget)--;
+
+  const uint32_t variable = sampler->component_variables[first + index];
+  const uint8_t bomb_first = rng_next(&worker->rng) & 1;
+  for (uint8_t bomb = 0; bomb <= 1; bomb++)
+  {
+    if (_set(worker, variable, bomb ^ bomb_first) && _search(worker, component, index + 1, budget))
+      return true;
+    _unset(worker, variable, bomb ^ bomb_first);
+  }
+  return false;
+}
+
+/*
+ * Searches every component for a layout that fits, the bombs left may not fit the interior yet
+ * but moves get them there
+ * @return false if it was stopped first
+ */
+static bool _fit(SamplerWorker *worker)
+{
+  const Sampler *sampler = worker->sampler;
+
+  for (uint32_t e = 0; e < sampler->equation_count; e++)
+    worker->open[e] = sampler->equation_sizes[e];
+
+  /* Every variable of the component gets set, that leaves `open` at 0 for its equations */
+  for (uint32_t c = 0; c < sampler->component_count; c++)
+  {
+    uint32_t budget = (sampler->components[c + 1] - sampler->components[c]) * SAMPLER_SEARCH;
+    while (!_search(worker, c, 0, &budget))
+    {
+      if (atomic_load_explicit(&sampler->stop, memory_order_relaxed))
+        return false;
+      budget = (sampler->components[c + 1] - sampler->components[c]) * SAMPLER_SEARCH;
+    }
+  }
+  return true;
+}
+
+/* Whether every estimate is within SAMPLER_MARGIN (or there's been enough samples anyway) */
+static bool _converged(const Sampler *sampler)
+{
+  const uint64_t samples = atomic_load(&sampler->samples);
+  if (samples >= SAMPLER_MAX_SAMPLES)
+    return true;
+  if (samples == 0)
+    return false;
+
+  /* The widest interval is the one closest to 50% */
+  double widest = 0;
+  for (uint32_t i = 0; i <= sampler->frontier_count; i++)
+  {
+    double chance = (i < sampler->frontier_count) ? (double)atomic_load(&sampler->hits[i]) / samples
+                    : (sampler->interior_count > 0) ? (double)atomic_load(&sampler->interior_hits) / samples / sampler->interior_count
+                                                    : 0;
+    chance = (chance > 1) ? 1 : chance;
+    if (chance * (1 - chance) > widest)
+      widest = chance * (1 - chance);
+  }
+  return SAMPLER_Z2 * widest / samples <= SAMPLER_MARGIN * SAMPLER_MARGIN;
+}
+
+static void _publish(SamplerWorker *worker)
+{
+  Sampler *sampler = worker->sampler;
+
+  /* Hits before samples, so a chance read in between is never over 1 for long */
+  for (uint32_t i = 0; i < sampler->frontier_count; i++)
+    if (worker->hits[i] != 0)
+    {
+      atomic_fetch_add_explicit(&sampler->hits[i], worker->hits[i], memory_order_relaxed);
+      worker->hits[i] = 0;
+    }
+  atomic_fetch_add_explicit(&sampler->interior_hits, worker->interior_hits, memory_order_relaxed);
+  atomic_fetch_add_explicit(&sampler->samples, worker->samples, memory_order_release);
+  worker->interior_hits = 0;
+  worker->samples = 0;
+
+  if (_converged(sampler))
+    atomic_store(&sampler->stop, true);
+}
+
+static void _sample(void *arg)
+{
+  SamplerWorker *worker = arg;
+  Sampler *sampler = worker->sampler;
+  const uint32_t count = sampler->frontier_count, moves = 2 * count / SAMPLER_BLOCK + 1;
+
+  if (!_fit(worker))
+    return;
+
+  while (!atomic_load_explicit(&sampler->stop, memory_order_relaxed))
+  {
+    for (uint32_t i = 0; i < moves; i++)
+      _move(worker);
+    if (worker->range != 0)
+      continue;
+
+    for (uint32_t i = 0; i < count; i++)
+      worker->hits[i] += worker->bombs[i];
+    worker->interior_hits += sampler->bombs - worker->placed;
+    if (++worker->samples == SAMPLER_BATCH)
+      _publish(worker);
+  }
+}
+
+/*
+ * Groups the variables by component, in the order a breadth first search from the first one of each
+ * gets to them (a number's variables end up close together, which is what searching them wants)
+ */
+static bool _find_components(Sampler *sampler)
+{
+  const uint32_t count = sampler->frontier_count;
+  Arena *arena = &sampler->arena;
+
+  sampler->variable_component = arena_alloc(arena, sizeof(uint32_t) * (count + 1));
+  sampler->component_variables = arena_alloc(arena, sizeof(uint32_t) * (count + 1));
+  sampler->components = arena_alloc(arena, sizeof(uint32_t) * (count + 2));
+  if (sampler->variable_component == NULL || sampler->component_variables == NULL || sampler->components == NULL)
+    return false;
+
+  for (uint32_t i = 0; i < count; i++)
+    sampler->variable_component[i] = UINT32_MAX;
+
+  /* The component's variables are the search's queue */
+  uint32_t end = 0;
+  sampler->component_count = 0;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    if (sampler->variable_component[i] != UINT32_MAX)
+      continue;
+
+    const uint32_t component = sampler->component_count++;
+    sampler->components[component] = end;
+    sampler->variable_component[i] = component;
+    sampler->component_variables[end++] = i;
+
+    for (uint32_t head = sampler->components[component]; head < end; head++)
+    {
+      const uint32_t variable = sampler->component_variables[head];
+      for (uint8_t j = 0; j < sampler->variable_equation_counts[variable]; j++)
+      {
+        const uint32_t equation = sampler->variable_equations[variable * 8 + j];
+        for (uint8_t k = 0; k < sampler->equation_sizes[equation]; k++)
+        {
+          const uint32_t next = sampler->equation_variables[equation * 8 + k];
+          if (sampler->variable_component[next] != UINT32_MAX)
+            continue;
+          sampler->variable_component[next] = component;
+          sampler->component_variables[end++] = next;
+        }
+      }
+    }
+  }
+  sampler->components[sampler->component_count] = end;
+  return true;
+}
+
+/* Reads the frontier and the equations off what's shown */
+static bool _read_board(Sampler *sampler, Minefield **board, uint16_t bomb_amount)
+{
+  const uint16_t width = sampler->width, height = sampler->height;
+  const uint32_t total = (uint32_t)width * height;
+  Arena *arena = &sampler->arena;
+
+  sampler->variable = arena_alloc(arena, sizeof(uint32_t) * total);
+  sampler->frontier = arena_alloc(arena, sizeof(uint32_t) * total);
+  sampler->equation_variables = arena_alloc(arena, sizeof(uint32_t) * total * 8);
+  sampler->equation_sizes = arena_alloc(arena, total);
+  sampler->equation_bombs = arena_alloc(arena, total);
+  sampler->variable_equations = arena_alloc(arena, sizeof(uint32_t) * total * 8);
+  sampler->variable_equation_counts = arena_calloc(arena, total, 1);
+  if (sampler->variable == NULL || sampler->frontier == NULL || sampler->equation_variables == NULL || sampler->equation_sizes == NULL ||
+      sampler->equation_bombs == NULL || sampler->variable_equations == NULL || sampler->variable_equation_counts == NULL)
+    return false;
+
+  /* Shown bombs (a lost game) are out of the count, the rest are somewhere under the covered cells */
+  sampler->bombs = bomb_amount;
+  for (uint32_t index = 0; index < total; index++)
+  {
+    const Minefield *field = &board[index / width][index % width];
+    sampler->variable[index] = field->is_mined ? SAMPLER_SHOWN : SAMPLER_INTERIOR;
+    sampler->bombs -= field->is_mined && field->has_bomb;
+  }
+
+  sampler->frontier_count = 0;
+  sampler->equation_count = 0;
+  for (uint32_t index = 0; index < total; index++)
+  {
+    const Minefield *field = &board[index / width][index % width];
+    if (!field->is_mined || field->has_bomb || field->bomb_amount == 0)
+      continue;
+
+    const int32_t x = index % width, y = index / width;
+    const uint32_t equation = sampler->equation_count;
+    uint8_t size = 0, bombs = field->bomb_amount;
+
+    for (int32_t i = -1; i <= 1; i++)
+    {
+      /* Limit detection */
+      if (y + i < 0 || y + i >= height)
+        continue;
+      for (int32_t j = -1; j <= 1; j++)
+      {
+        /* Limit detection */
+        if (x + j < 0 || x + j >= width || (i == 0 && j == 0))
+          continue;
+
+        const Minefield *neighbour = &board[y + i][x + j];
+        uint32_t *variable = &sampler->variable[(y + i) * width + (x + j)];
+        if (neighbour->is_mined)
+        {
+          bombs -= neighbour->has_bomb;
+          continue;
+        }
+
+        if (*variable == SAMPLER_INTERIOR)
+        {
+          *variable = sampler->frontier_count;
+          sampler->frontier[sampler->frontier_count++] = (y + i) * width + (x + j);
+        }
+        sampler->equation_variables[equation * 8 + size++] = *variable;
+        sampler->variable_equations[*variable * 8 + sampler->variable_equation_counts[*variable]++] = equation;
+      }
+    }
+
+    if (size == 0)
+      continue;
+    sampler->equation_sizes[equation] = size;
+    sampler->equation_bombs[equation] = bombs;
+    sampler->equation_count++;
+  }
+
+  sampler->interior_count = 0;
+  for (uint32_t index = 0; index < total; index++)
+    sampler->interior_count += sampler->variable[index] == SAMPLER_INTERIOR;
+  return _find_components(sampler);
+}
+
+bool sampler_start(Sampler *sampler, Minefield **board, uint16_t width, uint16_t height, uint16_t bomb_amount, uint32_t threads,
+                   uint64_t seed)
+{
+  sampler->width = width;
+  sampler->height = height;
+  sampler->thread_count = 0;
+  sampler->workers = NULL;
+  atomic_init(&sampler->samples, 0);
+  atomic_init(&sampler->interior_hits, 0);
+  atomic_init(&sampler->stop, false);
+  arena_init(&sampler->arena, 0);
+
+  if (!_read_board(sampler, board, bomb_amount) ||
+      (sampler->hits = arena_calloc(&sampler->arena, sampler->frontier_count + 1, sizeof(atomic_uint_fast64_t))) == NULL)
+  {
+    arena_free(&sampler->arena);
+    return false;
+  }
+  for (uint32_t i = 0; i < sampler->frontier_count; i++)
+    atomic_init(&sampler->hits[i], 0);
+
+  /* Nothing next to a number, every covered cell is as likely as the next */
+  if (sampler->frontier_count == 0)
+  {
+    atomic_store(&sampler->samples, 1);
+    atomic_store(&sampler->interior_hits, sampler->bombs);
+    atomic_store(&sampler->stop, true);
+    return true;
+  }
+
+  threads = (threads > SAMPLER_MAX_THREADS) ? SAMPLER_MAX_THREADS : (threads == 0) ? 1 : threads;
+  sampler->workers = arena_calloc(&sampler->arena, threads, sizeof(SamplerWorker));
+  if (sampler->workers == NULL)
+  {
+    arena_free(&sampler->arena);
+    return false;
+  }
+
+  for (uint32_t i = 0; i < threads; i++)
+  {
+    SamplerWorker *worker = &sampler->workers[i];
+    worker->sampler = sampler;
+    rng_seed(&worker->rng, seed + i * 0x9E3779B97F4A7C15ull);
+    worker->bombs = arena_calloc(&sampler->arena, sampler->frontier_count, 1);
+    worker->counts = arena_calloc(&sampler->arena, sampler->equation_count + 1, 1);
+    worker->open = arena_alloc(&sampler->arena, sampler->equation_count + 1);
+    worker->hits = arena_calloc(&sampler->arena, sampler->frontier_count, sizeof(uint32_t));
+    if (worker->bombs == NULL || worker->counts == NULL || worker->open == NULL || worker->hits == NULL)
+      break;
+
+    worker->range = _range(sampler, 0);
+    if (!thread_start(&worker->thread, _sample, worker))
+      break;
+    sampler->thread_count++;
+  }
+
+  /* Without any thread there's nothing to wait for */
+  if (sampler->thread_count == 0)
+    atomic_store(&sampler->stop, true);
+  return true;
+}
+
+void sampler_stop(Sampler *sampler)
+{
+  atomic_store(&sampler->stop, true);
+  for (uint32_t i = 0; i < sampler->thread_count; i++)
+    thread_join(&sampler->workers[i].thread);
+  sampler->thread_count = 0;
+  arena_free(&sampler->arena);
+}
+
+bool sampler_estimate(const Sampler *sampler, uint16_t x, uint16_t y, double *chance, double *margin)
+{
+  const uint64_t samples = atomic_load_explicit(&sampler->samples, memory_order_acquire);
+  const uint32_t variable = sampler->variable[(uint32_t)y * sampler->width + x];
+  if (variable == SAMPLER_SHOWN || samples == 0)
+    return false;
+
+  if (variable == SAMPLER_INTERIOR)
+    *chance = (double)atomic_load(&sampler->interior_hits) / samples / sampler->interior_count;
+  else
+    *chance = (double)atomic_load(&sampler->hits[variable]) / samples;
+  *chance = (*chance > 1) ? 1 : *chance;
+
+  /* Nothing to sample, it's exact */
+  *margin = (sampler->frontier_count == 0) ? 0 : _root(SAMPLER_Z2 * *chance * (1 - *chance) / samples);
+  return true;
+}
+
+uint64_t sampler_samples(const Sampler *sampler)
+{
+  return atomic_load(&sampler->samples);
+}
+
+bool sampler_done(const Sampler *sampler)
+{
+  return atomic_load(&sampler->stop);
+}
@@ -0,0 +1,103 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../classes/arena.h"
+#include "../classes/minefield.h"
+#include "../utils/threads.h"
+
+#define SAMPLER_MAX_THREADS 32
+/* Estimates are done once every cell's 95% interval is at most this far each way */
+#define SAMPLER_MARGIN 0.01
+/* Sampling stops there even if they aren't */
+#define SAMPLER_MAX_SAMPLES (1u << 22)
+
+typedef struct SamplerWorker SamplerWorker;
+
+/*
+ * Chances of every covered cell being a bomb, as far as what's shown and the amount of bombs tell,
+ * for boards way too big to count every way the bombs could be laid out.
+ *
+ * Covered cells next to a shown number (the frontier) are sampled: every thread runs its own chain
+ * of bomb layouts that fit all the numbers (see sampler.c), with its own random stream, and adds
+ * them to the counts. The other covered cells are all alike, only how many bombs they have is counted.
+ * Flags aren't trusted, a flagged cell is just covered.
+ *
+ * The threads keep going in the background (estimates get better as they do) until every estimate
+ * is within SAMPLER_MARGIN, sampler_stop, or SAMPLER_MAX_SAMPLES.
+ */
+typedef struct
+{
+  uint16_t width;
+  uint16_t height;
+  /* Bombs on covered cells, and covered cells next to no number */
+  uint32_t bombs;
+  uint32_t interior_count;
+
+  /* Variable of every cell: its index in `frontier`, SAMPLER_SHOWN or SAMPLER_INTERIOR */
+  uint32_t *variable;
+  uint32_t *frontier;
+  uint32_t frontier_count;
+
+  /* Every shown number with covered neighbours: the variables around it and the bombs they have */
+  uint32_t equation_count;
+  uint32_t *equation_variables;
+  uint8_t *equation_sizes;
+  uint8_t *equation_bombs;
+  /* Equations of every variable (8 at most) */
+  uint32_t *variable_equations;
+  uint8_t *variable_equation_counts;
+
+  /*
+   * Variables sharing numbers (directly or not), each component's are in `component_variables` from
+   * `components[c]` to `components[c + 1]`, in the order a breadth first search gets to them
+   */
+  uint32_t component_count;
+  uint32_t *components;
+  uint32_t *component_variables;
+  uint32_t *variable_component;
+
+  /* Layouts counted, times each variable had a bomb in them, and bombs on interior cells in all of them */
+  atomic_uint_fast64_t samples;
+  atomic_uint_fast64_t *hits;
+  atomic_uint_fast64_t interior_hits;
+  atomic_bool stop;
+
+  SamplerWorker *workers;
+  uint32_t thread_count;
+  Arena arena;
+} Sampler;
+
+#define SAMPLER_SHOWN UINT32_MAX
+#define SAMPLER_INTERIOR (UINT32_MAX - 1)
+
+/**
+ * sampler_start
+ * Reads what's shown on the board and starts sampling on `threads` threads (this one doesn't sample)
+ * @param seed Where the random streams start from, every thread gets its own
+ * @return false if memory couldn't be allocated, nothing needs to be stopped then
+ */
+bool sampler_start(Sampler *sampler, Minefield **board, uint16_t width, uint16_t height, uint16_t bomb_amount, uint32_t threads,
+                   uint64_t seed);
+
+/* Stops the threads and frees everything */
+void sampler_stop(Sampler *sampler);
+
+/**
+ * sampler_estimate
+ * Chance of (x, y) having a bomb so far, and how far off it could be (half of its 95% interval,
+ * layouts in a row look alike so it's on the optimistic side)
+ * @return false if the cell is shown or nothing was counted yet
+ */
+bool sampler_estimate(const Sampler *sampler, uint16_t x, uint16_t y, double *chance, double *margin);
+
+/* Layouts counted so far */
+uint64_t sampler_samples(const Sampler *sampler);
+
+/* Whether sampling is over (converged, stopped or out of samples) */
+bool sampler_done(const Sampler *sampler);
+
+#endif /* SAMPLER_H */
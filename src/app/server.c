@@ -0,0 +1,771 @@
+/**
+ * server.c
+ * Multi-session server, one process hosting a game for every connection.
+ *
+ * Everything runs on a single epoll loop: every session has its own Game and its own
+ * output Buffer, the console functions are pointed at that buffer while the session is
+ * being drawn (see console_set_output). Sessions only draw when something happened to them
+ * (a key arrived or their timer changed), and their buffers are written out without ever
+ * blocking, so a slow client can't stall anyone else.
+ *
+ * In coop mode every session plays on the same shared board (see coop.h) instead: after
+ * handling the events of a loop, every session draws whatever the others changed.
+ *
+ * Boards are never generated on the loop, the generator can take tens of milliseconds to find one
+ * in the template's range: a thread of its own keeps a few of them ready (see BoardPool) and rings
+ * an eventfd every time there's a new one. Sessions that connect while there's none wait on a
+ * "generating" screen, and get theirs in the order they came.
+ */
+#ifdef __linux__
+/* accept4 */
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+
+#include "server.h"
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "coop.h"
+#include "game.h"
+#include "generator.h"
+#include "../classes/buffer.h"
+#include "../utils/consoleutils.h"
+#include "../utils/input.h"
+#include "../utils/profile.h"
+#include "../utils/threads.h"
+#include "../utils/timer.h"
+
+#define SERVER_MAX_EVENTS 256
+#define SERVER_BACKLOG 512
+/* Clients that stop reading get dropped once this much output piles up */
+#define SERVER_MAX_PENDING_OUTPUT (1 << 20)
+/* Input is decoded in pieces of this size (an incomplete escape sequence is at most 2 bytes) */
+#define SERVER_INPUT_SIZE 64
+/* Boards the generator thread keeps ready */
+#define SERVER_POOL_SIZE 8
+
+typedef struct Session
+{
+  int fd;
+  Game game;
+  Buffer output;
+  /* What the client's terminal has set (colors, cursor), for the shortest escapes */
+  ConsoleState console;
+  /* Input waiting to be decoded (leftovers of an incomplete escape sequence) */
+  unsigned char input[SERVER_INPUT_SIZE];
+  size_t input_length;
+  /* The game is over, close as soon as the last frame is sent */
+  bool closing;
+  /* Whether `game` was set up, sessions start out waiting for a board */
+  bool started;
+  /* Whether epoll is also waiting for the socket to be writable */
+  bool want_write;
+  /* Destroyed, only freed once the loop is done with the events it got (see dead_sessions) */
+  bool dead;
+  /* The session's timer deadline on the scheduler (0 if it has none) and when it is */
+  uint32_t deadline;
+  uint64_t deadline_at;
+  /* Every session is on this list, for the timer */
+  struct Session *prev;
+  struct Session *next;
+  /* Next session waiting for a board, see waiting_first */
+  struct Session *next_waiting;
+} Session;
+
+/*
+ * Boards generated ahead of time: only what generator_generate said about them is kept,
+ * game_init_generated (or generator_fill for the shared board) gets the board back from its seed
+ */
+typedef struct
+{
+  pthread_mutex_t lock;
+  /* The thread waits on it while the pool is full */
+  pthread_cond_t wake;
+  GeneratorResult ready[SERVER_POOL_SIZE];
+  uint32_t ready_count;
+  /* Base seed of the next board, every board gets GENERATOR_MAX_ATTEMPTS of them */
+  uint64_t seed;
+  const Template *templ;
+  /* Written to every time a board is ready, the loop waits on it */
+  int event_fd;
+  bool stop;
+  Thread thread;
+} BoardPool;
+
+static Session *sessions = NULL;
+static uint32_t session_count = 0;
+/*
+ * Sessions destroyed while handling the loop's events: a later event of the same batch can still point
+ * at one (anything that flushes a session can destroy it), so they're freed once all of them were handled
+ */
+static Session *dead_sessions = NULL;
+/* Every session's next timer redraw */
+static Scheduler scheduler;
+/* For the deadlines, which don't get it as an argument */
+static int server_epoll_fd;
+/* Tags for the listening socket and the pool's eventfd on epoll events (sessions use their own pointer) */
+static int listener_tag;
+static int pool_tag;
+static BoardPool pool;
+/* Sessions waiting for a board, first come first served */
+static Session *waiting_first = NULL;
+static Session *waiting_last = NULL;
+/* Where finished games are written down, NULL if they aren't */
+static StatsStore *server_stats = NULL;
+
+/* A shared board, what the generator said about it, and its memory */
+typedef struct
+{
+  bool ready;
+  CoopBoard board;
+  GeneratorResult generated;
+  Arena arena;
+} CoopSlot;
+
+/*
+ * Coop mode: new sessions join coop_slots[coop_current], the other one keeps the last board that
+ * ended until the players watching it end have left
+ */
+static bool coop_mode = false;
+static CoopSlot coop_slots[2];
+static uint32_t coop_current = 0;
+
+static int _listen(const char *address)
+{
+  int fd;
+
+  if (strncmp(address, "unix:", 5) == 0)
+  {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(address + 5) >= sizeof(addr.sun_path))
+    {
+      fprintf(stderr, "Socket path too long: %s\n", address + 5);
+      return -1;
+    }
+    strcpy(addr.sun_path, address + 5);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    /* Leftover socket file from a previous run */
+    unlink(addr.sun_path);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+      perror("bind");
+      if (fd >= 0)
+        close(fd);
+      return -1;
+    }
+  }
+  else if (strncmp(address, "tcp:", 4) == 0)
+  {
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(atoi(address + 4))};
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int yes = 1;
+    if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)) < 0 ||
+        bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+      perror("bind");
+      if (fd >= 0)
+        close(fd);
+      return -1;
+    }
+  }
+  else
+  {
+    fprintf(stderr, "Unknown address '%s', use unix:<path> or tcp:<port>\n", address);
+    return -1;
+  }
+
+  if (listen(fd, SERVER_BACKLOG) < 0)
+  {
+    perror("listen");
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/*
+BOARD POOL
+*/
+
+/* Fills the pool up, then sleeps until a board gets taken */
+static void _pool_worker(void *arg)
+{
+  BoardPool *pool = arg;
+  const Template *templ = pool->templ;
+  Arena arena;
+  arena_init(&arena, 0);
+
+  pthread_mutex_lock(&pool->lock);
+  while (!pool->stop)
+  {
+    if (pool->ready_count == SERVER_POOL_SIZE)
+    {
+      pthread_cond_wait(&pool->wake, &pool->lock);
+      continue;
+    }
+
+    const uint64_t seed = pool->seed;
+    pool->seed += GENERATOR_MAX_ATTEMPTS;
+    pthread_mutex_unlock(&pool->lock);
+
+    GeneratorResult generated;
+    arena_reset(&arena);
+    const uint64_t started_at = profile_start();
+    Minefield **board = minefield_board_alloc(templ->width, templ->height, &arena);
+    const bool generated_ok = board != NULL && generator_generate(templ, seed, board, &generated, &arena);
+    profile_stop(PROFILE_GENERATE, started_at);
+    /* Out of memory, give the sessions some time to give it back */
+    if (!generated_ok)
+      csleep(0.1);
+
+    pthread_mutex_lock(&pool->lock);
+    if (generated_ok)
+    {
+      pool->ready[pool->ready_count++] = generated;
+      eventfd_write(pool->event_fd, 1);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  arena_free(&arena);
+}
+
+/* Starts the generator thread, returns false if it couldn't be */
+static bool _pool_start(BoardPool *pool, const Template *templ)
+{
+  pool->templ = templ;
+  pool->ready_count = 0;
+  pool->seed = (uint64_t)time(0) << 32;
+  pool->stop = false;
+  pool->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (pool->event_fd < 0)
+    return false;
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->wake, NULL);
+  if (!thread_start(&pool->thread, _pool_worker, pool))
+  {
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    close(pool->event_fd);
+    return false;
+  }
+  return true;
+}
+
+static void _pool_stop(BoardPool *pool)
+{
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = true;
+  pthread_cond_signal(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+
+  thread_join(&pool->thread);
+  pthread_cond_destroy(&pool->wake);
+  pthread_mutex_destroy(&pool->lock);
+  close(pool->event_fd);
+}
+
+/* Takes a ready board, returns false if there's none yet */
+static bool _pool_take(BoardPool *pool, GeneratorResult *generated)
+{
+  pthread_mutex_lock(&pool->lock);
+  const bool taken = pool->ready_count > 0;
+  if (taken)
+  {
+    *generated = pool->ready[--pool->ready_count];
+    pthread_cond_signal(&pool->wake);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return taken;
+}
+
+/*
+SESSIONS
+*/
+
+static void _unwait(Session *session)
+{
+  Session **link = &waiting_first;
+  Session *previous = NULL;
+  while (*link != session)
+  {
+    previous = *link;
+    link = &(*link)->next_waiting;
+  }
+
+  *link = session->next_waiting;
+  if (waiting_last == session)
+    waiting_last = previous;
+  session->next_waiting = NULL;
+}
+
+static void _session_destroy(int epoll_fd, Session *session)
+{
+  epoll_ctl(epoll_fd, EPOLL_CTL_DEL, session->fd, NULL);
+  close(session->fd);
+  if (session->deadline != 0)
+    scheduler_cancel(&scheduler, session->deadline);
+
+  if (session->prev)
+    session->prev->next = session->next;
+  else
+    sessions = session->next;
+  if (session->next)
+    session->next->prev = session->prev;
+
+  if (!session->started && !session->closing)
+    _unwait(session);
+
+  /* Every session ends here, whether its game ended or the client left (shared games aren't anyone's result) */
+  if (session->started && server_stats != NULL && !coop_mode)
+    game_record(&session->game, server_stats);
+  if (session->started)
+    game_free(&session->game);
+  buffer_free(&session->output);
+  session_count--;
+
+  session->dead = true;
+  session->next = dead_sessions;
+  dead_sessions = session;
+}
+
+static void _free_dead_sessions()
+{
+  while (dead_sessions != NULL)
+  {
+    Session *session = dead_sessions;
+    dead_sessions = session->next;
+    free(session);
+  }
+}
+
+/* Sends as much output as the socket takes, returns false if the session was destroyed */
+static bool _session_flush(int epoll_fd, Session *session)
+{
+  while (session->output.length > 0)
+  {
+    ssize_t sent = send(session->fd, session->output.data, session->output.length, MSG_NOSIGNAL);
+    profile_count(PROFILE_SYSCALLS, 1);
+    if (sent > 0)
+      buffer_consume(&session->output, sent);
+    else if (sent < 0 && errno == EINTR)
+      continue;
+    else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      break;
+    else
+    {
+      _session_destroy(epoll_fd, session);
+      return false;
+    }
+  }
+
+  if (session->output.length > SERVER_MAX_PENDING_OUTPUT ||
+      (session->closing && session->output.length == 0))
+  {
+    _session_destroy(epoll_fd, session);
+    return false;
+  }
+
+  /* Only ask for EPOLLOUT while there's something waiting */
+  bool want_write = session->output.length > 0;
+  if (want_write != session->want_write)
+  {
+    struct epoll_event event = {.events = EPOLLIN | (want_write ? EPOLLOUT : 0), .data.ptr = session};
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, session->fd, &event);
+    session->want_write = want_write;
+  }
+  return true;
+}
+
+static void _session_deadline(Scheduler *scheduler, void *arg);
+
+/* Puts the session's next redraw on the scheduler, if it needs one sooner than the one it has */
+static void _session_schedule(Session *session)
+{
+  uint64_t next = game_next_deadline(&session->game);
+  if (next == TIMER_NEVER || (session->deadline != 0 && session->deadline_at <= next))
+    return;
+
+  if (session->deadline != 0)
+    scheduler_cancel(&scheduler, session->deadline);
+  session->deadline = scheduler_add(&scheduler, next, _session_deadline, session);
+  session->deadline_at = next;
+}
+
+/* The session's timer (or animation) changed, only the sessions that actually redrew get something to send */
+static void _session_deadline(Scheduler *scheduler, void *arg)
+{
+  Session *session = arg;
+  session->deadline = 0;
+
+  console_set_output(&session->output, &session->console);
+  bool drawn = game_tick(&session->game);
+  console_set_output(NULL, NULL);
+
+  /* The win/lose animation ended */
+  if (!session->game.running)
+    session->closing = true;
+
+  _session_schedule(session);
+  if (drawn || session->closing)
+    _session_flush(server_epoll_fd, session);
+}
+
+/* Sessions playing on the slot's board, or watching it end (sessions still waiting aren't on any) */
+static uint32_t _coop_players(const CoopSlot *slot)
+{
+  uint32_t players = 0;
+  for (const Session *session = sessions; session != NULL; session = session->next)
+    players += session->started && session->game.coop == &slot->board;
+  return players;
+}
+
+/*
+ * The shared board new sessions join: the current one while it's being played on, a new one when it
+ * ended or everybody left it. A board that ended stays where it is for whoever is still on it, the new
+ * one goes in the other slot. NULL if there's no board for them yet.
+ */
+static CoopSlot *_coop_prepare(const Template *templ)
+{
+  CoopSlot *slot = &coop_slots[coop_current];
+  const uint32_t players = slot->ready ? _coop_players(slot) : 0;
+  if (players > 0 && coop_state(&slot->board) == ENGINE_PLAYING)
+    return slot;
+
+  if (players > 0)
+  {
+    slot = &coop_slots[1 - coop_current];
+    /* Both boards ended and still have players on them, they'll leave once their animation is over */
+    if (slot->ready && _coop_players(slot) > 0)
+      return NULL;
+  }
+
+  GeneratorResult generated;
+  if (!_pool_take(&pool, &generated))
+    return NULL;
+
+  arena_reset(&slot->arena);
+  slot->generated = generated;
+  Minefield **board = minefield_board_alloc(templ->width, templ->height, &slot->arena);
+  slot->ready = board != NULL &&
+                vec_cmpr(generator_fill(board, templ->width, templ->height, templ->bomb_amount, generated.seed, &slot->arena), generated.blessing) &&
+                coop_init(&slot->board, board, templ->width, templ->height, templ->bomb_amount, &slot->arena);
+  if (!slot->ready)
+    return NULL;
+
+  coop_current = slot - coop_slots;
+  return slot;
+}
+
+/* Draws what the other players did on the shared board, for every session */
+static void _coop_sync_all(int epoll_fd)
+{
+  Session *next;
+  for (Session *session = sessions; session != NULL; session = next)
+  {
+    next = session->next;
+    if (!session->started)
+      continue;
+
+    console_set_output(&session->output, &session->console);
+    bool drawn = game_coop_sync(&session->game);
+    console_set_output(NULL, NULL);
+
+    if (!drawn)
+      continue;
+    /* The game ended, and the animation started */
+    _session_schedule(session);
+    _session_flush(epoll_fd, session);
+  }
+}
+
+/*
+ * Sets the session's game up on a ready board and draws it, returns false if there's no board for
+ * it yet (nothing happens then). A session that can't be set up is closed.
+ */
+static bool _session_start(Session *session, const Template *templ)
+{
+  GeneratorResult generated;
+  bool ready;
+  if (coop_mode)
+  {
+    CoopSlot *slot = _coop_prepare(templ);
+    if (slot == NULL)
+      return false;
+    ready = game_init_coop(&session->game, templ, &slot->board, &slot->generated);
+  }
+  else
+  {
+    if (!_pool_take(&pool, &generated))
+      return false;
+    ready = game_init_generated(&session->game, templ, templ->width, templ->height, templ->bomb_amount, &generated);
+  }
+
+  if (!ready)
+  {
+    session->closing = true;
+    return true;
+  }
+
+  session->started = true;
+  console_set_output(&session->output, &session->console);
+  if (coop_mode)
+    game_coop_sync(&session->game);
+  game_draw(&session->game);
+  console_set_output(NULL, NULL);
+  _session_schedule(session);
+  return true;
+}
+
+/* Boards that got ready go to the sessions that waited the longest */
+static void _serve_waiting(int epoll_fd, const Template *templ)
+{
+  while (waiting_first != NULL)
+  {
+    Session *session = waiting_first;
+    if (!_session_start(session, templ))
+      return;
+
+    waiting_first = session->next_waiting;
+    if (waiting_first == NULL)
+      waiting_last = NULL;
+    session->next_waiting = NULL;
+    _session_flush(epoll_fd, session);
+  }
+}
+
+static void _accept_all(int epoll_fd, int listener, const Template *templ)
+{
+  while (true)
+  {
+    int fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+      return; /* EAGAIN (or an error we can't do anything about) */
+
+    Session *session = calloc(1, sizeof(Session));
+    struct epoll_event event = {.events = EPOLLIN, .data.ptr = session};
+    if (session == NULL || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+      free(session);
+      close(fd);
+      continue;
+    }
+
+    session->fd = fd;
+    buffer_init(&session->output);
+    /* There's no TERM to look at, ANSI terminals with 256 colors are assumed */
+    console_state_init(&session->console, 256, true);
+    session->console.frames = true;
+
+    session->next = sessions;
+    if (sessions)
+      sessions->prev = session;
+    sessions = session;
+    session_count++;
+
+    /* Every session gets its own board, or joins the shared one, once there's one ready */
+    if (waiting_first != NULL || !_session_start(session, templ))
+    {
+      if (waiting_last)
+        waiting_last->next_waiting = session;
+      else
+        waiting_first = session;
+      waiting_last = session;
+
+      console_set_output(&session->output, &session->console);
+      clear_screen();
+      console_print("Generating the board...");
+      console_set_output(NULL, NULL);
+    }
+    _session_flush(epoll_fd, session);
+  }
+}
+
+static void _session_read(int epoll_fd, Session *session)
+{
+  unsigned char chunk[512];
+
+  while (true)
+  {
+    ssize_t length = read(session->fd, chunk, sizeof(chunk));
+    if (length < 0 && errno == EINTR)
+      continue;
+    if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      break;
+    if (length <= 0)
+    {
+      /* Disconnected */
+      _session_destroy(epoll_fd, session);
+      return;
+    }
+
+    console_set_output(&session->output, &session->console);
+    ssize_t taken = 0;
+    while (taken < length)
+    {
+      /* Add as much of the chunk as fits after the leftovers */
+      size_t room = SERVER_INPUT_SIZE - session->input_length;
+      size_t piece = (size_t)(length - taken) < room ? (size_t)(length - taken) : room;
+      memcpy(session->input + session->input_length, chunk + taken, piece);
+      session->input_length += piece;
+      taken += piece;
+
+      /* Decode whatever complete keys there are */
+      size_t used = 0, consumed;
+      do
+      {
+        /*
+         * An escape sequence cut off at the end of the piece goes on in the rest of the read, only
+         * an ESC that ends the whole read is the Escape key
+         */
+        const size_t left = session->input_length - used;
+        if (taken < length && session->input[used] == 27 && (left == 1 || (left == 2 && session->input[used + 1] == '[')))
+          break;
+
+        vkey_t key = decode_key(session->input + used, left, &consumed);
+        used += consumed;
+        if (key != VK_NONE && session->started && session->game.running)
+          game_handle_key(&session->game, key);
+      } while (consumed > 0 && used < session->input_length);
+
+      /* Keep the incomplete part for the next read */
+      memmove(session->input, session->input + used, session->input_length - used);
+      session->input_length -= used;
+    }
+    console_set_output(NULL, NULL);
+
+    if (session->started && !session->game.running)
+      session->closing = true;
+  }
+
+  /* A key may have (un)paused the timer or started an animation */
+  if (session->started)
+    _session_schedule(session);
+  _session_flush(epoll_fd, session);
+}
+
+int server_run(const char *address, const Template *templ, StatsStore *stats, bool coop)
+{
+  server_stats = stats;
+  coop_mode = coop;
+  for (uint32_t i = 0; i < 2; i++)
+  {
+    coop_slots[i].ready = false;
+    arena_init(&coop_slots[i].arena, 0);
+  }
+  int listener = _listen(address);
+  if (listener < 0)
+    return 1;
+
+  if (!_pool_start(&pool, templ))
+  {
+    perror("generator thread");
+    close(listener);
+    return 1;
+  }
+
+  int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  server_epoll_fd = epoll_fd;
+  scheduler_init(&scheduler);
+  struct epoll_event event = {.events = EPOLLIN, .data.ptr = &listener_tag};
+  struct epoll_event pool_event = {.events = EPOLLIN, .data.ptr = &pool_tag};
+  if (epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listener, &event) < 0 ||
+      epoll_ctl(epoll_fd, EPOLL_CTL_ADD, pool.event_fd, &pool_event) < 0)
+  {
+    perror("epoll");
+    _pool_stop(&pool);
+    close(listener);
+    return 1;
+  }
+
+  printf("Hosting %s'%s' games on %s\n", coop ? "shared " : "", templ->name, address);
+  fflush(stdout);
+
+  struct epoll_event events[SERVER_MAX_EVENTS];
+
+  while (true)
+  {
+    /* Sleep until there's input or some session's timer has to change */
+    int count = epoll_wait(epoll_fd, events, SERVER_MAX_EVENTS, scheduler_timeout_ms(&scheduler, timer_now_ms()));
+    if (count < 0 && errno != EINTR)
+    {
+      perror("epoll_wait");
+      break;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+      if (events[i].data.ptr == &listener_tag)
+      {
+        _accept_all(epoll_fd, listener, templ);
+        continue;
+      }
+      if (events[i].data.ptr == &pool_tag)
+      {
+        eventfd_t ready;
+        eventfd_read(pool.event_fd, &ready);
+        _serve_waiting(epoll_fd, templ);
+        continue;
+      }
+
+      Session *session = events[i].data.ptr;
+      if (session->dead)
+        continue;
+      if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+        _session_read(epoll_fd, session);
+      else if (events[i].events & EPOLLOUT)
+        _session_flush(epoll_fd, session);
+    }
+
+    if (coop_mode)
+    {
+      _coop_sync_all(epoll_fd);
+      /* Sessions waiting for both ended boards to empty, the pool won't ring for them */
+      _serve_waiting(epoll_fd, templ);
+    }
+    scheduler_run(&scheduler, timer_now_ms());
+    _free_dead_sessions();
+  }
+
+  _pool_stop(&pool);
+  scheduler_free(&scheduler);
+  for (uint32_t i = 0; i < 2; i++)
+    arena_free(&coop_slots[i].arena);
+  close(epoll_fd);
+  close(listener);
+  return 1;
+}
+
+#else
+
+int server_run(const char *address, const Template *templ, StatsStore *stats, bool coop)
+{
+  (void)address;
+  (void)templ;
+  (void)stats;
+  (void)coop;
+  fprintf(stderr, "Server mode is only supported on Linux\n");
+  return 1;
+}
+
+#endif /* __linux__ */
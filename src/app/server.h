@@ -0,0 +1,25 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdbool.h>
+
+#include "stats.h"
+#include "../classes/templates.h"
+
+/**
+ * server_run
+ * Hosts games for everybody that connects to `address` (one independent game per connection,
+ * or a single board everybody plays together) until the process is killed. Only supported on Linux.
+ *
+ * Clients just need a raw terminal, for example:
+ * socat -,raw,echo=0 UNIX-CONNECT:/tmp/csweeper.sock
+ *
+ * @param address "unix:<path>" for a Unix-domain socket or "tcp:<port>" to listen on 127.0.0.1
+ * @param templ Template every session plays
+ * @param stats Where finished games are written down, NULL to not keep them (shared games never are)
+ * @param coop Everybody plays on the same board, at most COOP_MAX_PLAYERS at once
+ * @return Exit code for main
+ */
+int server_run(const char *address, const Template *templ, StatsStore *stats, bool coop);
+
+#endif /* SERVER_H */
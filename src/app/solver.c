@@ -0,0 +1,822 @@
+/**
+ * solver.c
+ * A small rule based Minesweeper solver.
+ *
+ * The solver keeps its own 'view' of the board, which is exactly what a player could see:
+ * covered cells, the numbers of revealed cells and the bombs it has already deduced.
+ * The real board is only used to find out the number under a cell once it's revealed
+ * (and to pick a safe cell when it has to guess).
+ *
+ * solver_next_move builds the same view out of what's on screen instead, and returns
+ * the first thing it finds as a move for the player to make.
+ *
+ * When no single number or pair of them tells anything, every number along the edge goes into
+ * a system of equations (see the MATRIX part), which catches what takes three or more numbers.
+ * Before that, straight runs of numbers get looked up in a table made when building (see the
+ * PATTERNS part), which is most of what the matrix would find for a lot less work.
+ */
+#include <stdlib.h>
+
+#include "solver.h"
+#include "../utils/profile.h"
+/* Made by src/pattern_gen.c into the build folder */
+#include "patterns.h"
+
+/* Values a cell in the view can have other than its number */
+#define VIEW_COVERED -1
+#define VIEW_MINE -2
+
+typedef struct
+{
+  Minefield **board;
+  uint16_t width;
+  uint16_t height;
+  /* What the solver knows about each cell */
+  int8_t *view;
+  /* Flood fill stack */
+  uint32_t *stack;
+  /* Safe cells that are still covered */
+  uint32_t safe_left;
+  /* Where the matrix gets built, given back after every use */
+  Arena *scratch;
+} SolverState;
+
+/* Reveals (x, y) and floods through the 0s, returns the amount of cells revealed */
+static uint32_t _reveal(SolverState *state, uint16_t x, uint16_t y)
+{
+  const uint16_t w = state->width;
+  uint32_t revealed = 0;
+  uint32_t top = 0;
+
+  if (state->view[y * w + x] != VIEW_COVERED)
+    return 0;
+
+  state->view[y * w + x] = state->board[y][x].bomb_amount;
+  state->stack[top++] = y * w + x;
+
+  while (top > 0)
+  {
+    uint32_t index = state->stack[--top];
+    uint16_t cx = index % w;
+    uint16_t cy = index / w;
+    revealed++;
+
+    if (state->view[index] != 0)
+      continue;
+
+    for (int32_t i = -1; i <= 1; i++)
+    {
+      /* Limit detection */
+      if (cy + i < 0 || cy + i >= state->height)
+        continue;
+      for (int32_t j = -1; j <= 1; j++)
+      {
+        /* Limit detection */
+        if (cx + j < 0 || cx + j >= w)
+          continue;
+
+        uint32_t neighbour = (cy + i) * w + (cx + j);
+        if (state->view[neighbour] != VIEW_COVERED)
+          continue;
+
+        /* Mark it when pushing so nothing gets pushed twice */
+        state->view[neighbour] = state->board[cy + i][cx + j].bomb_amount;
+        state->stack[top++] = neighbour;
+      }
+    }
+  }
+
+  state->safe_left -= revealed;
+  return revealed;
+}
+
+/*
+ * Collects the covered neighbours of a revealed cell into `covered` (up to 8 indexes)
+ * and returns how many bombs are still missing around it through `missing`
+ */
+static uint8_t _unknown_neighbours(const SolverState *state, uint32_t index, uint32_t covered[8], int8_t *missing)
+{
+  const uint16_t w = state->width;
+  const uint16_t x = index % w;
+  const uint16_t y = index / w;
+  uint8_t count = 0;
+  int8_t mines = 0;
+
+  for (int32_t i = -1; i <= 1; i++)
+  {
+    /* Limit detection */
+    if (y + i < 0 || y + i >= state->height)
+      continue;
+    for (int32_t j = -1; j <= 1; j++)
+    {
+      /* Limit detection */
+      if (x + j < 0 || x + j >= w)
+        continue;
+
+      uint32_t neighbour = (y + i) * w + (x + j);
+      if (state->view[neighbour] == VIEW_COVERED)
+        covered[count++] = neighbour;
+      else if (state->view[neighbour] == VIEW_MINE)
+        mines++;
+    }
+  }
+
+  *missing = state->view[index] - mines;
+  return count;
+}
+
+/* Either reveals every cell on the list or marks all of them as bombs */
+static uint32_t _resolve(SolverState *state, const uint32_t *cells, uint8_t count, bool safe)
+{
+  uint32_t revealed = 0;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if (safe)
+      revealed += _reveal(state, cells[i] % state->width, cells[i] / state->width);
+    else
+      state->view[cells[i]] = VIEW_MINE;
+  }
+  return revealed;
+}
+
+/* One number at a time, returns true if anything new was found */
+static bool _pass_single(SolverState *state, uint32_t *revealed)
+{
+  const uint32_t total = (uint32_t)state->width * state->height;
+  bool progress = false;
+
+  for (uint32_t index = 0; index < total; index++)
+  {
+    if (state->view[index] <= 0)
+      continue;
+
+    uint32_t covered[8];
+    int8_t missing;
+    uint8_t count = _unknown_neighbours(state, index, covered, &missing);
+    if (count == 0)
+      continue;
+
+    if (missing == 0)
+      *revealed += _resolve(state, covered, count, true);
+    else if (missing == count)
+      _resolve(state, covered, count, false);
+    else
+      continue;
+
+    progress = true;
+  }
+
+  return progress;
+}
+
+static bool _is_subset(const uint32_t *a, uint8_t a_count, const uint32_t *b, uint8_t b_count)
+{
+  for (uint8_t i = 0; i < a_count; i++)
+  {
+    bool found = false;
+    for (uint8_t j = 0; j < b_count && !found; j++)
+      found = a[i] == b[j];
+    if (!found)
+      return false;
+  }
+  return true;
+}
+
+/*
+ * Pairs of numbers (up to 2 cells away), finds the first pair where the covered neighbours of one
+ * are inside the other's, the cells left over (`rest`) are either all safe or all bombs
+ */
+static bool _find_subset(const SolverState *state, uint32_t rest[8], uint8_t *rest_count, bool *safe)
+{
+  const uint16_t w = state->width;
+  const uint32_t total = (uint32_t)w * state->height;
+
+  for (uint32_t a = 0; a < total; a++)
+  {
+    if (state->view[a] <= 0)
+      continue;
+
+    uint32_t covered_a[8];
+    int8_t missing_a;
+    uint8_t count_a = _unknown_neighbours(state, a, covered_a, &missing_a);
+    if (count_a == 0)
+      continue;
+
+    const int32_t ax = a % w;
+    const int32_t ay = a / w;
+    for (int32_t i = -2; i <= 2; i++)
+    {
+      if (ay + i < 0 || ay + i >= state->height)
+        continue;
+      for (int32_t j = -2; j <= 2; j++)
+      {
+        if (ax + j < 0 || ax + j >= w || (i == 0 && j == 0))
+          continue;
+
+        uint32_t b = (ay + i) * w + (ax + j);
+        if (state->view[b] <= 0)
+          continue;
+
+        uint32_t covered_b[8];
+        int8_t missing_b;
+        uint8_t count_b = _unknown_neighbours(state, b, covered_b, &missing_b);
+        if (count_b <= count_a || !_is_subset(covered_a, count_a, covered_b, count_b))
+          continue;
+
+        /* Whatever B has outside of A holds exactly the bombs A doesn't account for */
+        *rest_count = 0;
+        for (uint8_t k = 0; k < count_b; k++)
+          if (!_is_subset(&covered_b[k], 1, covered_a, count_a))
+            rest[(*rest_count)++] = covered_b[k];
+
+        int8_t rest_missing = missing_b - missing_a;
+        if (rest_missing != 0 && rest_missing != *rest_count)
+          continue;
+
+        *safe = rest_missing == 0;
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+/* Pairs of numbers, stops at the first thing it finds */
+static bool _pass_subset(SolverState *state, uint32_t *revealed)
+{
+  uint32_t rest[8];
+  uint8_t rest_count;
+  bool safe;
+
+  if (!_find_subset(state, rest, &rest_count, &safe))
+    return false;
+
+  *revealed += _resolve(state, rest, rest_count, safe);
+  return true;
+}
+
+/*
+MATRIX
+*/
+
+/*
+ * Every covered cell next to a number is a variable (1 if it's a bomb), every number with covered
+ * neighbours an equation: its covered neighbours add up to the bombs it's missing. A row keeps its
+ * coefficients as two bitsets, the variables with +1 and the ones with -1.
+ *
+ * Gaussian elimination only ever adds or subtracts rows, and a combination that would take a
+ * coefficient to 2 is skipped, so every row stays a true equation with coefficients of -1, 0 or 1.
+ * A row then tells something when its bombs can only add up one way: as many as its +1 variables
+ * (those are bombs and the -1 ones safe), or minus as many as its -1 variables (the other way around).
+ */
+typedef struct
+{
+  uint64_t *plus;
+  uint64_t *minus;
+  int32_t bombs;
+} MatrixRow;
+
+typedef struct
+{
+  uint32_t variable_count;
+  uint32_t row_count;
+  uint32_t words;
+  /* Cell of every variable */
+  uint32_t *cells;
+  MatrixRow *rows;
+} Matrix;
+
+/* A cell the matrix found out about, with MATRIX_BOMB if it's a bomb */
+#define MATRIX_BOMB (1u << 31)
+
+/* The equations of every number with covered neighbours, false if the memory ran out */
+static bool _matrix_build(const SolverState *state, Matrix *matrix)
+{
+  const uint32_t total = (uint32_t)state->width * state->height;
+  uint32_t *variable = arena_alloc(state->scratch, sizeof(uint32_t) * total);
+  matrix->cells = arena_alloc(state->scratch, sizeof(uint32_t) * total);
+  /* Covered neighbours of every equation, 8 slots each (a row can't have more equations than cells) */
+  uint32_t *covered = arena_alloc(state->scratch, sizeof(uint32_t) * total * 8);
+  uint8_t *counts = arena_alloc(state->scratch, total);
+  int8_t *missing = arena_alloc(state->scratch, total);
+  if (variable == NULL || matrix->cells == NULL || covered == NULL || counts == NULL || missing == NULL)
+    return false;
+
+  for (uint32_t index = 0; index < total; index++)
+    variable[index] = UINT32_MAX;
+
+  matrix->row_count = 0;
+  for (uint32_t index = 0; index < total; index++)
+  {
+    if (state->view[index] <= 0)
+      continue;
+
+    uint32_t *cells = &covered[matrix->row_count * 8];
+    uint8_t count = _unknown_neighbours(state, index, cells, &missing[matrix->row_count]);
+    if (count == 0)
+      continue;
+
+    counts[matrix->row_count++] = count;
+    for (uint8_t i = 0; i < count; i++)
+      variable[cells[i]] = 0;
+  }
+
+  /* Variables in board order, equations are mostly about cells close to each other */
+  matrix->variable_count = 0;
+  for (uint32_t index = 0; index < total; index++)
+    if (variable[index] != UINT32_MAX)
+    {
+      variable[index] = matrix->variable_count;
+      matrix->cells[matrix->variable_count++] = index;
+    }
+
+  matrix->words = (matrix->variable_count + 63) / 64;
+  matrix->rows = arena_alloc(state->scratch, sizeof(MatrixRow) * matrix->row_count);
+  uint64_t *bits = arena_calloc(state->scratch, (size_t)matrix->row_count * matrix->words * 2, sizeof(uint64_t));
+  if (matrix->row_count > 0 && (matrix->rows == NULL || bits == NULL))
+    return false;
+
+  for (uint32_t row = 0; row < matrix->row_count; row++)
+  {
+    MatrixRow *equation = &matrix->rows[row];
+    equation->plus = &bits[(size_t)row * matrix->words * 2];
+    equation->minus = equation->plus + matrix->words;
+    equation->bombs = missing[row];
+    for (uint8_t i = 0; i < counts[row]; i++)
+    {
+      const uint32_t id = variable[covered[row * 8 + i]];
+      equation->plus[id / 64] |= (uint64_t)1 << (id % 64);
+    }
+  }
+
+  return true;
+}
+
+/* row -= other (plus and minus of `other` swapped adds it instead), false if a coefficient would get to 2 */
+static bool _matrix_subtract(MatrixRow *row, const uint64_t *plus, const uint64_t *minus, int32_t bombs, uint32_t words)
+{
+  for (uint32_t k = 0; k < words; k++)
+    if ((row->plus[k] & minus[k]) | (row->minus[k] & plus[k]))
+      return false;
+
+  for (uint32_t k = 0; k < words; k++)
+  {
+    const uint64_t used = row->plus[k] | row->minus[k], other = plus[k] | minus[k];
+    const uint64_t new_plus = (row->plus[k] & ~other) | (minus[k] & ~used);
+    row->minus[k] = (row->minus[k] & ~other) | (plus[k] & ~used);
+    row->plus[k] = new_plus;
+  }
+  row->bombs -= bombs;
+  return true;
+}
+
+static void _matrix_reduce(Matrix *matrix)
+{
+  uint32_t pivot = 0;
+
+  for (uint32_t variable = 0; variable < matrix->variable_count && pivot < matrix->row_count; variable++)
+  {
+    const uint32_t word = variable / 64;
+    const uint64_t bit = (uint64_t)1 << (variable % 64);
+
+    uint32_t found = pivot;
+    while (found < matrix->row_count && !((matrix->rows[found].plus[word] | matrix->rows[found].minus[word]) & bit))
+      found++;
+    if (found == matrix->row_count)
+      continue;
+
+    MatrixRow swap = matrix->rows[pivot];
+    matrix->rows[pivot] = matrix->rows[found];
+    matrix->rows[found] = swap;
+
+    /* The pivot goes in with +1 */
+    MatrixRow *row = &matrix->rows[pivot];
+    if (row->minus[word] & bit)
+    {
+      uint64_t *plus = row->plus;
+      row->plus = row->minus;
+      row->minus = plus;
+      row->bombs = -row->bombs;
+    }
+
+    for (uint32_t other = 0; other < matrix->row_count; other++)
+    {
+      MatrixRow *target = &matrix->rows[other];
+      if (other == pivot)
+        continue;
+      if (target->plus[word] & bit)
+        _matrix_subtract(target, row->plus, row->minus, row->bombs, matrix->words);
+      else if (target->minus[word] & bit)
+        _matrix_subtract(target, row->minus, row->plus, -row->bombs, matrix->words);
+    }
+    pivot++;
+  }
+}
+
+/* Every variable set in `bits` that isn't known yet, as cells (marked as bombs or not) */
+static uint32_t _matrix_collect(const Matrix *matrix, const uint64_t *bits, const uint64_t *known, bool bomb, uint32_t *found, uint32_t count)
+{
+  for (uint32_t k = 0; k < matrix->words; k++)
+    for (uint64_t word = bits[k] & ~known[k]; word != 0; word &= word - 1)
+      found[count++] = matrix->cells[k * 64 + __builtin_ctzll(word)] | (bomb ? MATRIX_BOMB : 0);
+  return count;
+}
+
+/*
+ * Solves the edge, writes what it found out to `found` (room for a cell per covered cell), the memory
+ * goes back to the scratch arena. Returns how many, 0 if nothing (or no memory).
+ */
+static uint32_t _matrix_solve(const SolverState *state, uint32_t *found)
+{
+  const ArenaMark mark = arena_mark(state->scratch);
+  Matrix matrix;
+  uint32_t count = 0;
+
+  if (!_matrix_build(state, &matrix))
+  {
+    arena_rewind(state->scratch, mark);
+    return 0;
+  }
+  _matrix_reduce(&matrix);
+
+  /* Variables found already, nothing gets found twice */
+  uint64_t *known = arena_calloc(state->scratch, matrix.words + 1, sizeof(uint64_t));
+  for (uint32_t r = 0; known != NULL && r < matrix.row_count; r++)
+  {
+    const MatrixRow *row = &matrix.rows[r];
+    int32_t plus = 0, minus = 0;
+    bool fresh = false;
+    for (uint32_t k = 0; k < matrix.words; k++)
+    {
+      plus += __builtin_popcountll(row->plus[k]);
+      minus += __builtin_popcountll(row->minus[k]);
+      fresh = fresh || ((row->plus[k] | row->minus[k]) & ~known[k]);
+    }
+    if (!fresh || (row->bombs != plus && row->bombs != -minus))
+      continue;
+
+    /* All the bombs it could have, or none */
+    const bool plus_bombs = row->bombs == plus;
+    count = _matrix_collect(&matrix, row->plus, known, plus_bombs, found, count);
+    count = _matrix_collect(&matrix, row->minus, known, !plus_bombs, found, count);
+    for (uint32_t k = 0; k < matrix.words; k++)
+      known[k] |= row->plus[k] | row->minus[k];
+  }
+
+  arena_rewind(state->scratch, mark);
+  return count;
+}
+
+/* The whole edge at once, returns true if anything new was found */
+static bool _pass_matrix(SolverState *state, uint32_t *found, uint32_t *revealed)
+{
+  const uint32_t count = _matrix_solve(state, found);
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    const uint32_t cell = found[i] & ~MATRIX_BOMB;
+    if (found[i] & MATRIX_BOMB)
+      state->view[cell] = VIEW_MINE;
+    else
+      *revealed += _reveal(state, cell % state->width, cell / state->width);
+  }
+  return count > 0;
+}
+
+/*
+PATTERNS
+*/
+
+/* Ways a run can lie: along a row with its covered cells above or below, or a column with them left or right */
+static const int8_t pattern_ways[4][4] = {{1, 0, 0, -1}, {1, 0, 0, 1}, {0, 1, -1, 0}, {0, 1, 1, 0}};
+
+/* Whether (x, y) is a covered cell, off the board isn't */
+static bool _is_covered(const SolverState *state, int32_t x, int32_t y)
+{
+  return x >= 0 && y >= 0 && x < state->width && y < state->height && state->view[y * state->width + x] == VIEW_COVERED;
+}
+
+/*
+ * Looks up the runs of numbers starting at `index` (see src/pattern_gen.c for what makes one), writes
+ * the cells of the first one that tells something to `cells` with MATRIX_BOMB on the bombs.
+ * Returns how many, 0 if nothing.
+ */
+static uint8_t _find_pattern(const SolverState *state, uint32_t index, uint32_t cells[PATTERN_MAX_RUN + 2])
+{
+  const int32_t x = index % state->width;
+  const int32_t y = index / state->width;
+
+  for (uint8_t way = 0; way < 4; way++)
+  {
+    /* Along the run, and towards its covered cells */
+    const int32_t ax = pattern_ways[way][0], ay = pattern_ways[way][1];
+    const int32_t cx = pattern_ways[way][2], cy = pattern_ways[way][3];
+
+    /* Most numbers have nothing covered on that side, or something covered before them other than their first cell */
+    if (!_is_covered(state, x + cx, y + cy) || _is_covered(state, x - ax, y - ay) || _is_covered(state, x - ax - cx, y - ay - cy))
+      continue;
+
+    const uint32_t first_open = _is_covered(state, x - ax + cx, y - ay + cy);
+    uint32_t key = 0;
+    for (uint32_t length = 1; length <= PATTERN_MAX_RUN; length++)
+    {
+      /* A covered cell next to it means it's still on the board */
+      const int32_t nx = x + ax * (int32_t)(length - 1), ny = y + ay * (int32_t)(length - 1);
+      if (!_is_covered(state, nx + cx, ny + cy) || _is_covered(state, nx - cx, ny - cy) || state->view[ny * state->width + nx] <= 0)
+        break;
+
+      uint32_t covered[8];
+      int8_t missing;
+      _unknown_neighbours(state, ny * state->width + nx, covered, &missing);
+      if (missing < 0 || missing > 3)
+        break;
+      key |= (uint32_t)missing << (2 * (length - 1));
+
+      /* It can only end here if nothing's covered after it other than its last cell */
+      if (_is_covered(state, nx + ax, ny + ay) || _is_covered(state, nx + ax - cx, ny + ay - cy))
+        continue;
+
+      const uint32_t ends = first_open | (uint32_t)_is_covered(state, nx + ax + cx, ny + ay + cy) << 1;
+      const uint16_t entry = pattern_table[pattern_offsets[length] + ((ends << (2 * length)) | key)];
+      if (entry == 0)
+        continue;
+
+      uint8_t count = 0;
+      for (uint32_t j = 0; j < length + 2; j++)
+      {
+        const uint32_t cell = (y + ay * ((int32_t)j - 1) + cy) * state->width + (x + ax * ((int32_t)j - 1) + cx);
+        if (entry & (1u << j))
+          cells[count++] = cell;
+        else if (entry & (1u << (j + 8)))
+          cells[count++] = cell | MATRIX_BOMB;
+      }
+      return count;
+    }
+  }
+
+  return 0;
+}
+
+/* Every run of numbers, returns true if anything new was found */
+static bool _pass_pattern(SolverState *state, uint32_t *revealed)
+{
+  const uint32_t total = (uint32_t)state->width * state->height;
+  bool progress = false;
+
+  for (uint32_t index = 0; index < total; index++)
+  {
+    if (state->view[index] <= 0)
+      continue;
+
+    uint32_t cells[PATTERN_MAX_RUN + 2];
+    const uint8_t count = _find_pattern(state, index, cells);
+    for (uint8_t i = 0; i < count; i++)
+    {
+      const uint32_t cell = cells[i] & ~MATRIX_BOMB;
+      if (cells[i] & MATRIX_BOMB)
+        state->view[cell] = VIEW_MINE;
+      else
+        *revealed += _reveal(state, cell % state->width, cell / state->width);
+    }
+    progress |= count > 0;
+  }
+
+  return progress;
+}
+
+/* Reveals a covered safe cell, a.k.a what a lucky player would do */
+static uint32_t _guess(SolverState *state)
+{
+  const uint32_t total = (uint32_t)state->width * state->height;
+  for (uint32_t index = 0; index < total; index++)
+  {
+    uint16_t x = index % state->width;
+    uint16_t y = index / state->width;
+    if (state->view[index] == VIEW_COVERED && !state->board[y][x].has_bomb)
+      return _reveal(state, x, y);
+  }
+  return 0;
+}
+
+bool solver_analyze(Minefield **board, uint16_t width, uint16_t height, Vec2 start, SolverReport *report, Arena *scratch)
+{
+  const uint64_t started_at = profile_start();
+  const uint32_t total = (uint32_t)width * height;
+  const ArenaMark mark = arena_mark(scratch);
+  SolverState state = {.board = board, .width = width, .height = height, .scratch = scratch};
+
+  state.view = arena_alloc(scratch, sizeof(int8_t) * total);
+  state.stack = arena_alloc(scratch, sizeof(uint32_t) * total);
+  uint32_t *found = arena_alloc(scratch, sizeof(uint32_t) * total);
+  if (state.view == NULL || state.stack == NULL || found == NULL)
+  {
+    arena_rewind(scratch, mark);
+    return false;
+  }
+
+  for (uint32_t i = 0; i < total; i++)
+    state.view[i] = VIEW_COVERED;
+
+  state.safe_left = 0;
+  for (uint16_t i = 0; i < height; i++)
+    for (uint16_t j = 0; j < width; j++)
+      state.safe_left += !board[i][j].has_bomb;
+
+  *report = (SolverReport){0};
+
+  /* The first click */
+  if (start.x >= 0 && start.y >= 0 && !board[start.y][start.x].has_bomb)
+    report->tier_cells[SOLVER_TIER_NONE] = _reveal(&state, start.x, start.y);
+  else
+  {
+    report->tier_cells[SOLVER_TIER_GUESS] += _guess(&state);
+    report->guesses++;
+    report->max_tier = SOLVER_TIER_GUESS;
+  }
+
+  /* Always go back to the cheapest rule after finding something */
+  while (state.safe_left > 0)
+  {
+    uint32_t revealed = 0;
+    SolverTier tier;
+
+    if (_pass_single(&state, &revealed))
+      tier = SOLVER_TIER_SINGLE;
+    else if (_pass_subset(&state, &revealed))
+      tier = SOLVER_TIER_SUBSET;
+    /* Single numbers and pairs had their go, whatever the table finds took more of them so it counts as the matrix */
+    else if (_pass_pattern(&state, &revealed) || _pass_matrix(&state, found, &revealed))
+      tier = SOLVER_TIER_MATRIX;
+    else
+    {
+      revealed = _guess(&state);
+      report->guesses++;
+      tier = SOLVER_TIER_GUESS;
+    }
+
+    report->tier_cells[tier] += revealed;
+    if (tier > report->max_tier)
+      report->max_tier = tier;
+  }
+
+  arena_rewind(scratch, mark);
+  profile_stop(PROFILE_SOLVER, started_at);
+  return true;
+}
+
+/* A number that tells something on its own: sweep it if all its bombs are flagged, else flag one of them */
+static bool _next_single(const SolverState *state, SolverMove *move)
+{
+  const uint32_t total = (uint32_t)state->width * state->height;
+
+  for (uint32_t index = 0; index < total; index++)
+  {
+    if (state->view[index] <= 0)
+      continue;
+
+    uint32_t covered[8];
+    int8_t missing;
+    uint8_t count = _unknown_neighbours(state, index, covered, &missing);
+    if (count == 0 || (missing != 0 && missing != count))
+      continue;
+
+    uint32_t cell = (missing == 0) ? index : covered[0];
+    move->cell.x = cell % state->width;
+    move->cell.y = cell / state->width;
+    move->flag = missing != 0;
+    move->tier = SOLVER_TIER_SINGLE;
+    return true;
+  }
+
+  return false;
+}
+
+/*
+ * The covered cell with the lowest chance of being a bomb, as far as the numbers around each cell say
+ * (the worst one counts), cells next to no number get the chance of the board's leftover bombs
+ */
+static bool _next_guess(const SolverState *state, float *risk, uint32_t bombs_left, uint32_t covered_count, SolverMove *move)
+{
+  const uint32_t total = (uint32_t)state->width * state->height;
+  const float unknown_risk = (float)bombs_left / covered_count;
+
+  for (uint32_t index = 0; index < total; index++)
+    risk[index] = unknown_risk;
+
+  for (uint32_t index = 0; index < total; index++)
+  {
+    if (state->view[index] <= 0)
+      continue;
+
+    uint32_t covered[8];
+    int8_t missing;
+    uint8_t count = _unknown_neighbours(state, index, covered, &missing);
+    for (uint8_t i = 0; i < count; i++)
+    {
+      float local = (float)missing / count;
+      if (local > risk[covered[i]])
+        risk[covered[i]] = local;
+    }
+  }
+
+  uint32_t best = total;
+  for (uint32_t index = 0; index < total; index++)
+    if (state->view[index] == VIEW_COVERED && (best == total || risk[index] < risk[best]))
+      best = index;
+
+  if (best == total)
+    return false;
+
+  move->cell.x = best % state->width;
+  move->cell.y = best / state->width;
+  move->flag = false;
+  move->tier = SOLVER_TIER_GUESS;
+  return true;
+}
+
+/* The first run of numbers that tells something, its first cell goes to `cells` */
+static bool _next_pattern(const SolverState *state, uint32_t *cells)
+{
+  const uint32_t total = (uint32_t)state->width * state->height;
+  uint32_t found[PATTERN_MAX_RUN + 2];
+
+  for (uint32_t index = 0; index < total; index++)
+    if (state->view[index] > 0 && _find_pattern(state, index, found) > 0)
+    {
+      cells[0] = found[0];
+      return true;
+    }
+  return false;
+}
+
+bool solver_next_move(Minefield **board, uint16_t width, uint16_t height, SolverMove *move, Arena *scratch)
+{
+  const uint32_t total = (uint32_t)width * height;
+  const ArenaMark mark = arena_mark(scratch);
+  SolverState state = {.board = board, .width = width, .height = height, .scratch = scratch};
+
+  state.view = arena_alloc(scratch, sizeof(int8_t) * total);
+  float *risk = arena_alloc(scratch, sizeof(float) * total);
+  uint32_t *cells = arena_alloc(scratch, sizeof(uint32_t) * total);
+  if (state.view == NULL || risk == NULL || cells == NULL)
+  {
+    arena_rewind(scratch, mark);
+    return false;
+  }
+
+  /* What the player sees */
+  uint32_t bombs = 0, flags = 0, covered_count = 0;
+  for (uint16_t i = 0; i < height; i++)
+    for (uint16_t j = 0; j < width; j++)
+    {
+      const Minefield *field = &board[i][j];
+      int8_t *view = &state.view[i * width + j];
+
+      bombs += field->has_bomb;
+      if (field->is_flagged)
+      {
+        *view = VIEW_MINE;
+        flags++;
+      }
+      else if (field->is_mined)
+        *view = field->bomb_amount;
+      else
+      {
+        *view = VIEW_COVERED;
+        covered_count++;
+      }
+    }
+
+  bool found = false;
+  if (covered_count > 0)
+  {
+    uint32_t rest[8];
+    uint8_t rest_count;
+    bool safe;
+
+    if (_next_single(&state, move))
+      found = true;
+    else if (_find_subset(&state, rest, &rest_count, &safe))
+    {
+      move->cell.x = rest[0] % width;
+      move->cell.y = rest[0] / width;
+      move->flag = !safe;
+      move->tier = SOLVER_TIER_SUBSET;
+      found = true;
+    }
+    else if (_next_pattern(&state, cells) || _matrix_solve(&state, cells) > 0)
+    {
+      move->cell.x = (cells[0] & ~MATRIX_BOMB) % width;
+      move->cell.y = (cells[0] & ~MATRIX_BOMB) / width;
+      move->flag = (cells[0] & MATRIX_BOMB) != 0;
+      move->tier = SOLVER_TIER_MATRIX;
+      found = true;
+    }
+    else
+      found = _next_guess(&state, risk, (bombs > flags) ? bombs - flags : 0, covered_count, move);
+  }
+
+  arena_rewind(scratch, mark);
+  return found;
+}
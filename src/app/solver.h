@@ -0,0 +1,85 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "../classes/arena.h"
+#include "../classes/minefield.h"
+#include "../classes/vec.h"
+
+/*
+ * Tiers of reasoning the solver can use, from the simplest to 'just guess'
+ *
+ * SINGLE: one number alone tells you everything around it
+ *         (all its bombs are flagged already, or all its covered neighbours are bombs)
+ * SUBSET: two numbers together do, when one's covered neighbours are inside the other's
+ * MATRIX: every number along the edge of what's shown at once, as a system of equations
+ *         (or a straight run of them, out of a table made when building)
+ * GUESS:  nothing can be deduced, the player has to take a chance
+ */
+typedef enum
+{
+  SOLVER_TIER_NONE = 0,
+  SOLVER_TIER_SINGLE = 1,
+  SOLVER_TIER_SUBSET = 2,
+  SOLVER_TIER_MATRIX = 3,
+  SOLVER_TIER_GUESS = 4
+} SolverTier;
+
+typedef struct
+{
+  /* Safe cells opened at each tier (index 0 is the starting click) */
+  uint32_t tier_cells[5];
+  /* How many times the solver had to guess */
+  uint32_t guesses;
+  /* Hardest tier that was needed to clear the board */
+  SolverTier max_tier;
+} SolverReport;
+
+/* What a player should do next, see solver_next_move */
+typedef struct
+{
+  Vec2 cell;
+  /* Flag the cell instead of clicking it (clicks show covered cells and sweep numbers) */
+  bool flag;
+  /* Rule that found the move, SOLVER_TIER_GUESS if nothing could be deduced */
+  SolverTier tier;
+} SolverMove;
+
+/**
+ * solver_analyze
+ * Plays the whole board starting with a click on `start`, only using what a player
+ * would be able to see, and reports which tiers were needed to clear it.
+ *
+ * Guesses never fail (the solver peeks to pick a safe cell), they're just counted.
+ * If `start` is -1, -1 the first click counts as a guess.
+ *
+ * @param board The game board
+ * @param width The width of the board
+ * @param height The height of the board
+ * @param start The first cell clicked
+ * @param report Where to write the results
+ * @param scratch Arena for the solver's memory, it's all given back before returning
+ * @return false if the solver couldn't allocate its memory
+ */
+bool solver_analyze(Minefield **board, uint16_t width, uint16_t height, Vec2 start, SolverReport *report, Arena *scratch);
+
+/**
+ * solver_next_move
+ * Picks the next move for a game in progress, this time without peeking: only shown cells,
+ * flags and the amount of bombs (the counter on the GUI) are looked at. Flags are trusted to be right.
+ *
+ * Deductions come first (sweeping a number, flagging, or showing a cell), when there are none
+ * it guesses the covered cell that looks the least likely to be a bomb.
+ *
+ * @param board The game board
+ * @param width The width of the board
+ * @param height The height of the board
+ * @param move Where to write the move
+ * @param scratch Arena for the solver's memory, it's all given back before returning
+ * @return false if there's nothing left to do (or the memory couldn't be allocated)
+ */
+bool solver_next_move(Minefield **board, uint16_t width, uint16_t height, SolverMove *move, Arena *scratch);
+
+#endif /* SOLVER_H */
@@ -0,0 +1,298 @@
+/**
+ * stats.c
+ * Results log and the per template index of it.
+ *
+ * The log is plain text, a line per game:
+ * <template>,<seed>,<time in ms>,<3BV>,<clicks>,<won|lost>
+ *
+ * The index is just the entries written as they are in memory, after a header that says
+ * how much of the log they account for. It's always written to a temporary file first and
+ * renamed over the old one, so it's never seen half written.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#elif defined(__unix__) || defined(__APPLE__) || defined(__linux__)
+#include <unistd.h>
+#else
+#error "Unknown platform, only Windows and UNIX are supported"
+#endif
+
+#include "stats.h"
+
+#define INDEX_MAGIC "CSWIDX1"
+
+typedef struct
+{
+  char magic[8];
+  uint64_t log_size;
+  uint32_t entry_count;
+} IndexHeader;
+
+/* Bucket of a winning time, see STATS_BUCKETS */
+static uint32_t _bucket(uint64_t ms)
+{
+  if (ms < 8)
+    return ms;
+  if (ms >= (1u << 25))
+    return STATS_BUCKETS - 1;
+
+  uint32_t octave = 3;
+  while (ms >> (octave + 1))
+    octave++;
+  return (octave - 2) * 8 + ((ms >> (octave - 3)) & 7);
+}
+
+/* Fastest time that goes in a bucket */
+static uint64_t _bucket_start(uint32_t bucket)
+{
+  if (bucket < 8)
+    return bucket;
+
+  uint32_t octave = bucket / 8 + 2;
+  return (uint64_t)(8 + bucket % 8) << (octave - 3);
+}
+
+static StatsEntry *_entry(StatsStore *stats, const char *name)
+{
+  for (uint32_t i = 0; i < stats->entry_count; i++)
+    if (strcmp(stats->entries[i].name, name) == 0)
+      return &stats->entries[i];
+
+  StatsEntry *entries = realloc(stats->entries, sizeof(StatsEntry) * (stats->entry_count + 1));
+  if (entries == NULL)
+    return NULL;
+  stats->entries = entries;
+
+  StatsEntry *entry = &entries[stats->entry_count++];
+  memset(entry, 0, sizeof(StatsEntry));
+  snprintf(entry->name, sizeof(entry->name), "%s", name);
+  return entry;
+}
+
+static void _apply(StatsStore *stats, const StatsResult *result)
+{
+  StatsEntry *entry = _entry(stats, result->name);
+  if (entry == NULL)
+    return;
+
+  entry->games++;
+  if (!result->won)
+    return;
+
+  entry->wins++;
+  entry->buckets[_bucket(result->time_ms)]++;
+  if (entry->wins == 1 || result->time_ms < entry->best_ms)
+  {
+    entry->best_ms = result->time_ms;
+    entry->best_seed = result->seed;
+  }
+}
+
+static bool _parse(const char *line, StatsResult *result)
+{
+  unsigned long long seed, time_ms;
+  char outcome[8];
+
+  if (sscanf(line, "%31[^,],%llu,%llu,%u,%u,%7s", result->name, &seed, &time_ms, &result->three_bv,
+             &result->clicks, outcome) != 6)
+    return false;
+
+  result->seed = seed;
+  result->time_ms = time_ms;
+  result->won = strcmp(outcome, "won") == 0;
+  return true;
+}
+
+/* Reads the index, false if there's none or it isn't one */
+static bool _read_index(StatsStore *stats)
+{
+  FILE *file = fopen(stats->index_path, "rb");
+  if (file == NULL)
+    return false;
+
+  IndexHeader header;
+  bool ok = fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, INDEX_MAGIC, 8) == 0;
+  if (ok && header.entry_count > 0)
+  {
+    stats->entries = malloc(sizeof(StatsEntry) * header.entry_count);
+    ok = stats->entries != NULL && fread(stats->entries, sizeof(StatsEntry), header.entry_count, file) == header.entry_count;
+  }
+  fclose(file);
+
+  if (!ok)
+  {
+    free(stats->entries);
+    stats->entries = NULL;
+    return false;
+  }
+
+  stats->entry_count = header.entry_count;
+  stats->log_size = header.log_size;
+  return true;
+}
+
+static bool _write_index(const StatsStore *stats)
+{
+  char temporary[sizeof(stats->index_path) + 4];
+  snprintf(temporary, sizeof(temporary), "%s.tmp", stats->index_path);
+
+  FILE *file = fopen(temporary, "wb");
+  if (file == NULL)
+    return false;
+
+  IndexHeader header = {.log_size = stats->log_size, .entry_count = stats->entry_count};
+  memcpy(header.magic, INDEX_MAGIC, 8);
+
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(stats->entries, sizeof(StatsEntry), stats->entry_count, file) == stats->entry_count;
+  ok = fclose(file) == 0 && ok;
+
+#ifdef _WIN32
+  /* rename doesn't replace files on Windows */
+  remove(stats->index_path);
+#endif
+  return ok && rename(temporary, stats->index_path) == 0;
+}
+
+/* Adds whatever the log has after stats->log_size to the entries */
+static void _replay(StatsStore *stats, uint64_t size)
+{
+  FILE *file = fopen(stats->log_path, "rb");
+  if (file == NULL)
+    return;
+
+  char line[128];
+  if (fseek(file, stats->log_size, SEEK_SET) == 0)
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+      StatsResult result;
+      if (_parse(line, &result))
+        _apply(stats, &result);
+    }
+
+  fclose(file);
+  stats->log_size = size;
+}
+
+bool stats_open(StatsStore *stats, const char *path)
+{
+  snprintf(stats->log_path, sizeof(stats->log_path), "%s.log", path);
+  snprintf(stats->index_path, sizeof(stats->index_path), "%s.idx", path);
+  stats->entries = NULL;
+  stats->entry_count = 0;
+  stats->log_size = 0;
+  stats->unsynced = 0;
+
+  stats->log = fopen(stats->log_path, "ab");
+  if (stats->log == NULL)
+    return false;
+
+  fseek(stats->log, 0, SEEK_END);
+  long size = ftell(stats->log);
+  if (size < 0)
+    size = 0;
+
+  /* A line cut short (the program died while writing it) can't take the next game with it */
+  FILE *file = (size > 0) ? fopen(stats->log_path, "rb") : NULL;
+  if (file != NULL)
+  {
+    if (fseek(file, size - 1, SEEK_SET) == 0 && fgetc(file) != '\n' && fputc('\n', stats->log) != EOF)
+      size++;
+    fclose(file);
+  }
+
+  /* A log shorter than what the index saw isn't the same log anymore */
+  if (!_read_index(stats) || stats->log_size > (uint64_t)size)
+  {
+    free(stats->entries);
+    stats->entries = NULL;
+    stats->entry_count = 0;
+    stats->log_size = 0;
+  }
+
+  /* Only the games the index hasn't seen yet */
+  if (stats->log_size < (uint64_t)size)
+  {
+    _replay(stats, size);
+    _write_index(stats);
+  }
+
+  return true;
+}
+
+void stats_close(StatsStore *stats)
+{
+  stats_sync(stats);
+  fclose(stats->log);
+  free(stats->entries);
+  stats->entries = NULL;
+  stats->entry_count = 0;
+}
+
+bool stats_record(StatsStore *stats, const StatsResult *result)
+{
+  char line[128];
+  int length = snprintf(line, sizeof(line), "%s,%llu,%llu,%u,%u,%s\n", result->name, (unsigned long long)result->seed,
+                        (unsigned long long)result->time_ms, result->three_bv, result->clicks, result->won ? "won" : "lost");
+
+  /* Out to the system right away, only syncing is batched */
+  if (length <= 0 || fputs(line, stats->log) == EOF || fflush(stats->log) != 0)
+    return false;
+
+  _apply(stats, result);
+  stats->log_size += length;
+
+  if (++stats->unsynced >= STATS_SYNC_GAMES)
+    return stats_sync(stats);
+  return true;
+}
+
+bool stats_sync(StatsStore *stats)
+{
+  if (stats->unsynced == 0)
+    return true;
+
+  bool ok = fflush(stats->log) == 0;
+#ifdef _WIN32
+  ok = _commit(_fileno(stats->log)) == 0 && ok;
+#else
+  ok = fsync(fileno(stats->log)) == 0 && ok;
+#endif
+
+  /* The index always comes after the log it accounts for is on disk */
+  ok = ok && _write_index(stats);
+  if (ok)
+    stats->unsynced = 0;
+  return ok;
+}
+
+const StatsEntry *stats_find(const StatsStore *stats, const char *name)
+{
+  for (uint32_t i = 0; i < stats->entry_count; i++)
+    if (strcmp(stats->entries[i].name, name) == 0)
+      return &stats->entries[i];
+  return NULL;
+}
+
+uint64_t stats_percentile(const StatsEntry *entry, uint32_t percent)
+{
+  if (entry->wins == 0)
+    return 0;
+
+  /* The win that's `percent`% of the way, rounding up */
+  uint64_t target = ((uint64_t)entry->wins * percent + 99) / 100;
+  if (target == 0)
+    target = 1;
+
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < STATS_BUCKETS; i++)
+  {
+    seen += entry->buckets[i];
+    if (seen >= target)
+      return _bucket_start(i);
+  }
+  return _bucket_start(STATS_BUCKETS - 1);
+}
@@ -0,0 +1,85 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Longest name a template gets on the log (custom games are named after their size) */
+#define STATS_NAME_LENGTH 32
+/* Games written to the log before it's synced to disk (and the index rewritten) */
+#define STATS_SYNC_GAMES 16
+/*
+ * Win times are counted in buckets: exact below 8ms, then 8 buckets for every power of two
+ * (each one about 9% wide), up to 2^25ms
+ */
+#define STATS_BUCKETS 184
+
+/* A finished game, one line of the log */
+typedef struct
+{
+  char name[STATS_NAME_LENGTH];
+  uint64_t seed;
+  uint64_t time_ms;
+  uint32_t three_bv;
+  uint32_t clicks;
+  bool won;
+} StatsResult;
+
+/* Everything the index knows about a template */
+typedef struct
+{
+  char name[STATS_NAME_LENGTH];
+  uint32_t games;
+  uint32_t wins;
+  /* Best winning time, and the seed it was on (0 without wins) */
+  uint64_t best_ms;
+  uint64_t best_seed;
+  /* Won games by time (see STATS_BUCKETS), for the percentiles */
+  uint32_t buckets[STATS_BUCKETS];
+} StatsEntry;
+
+/*
+ * Results of every game ever finished: an append-only log (<path>.log, one line per game)
+ * and an index of it (<path>.idx) with an entry per template, updated as games are added.
+ *
+ * Opening only reads the index, plus whatever was appended to the log after it was last
+ * written, so it doesn't matter how long the history is. Every game goes out to the log
+ * right away, but it's only synced to disk (and the index written) every STATS_SYNC_GAMES
+ * games and on stats_close. If the index ever goes missing, it's rebuilt from the log.
+ */
+typedef struct
+{
+  char log_path[256];
+  char index_path[256];
+  FILE *log;
+  StatsEntry *entries;
+  uint32_t entry_count;
+  /* Bytes of the log the entries account for */
+  uint64_t log_size;
+  /* Games added since the last stats_sync */
+  uint32_t unsynced;
+} StatsStore;
+
+/**
+ * stats_open
+ * Opens (or creates) the log and the index
+ * @param stats The store
+ * @param path Path of both files, without the extension
+ * @return false if the log couldn't be opened (nothing has to be closed then)
+ */
+bool stats_open(StatsStore *stats, const char *path);
+/* Syncs everything and closes the log */
+void stats_close(StatsStore *stats);
+
+/* Appends a game to the log and the index, returns false if it couldn't be written */
+bool stats_record(StatsStore *stats, const StatsResult *result);
+/* Syncs the log to disk and writes the index, returns false if something couldn't be written */
+bool stats_sync(StatsStore *stats);
+
+/* The index entry of a template, NULL if it was never played */
+const StatsEntry *stats_find(const StatsStore *stats, const char *name);
+/* Winning time `percent`% of the wins were at least as fast as (rounded down to its bucket), 0 without wins */
+uint64_t stats_percentile(const StatsEntry *entry, uint32_t percent);
+
+#endif /* STATS_H */
@@ -0,0 +1,92 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+void arena_init(Arena *arena, size_t block_size)
+{
+  arena->first = NULL;
+  arena->current = NULL;
+  arena->block_size = (block_size > 0) ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+}
+
+void arena_free(Arena *arena)
+{
+  ArenaBlock *block = arena->first;
+  while (block != NULL)
+  {
+    ArenaBlock *next = block->next;
+    free(block);
+    block = next;
+  }
+  arena->first = NULL;
+  arena->current = NULL;
+}
+
+void *arena_alloc(Arena *arena, size_t size)
+{
+  if (size > SIZE_MAX - ARENA_ALIGN)
+    return NULL;
+  size = (size > 0) ? (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1) : ARENA_ALIGN;
+
+  ArenaBlock *block = arena->current;
+  if (block == NULL || block->size - block->used < size)
+  {
+    /* Every block after the current one is free, take the first one that's big enough */
+    ArenaBlock **link = (block == NULL) ? &arena->first : &block->next;
+    while (*link != NULL && (*link)->size < size)
+      link = &(*link)->next;
+
+    if (*link == NULL)
+    {
+      size_t block_size = (size > arena->block_size) ? size : arena->block_size;
+      ArenaBlock *created = malloc(sizeof(ArenaBlock) + block_size);
+      if (created == NULL)
+        return NULL;
+      created->next = NULL;
+      created->size = block_size;
+      *link = created;
+    }
+
+    block = *link;
+    block->used = 0;
+    arena->current = block;
+  }
+
+  void *memory = (char *)block->data + block->used;
+  block->used += size;
+  return memory;
+}
+
+void *arena_calloc(Arena *arena, size_t count, size_t size)
+{
+  if (size != 0 && count > SIZE_MAX / size)
+    return NULL;
+
+  void *memory = arena_alloc(arena, count * size);
+  if (memory != NULL)
+    memset(memory, 0, count * size);
+  return memory;
+}
+
+ArenaMark arena_mark(const Arena *arena)
+{
+  ArenaMark mark = {.block = arena->current, .used = (arena->current != NULL) ? arena->current->used : 0};
+  return mark;
+}
+
+void arena_rewind(Arena *arena, ArenaMark mark)
+{
+  arena->current = mark.block;
+  if (mark.block != NULL)
+    mark.block->used = mark.used;
+}
+
+void arena_reset(Arena *arena)
+{
+  ArenaMark start = {NULL, 0};
+  arena_rewind(arena, start);
+}
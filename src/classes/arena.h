@@ -0,0 +1,53 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Size of the blocks when arena_init gets 0 */
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+typedef struct ArenaBlock
+{
+  struct ArenaBlock *next;
+  size_t size;
+  size_t used;
+  max_align_t data[];
+} ArenaBlock;
+
+/*
+ * Bump allocator: allocations are just a pointer moving forward in a chain of blocks,
+ * nothing is freed on its own. Everything goes at once with arena_free, or gets reused
+ * with arena_reset / arena_rewind (the blocks stay, so reusing an arena doesn't malloc).
+ * Not thread safe, every thread needs its own.
+ */
+typedef struct
+{
+  ArenaBlock *first;
+  /* Block being allocated from, the ones after it are free */
+  ArenaBlock *current;
+  size_t block_size;
+} Arena;
+
+/* A point to rewind to, everything allocated after it is given back */
+typedef struct
+{
+  ArenaBlock *block;
+  size_t used;
+} ArenaMark;
+
+/* No memory is taken until the first allocation */
+void arena_init(Arena *arena, size_t block_size);
+void arena_free(Arena *arena);
+
+/* Aligned for anything, returns NULL if there was no memory left */
+void *arena_alloc(Arena *arena, size_t size);
+/* Zeroed arena_alloc */
+void *arena_calloc(Arena *arena, size_t count, size_t size);
+
+ArenaMark arena_mark(const Arena *arena);
+void arena_rewind(Arena *arena, ArenaMark mark);
+/* Gives everything back, keeping the blocks */
+void arena_reset(Arena *arena);
+
+#endif /* ARENA_H */
@@ -0,0 +1,442 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitplane.h"
+
+/*
+ * x86 builds with GCC get the vector kernels, anything else falls
+ * back to the scalar ones (which are still a LOT faster than looping over Minefields)
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BITPLANE_X86
+#include <immintrin.h>
+#endif
+
+typedef enum
+{
+  OP_NONE,
+  OP_AND,
+  OP_ANDNOT,
+  OP_XOR
+} CountOp;
+
+typedef uint64_t (*CountKernel)(const uint64_t *a, const uint64_t *b, size_t n, CountOp op);
+
+static inline uint64_t _popcount64(uint64_t x)
+{
+#ifdef __GNUC__
+  return __builtin_popcountll(x);
+#else
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return (x * 0x0101010101010101ULL) >> 56;
+#endif
+}
+
+static inline uint64_t _combine(uint64_t a, uint64_t b, CountOp op)
+{
+  switch (op)
+  {
+  case (OP_AND):
+    return a & b;
+  case (OP_ANDNOT):
+    return a & ~b;
+  case (OP_XOR):
+    return a ^ b;
+  default:
+    return a;
+  }
+}
+
+static uint64_t _count_scalar(const uint64_t *a, const uint64_t *b, size_t n, CountOp op)
+{
+  uint64_t total = 0;
+  for (size_t i = 0; i < n; i++)
+    total += _popcount64(_combine(a[i], b ? b[i] : 0, op));
+  return total;
+}
+
+#ifdef BITPLANE_X86
+
+/* Classic SWAR popcount on 2 words at a time, then psadbw to add the bytes up */
+__attribute__((target("sse2"))) static uint64_t _count_sse2(const uint64_t *a, const uint64_t *b, size_t n, CountOp op)
+{
+  const __m128i m1 = _mm_set1_epi8(0x55);
+  const __m128i m2 = _mm_set1_epi8(0x33);
+  const __m128i m4 = _mm_set1_epi8(0x0F);
+  const __m128i zero = _mm_setzero_si128();
+  __m128i acc = _mm_setzero_si128();
+
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i *)(a + i));
+    if (op != OP_NONE)
+    {
+      __m128i w = _mm_loadu_si128((const __m128i *)(b + i));
+      if (op == OP_AND)
+        v = _mm_and_si128(v, w);
+      else if (op == OP_ANDNOT)
+        v = _mm_andnot_si128(w, v);
+      else
+        v = _mm_xor_si128(v, w);
+    }
+
+    v = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi64(v, 1), m1));
+    v = _mm_add_epi8(_mm_and_si128(v, m2), _mm_and_si128(_mm_srli_epi64(v, 2), m2));
+    v = _mm_and_si128(_mm_add_epi8(v, _mm_srli_epi64(v, 4)), m4);
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+  }
+
+  uint64_t lanes[2];
+  _mm_storeu_si128((__m128i *)lanes, acc);
+  return lanes[0] + lanes[1] + _count_scalar(a + i, b ? b + i : NULL, n - i, op);
+}
+
+/* Nibble lookup popcount (pshufb), 4 words at a time */
+__attribute__((target("avx2"))) static uint64_t _count_avx2(const uint64_t *a, const uint64_t *b, size_t n, CountOp op)
+{
+  const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                          0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0F);
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i acc = _mm256_setzero_si256();
+
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(a + i));
+    if (op != OP_NONE)
+    {
+      __m256i w = _mm256_loadu_si256((const __m256i *)(b + i));
+      if (op == OP_AND)
+        v = _mm256_and_si256(v, w);
+      else if (op == OP_ANDNOT)
+        v = _mm256_andnot_si256(w, v);
+      else
+        v = _mm256_xor_si256(v, w);
+    }
+
+    __m256i lo = _mm256_and_si256(v, low_mask);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+    __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+    acc = _mm256_add_epi64(acc, _mm256_sad_epu8(bytes, zero));
+  }
+
+  uint64_t lanes[4];
+  _mm256_storeu_si256((__m256i *)lanes, acc);
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + _count_scalar(a + i, b ? b + i : NULL, n - i, op);
+}
+
+#endif /* BITPLANE_X86 */
+
+/* Scalar until the constructor below finds something better, before main and any thread starts */
+static CountKernel count_kernel = _count_scalar;
+static const char *count_kernel_name = "scalar";
+
+#ifdef BITPLANE_X86
+__attribute__((constructor)) static void _select_kernel(void)
+{
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    count_kernel = _count_avx2;
+    count_kernel_name = "avx2";
+  }
+  else if (__builtin_cpu_supports("sse2"))
+  {
+    count_kernel = _count_sse2;
+    count_kernel_name = "sse2";
+  }
+}
+#endif
+
+static uint32_t _count(const BitPlane *a, const BitPlane *b, CountOp op)
+{
+  return count_kernel(a->words, b ? b->words : NULL, (size_t)a->height * a->row_words, op);
+}
+
+const char *bitplane_simd_name(void)
+{
+  return count_kernel_name;
+}
+
+uint32_t bitplane_count(const BitPlane *a)
+{
+  return _count(a, NULL, OP_NONE);
+}
+
+uint32_t bitplane_count_and(const BitPlane *a, const BitPlane *b)
+{
+  return _count(a, b, OP_AND);
+}
+
+uint32_t bitplane_count_andnot(const BitPlane *a, const BitPlane *b)
+{
+  return _count(a, b, OP_ANDNOT);
+}
+
+uint32_t bitplane_count_xor(const BitPlane *a, const BitPlane *b)
+{
+  return _count(a, b, OP_XOR);
+}
+
+/* Valid bits of the last word in a row */
+static inline uint64_t _tail_mask(const BitPlane *plane)
+{
+  uint16_t used = plane->width & 63;
+  return used == 0 ? ~(uint64_t)0 : (((uint64_t)1 << used) - 1);
+}
+
+bool bitplane_init(BitPlane *plane, uint16_t width, uint16_t height)
+{
+  plane->width = width;
+  plane->height = height;
+  plane->row_words = (width + 63) / 64;
+  plane->words = calloc((size_t)plane->row_words * height, sizeof(uint64_t));
+  return plane->words != NULL;
+}
+
+void bitplane_free(BitPlane *plane)
+{
+  free(plane->words);
+  plane->words = NULL;
+}
+
+void bitplane_clear(BitPlane *plane)
+{
+  memset(plane->words, 0, (size_t)plane->row_words * plane->height * sizeof(uint64_t));
+}
+
+void bitplane_copy(BitPlane *dst, const BitPlane *src)
+{
+  memcpy(dst->words, src->words, (size_t)src->row_words * src->height * sizeof(uint64_t));
+}
+
+void bitplane_dilate(BitPlane *dst, const BitPlane *src)
+{
+  const uint16_t rw = src->row_words;
+  const uint64_t tail = _tail_mask(src);
+
+  /* Horizontal pass: every row ORed with itself shifted one column each way */
+  for (uint16_t y = 0; y < src->height; y++)
+  {
+    const uint64_t *row = &src->words[y * rw];
+    uint64_t *out = &dst->words[y * rw];
+
+    for (uint16_t k = 0; k < rw; k++)
+    {
+      uint64_t right = (row[k] << 1) | (k > 0 ? row[k - 1] >> 63 : 0);
+      uint64_t left = (row[k] >> 1) | (k + 1 < rw ? row[k + 1] << 63 : 0);
+      out[k] = row[k] | left | right;
+    }
+    out[rw - 1] &= tail;
+  }
+
+  /* Vertical pass, a column of words at a time going down, so only the word above has to be kept */
+  for (uint16_t k = 0; k < rw; k++)
+  {
+    uint64_t above = 0;
+    for (uint16_t y = 0; y < src->height; y++)
+    {
+      uint64_t *out = &dst->words[y * rw + k];
+      const uint64_t current = *out;
+      const uint64_t below = (y + 1 < src->height) ? out[rw] : 0;
+      *out = current | above | below;
+      above = current;
+    }
+  }
+}
+
+bool board_planes_init(BoardPlanes *planes, uint16_t width, uint16_t height)
+{
+  BitPlane *all[] = {&planes->mines, &planes->revealed, &planes->flags, &planes->zeros, &planes->scratch[0], &planes->scratch[1]};
+  const uint8_t count = sizeof(all) / sizeof(all[0]);
+
+  for (uint8_t i = 0; i < count; i++)
+    if (!bitplane_init(all[i], width, height))
+    {
+      /* Free whatever got allocated */
+      for (uint8_t j = 0; j < i; j++)
+        bitplane_free(all[j]);
+      return false;
+    }
+
+  return true;
+}
+
+void board_planes_free(BoardPlanes *planes)
+{
+  bitplane_free(&planes->mines);
+  bitplane_free(&planes->revealed);
+  bitplane_free(&planes->flags);
+  bitplane_free(&planes->zeros);
+  bitplane_free(&planes->scratch[0]);
+  bitplane_free(&planes->scratch[1]);
+}
+
+void board_planes_load(BoardPlanes *planes, Minefield **board)
+{
+  const uint16_t width = planes->mines.width;
+  const uint16_t height = planes->mines.height;
+
+  bitplane_clear(&planes->mines);
+  bitplane_clear(&planes->revealed);
+  bitplane_clear(&planes->flags);
+
+  for (uint16_t i = 0; i < height; i++)
+    for (uint16_t j = 0; j < width; j++)
+    {
+      if (board[i][j].has_bomb)
+        bitplane_set(&planes->mines, j, i);
+      if (board[i][j].is_mined)
+        bitplane_set(&planes->revealed, j, i);
+      if (board[i][j].is_flagged)
+        bitplane_set(&planes->flags, j, i);
+    }
+
+  /* Zeros are whatever the grown mine plane doesn't touch */
+  bitplane_dilate(&planes->zeros, &planes->mines);
+  const uint16_t rw = planes->zeros.row_words;
+  const uint64_t tail = _tail_mask(&planes->zeros);
+  for (uint16_t i = 0; i < height; i++)
+  {
+    for (uint16_t k = 0; k < rw; k++)
+      planes->zeros.words[i * rw + k] = ~planes->zeros.words[i * rw + k];
+    planes->zeros.words[i * rw + rw - 1] &= tail;
+  }
+}
+
+uint32_t board_planes_revealed_safe(const BoardPlanes *planes)
+{
+  return bitplane_count_andnot(&planes->revealed, &planes->mines);
+}
+
+uint32_t board_planes_flag_mismatch(const BoardPlanes *planes)
+{
+  return bitplane_count_xor(&planes->flags, &planes->mines);
+}
+
+/* First column from `x` on that is set (or clear if `set` is false), the width if there's none */
+static uint32_t _scan(const uint64_t *row, uint32_t width, uint32_t x, bool set)
+{
+  while (x < width)
+  {
+    uint64_t word = set ? row[x >> 6] : ~row[x >> 6];
+    word &= ~(uint64_t)0 << (x & 63);
+    if (word != 0)
+    {
+      const uint32_t found = (x & ~63u) + __builtin_ctzll(word);
+      return found < width ? found : width;
+    }
+    x = (x | 63) + 1;
+  }
+  return width;
+}
+
+/* Union-find with path halving, over the runs */
+static uint32_t _find(uint32_t *parent, uint32_t run)
+{
+  while (parent[run] != run)
+  {
+    parent[run] = parent[parent[run]];
+    run = parent[run];
+  }
+  return run;
+}
+
+/*
+ * 8-connected groups of set bits, in a single pass: every row is cut into runs of set bits, and each
+ * run is joined to the runs of the row above that touch it (diagonals included). Every run starts
+ * as a group of its own and every join that merges two groups takes one away.
+ */
+static bool _groups(const BitPlane *plane, Arena *scratch, uint32_t *groups)
+{
+  /* A row can't have more runs than every other cell */
+  const uint32_t row_runs = (plane->width + 1) / 2;
+  const ArenaMark mark = arena_mark(scratch);
+  uint32_t *parent = arena_alloc(scratch, sizeof(uint32_t) * row_runs * plane->height);
+  uint16_t *starts = arena_alloc(scratch, sizeof(uint16_t) * row_runs * 2);
+  uint16_t *ends = arena_alloc(scratch, sizeof(uint16_t) * row_runs * 2);
+  if (parent == NULL || starts == NULL || ends == NULL)
+  {
+    arena_rewind(scratch, mark);
+    return false;
+  }
+
+  /* Runs of the row above and of this one, half of `starts` and `ends` each (taking turns) */
+  uint32_t runs = 0, above_first = 0, above_count = 0;
+  *groups = 0;
+  for (uint16_t y = 0; y < plane->height; y++)
+  {
+    const uint64_t *row = &plane->words[y * plane->row_words];
+    const uint32_t side = (y & 1) ? row_runs : 0, above_side = row_runs - side;
+    uint32_t count = 0, j = 0;
+
+    for (uint32_t x = _scan(row, plane->width, 0, true); x < plane->width; x = _scan(row, plane->width, x, true))
+    {
+      const uint32_t end = _scan(row, plane->width, x, false) - 1;
+      const uint32_t run = runs + count;
+      starts[side + count] = x;
+      ends[side + count] = end;
+      parent[run] = run;
+      count++;
+      (*groups)++;
+
+      /* Runs above that end before this one (diagonals count) can't touch the next ones either */
+      while (j < above_count && ends[above_side + j] + 1 < x)
+        j++;
+      for (uint32_t i = j; i < above_count && starts[above_side + i] <= end + 1; i++)
+      {
+        const uint32_t a = _find(parent, above_first + i), b = _find(parent, run);
+        if (a != b)
+        {
+          parent[b] = a;
+          (*groups)--;
+        }
+      }
+      x = end + 1;
+    }
+
+    above_first = runs;
+    above_count = count;
+    runs += count;
+  }
+
+  arena_rewind(scratch, mark);
+  return true;
+}
+
+bool board_planes_openings(const BoardPlanes *planes, Arena *scratch, uint32_t *openings)
+{
+  return _groups(&planes->zeros, scratch, openings);
+}
+
+bool board_planes_3bv(const BoardPlanes *planes, Arena *scratch, uint32_t *openings, uint32_t *lonely, uint32_t *islands)
+{
+  const ArenaMark mark = arena_mark(scratch);
+  BitPlane numbers = planes->zeros;
+  numbers.words = arena_alloc(scratch, sizeof(uint64_t) * planes->zeros.row_words * planes->zeros.height);
+  if (numbers.words == NULL || !_groups(&planes->zeros, scratch, openings))
+  {
+    arena_rewind(scratch, mark);
+    return false;
+  }
+
+  /* Numbers no 0 touches: neither a bomb nor next to (or on) a 0 */
+  bitplane_dilate(&numbers, &planes->zeros);
+  const uint16_t rw = numbers.row_words;
+  const uint64_t tail = _tail_mask(&numbers);
+  for (uint16_t i = 0; i < numbers.height; i++)
+  {
+    for (uint16_t k = 0; k < rw; k++)
+      numbers.words[i * rw + k] = ~(numbers.words[i * rw + k] | planes->mines.words[i * rw + k]);
+    numbers.words[i * rw + rw - 1] &= tail;
+  }
+
+  *lonely = bitplane_count(&numbers);
+  const bool counted = _groups(&numbers, scratch, islands);
+  arena_rewind(scratch, mark);
+  return counted;
+}
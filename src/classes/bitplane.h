@@ -0,0 +1,97 @@
+#ifndef BITPLANE_H
+#define BITPLANE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "arena.h"
+#include "minefield.h"
+
+/*
+ * One bit per cell, rows padded to whole 64-bit words so vertical neighbours
+ * are always exactly `row_words` words away. Padding bits are kept at 0 by every
+ * function in here, that way the counting kernels can just run over all the words.
+ */
+typedef struct
+{
+  uint16_t width;
+  uint16_t height;
+  uint16_t row_words;
+  uint64_t *words;
+} BitPlane;
+
+/* Returns false if allocation failed */
+bool bitplane_init(BitPlane *plane, uint16_t width, uint16_t height);
+void bitplane_free(BitPlane *plane);
+void bitplane_clear(BitPlane *plane);
+void bitplane_copy(BitPlane *dst, const BitPlane *src);
+
+static inline void bitplane_set(BitPlane *plane, uint16_t x, uint16_t y)
+{
+  plane->words[y * plane->row_words + (x >> 6)] |= (uint64_t)1 << (x & 63);
+}
+
+static inline bool bitplane_get(const BitPlane *plane, uint16_t x, uint16_t y)
+{
+  return (plane->words[y * plane->row_words + (x >> 6)] >> (x & 63)) & 1;
+}
+
+/*
+ * Counting kernels, all of them use the widest implementation the CPU supports
+ * (AVX2, SSE2 or plain scalar), picked once at startup before main runs.
+ */
+uint32_t bitplane_count(const BitPlane *a);
+/* popcount(a & b) */
+uint32_t bitplane_count_and(const BitPlane *a, const BitPlane *b);
+/* popcount(a & ~b) */
+uint32_t bitplane_count_andnot(const BitPlane *a, const BitPlane *b);
+/* popcount(a ^ b) */
+uint32_t bitplane_count_xor(const BitPlane *a, const BitPlane *b);
+
+/* dst = src grown by one cell in all 8 directions (dst and src must be different planes) */
+void bitplane_dilate(BitPlane *dst, const BitPlane *src);
+
+/* Name of the kernel set in use: "avx2", "sse2" or "scalar" */
+const char *bitplane_simd_name(void);
+
+/*
+ * The three planes a board's state can be split into, plus the zero plane
+ * (safe cells with no bombs around them) and some scratch space for the opening search.
+ */
+typedef struct
+{
+  BitPlane mines;
+  BitPlane revealed;
+  BitPlane flags;
+  BitPlane zeros;
+  BitPlane scratch[2];
+} BoardPlanes;
+
+bool board_planes_init(BoardPlanes *planes, uint16_t width, uint16_t height);
+void board_planes_free(BoardPlanes *planes);
+
+/* Fill every plane from a Minefield board of the same size as the planes */
+void board_planes_load(BoardPlanes *planes, Minefield **board);
+
+/* Safe cells that have been revealed (the win condition is this == width * height - bombs) */
+uint32_t board_planes_revealed_safe(const BoardPlanes *planes);
+/* Flags that aren't on a bomb plus bombs that aren't flagged */
+uint32_t board_planes_flag_mismatch(const BoardPlanes *planes);
+/**
+ * board_planes_openings
+ * Amount of openings (8-connected groups of 0s) on the board, labeled in a single pass over the zero plane
+ * @param scratch Arena for the temporary memory (given back before returning)
+ * @return false if memory couldn't be allocated
+ */
+bool board_planes_openings(const BoardPlanes *planes, Arena *scratch, uint32_t *openings);
+
+/**
+ * board_planes_3bv
+ * What metrics_compute_3bv counts, out of the planes: openings, numbers that aren't touching any
+ * opening (3BV is openings + lonely) and the 8-connected groups those numbers make
+ * @param scratch Arena for the temporary memory (given back before returning)
+ * @return false if memory couldn't be allocated
+ */
+bool board_planes_3bv(const BoardPlanes *planes, Arena *scratch, uint32_t *openings, uint32_t *lonely, uint32_t *islands);
+
+#endif /* BITPLANE_H */
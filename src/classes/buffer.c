@@ -0,0 +1,53 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "buffer.h"
+
+#define BUFFER_MIN_CAPACITY 256
+
+void buffer_init(Buffer *buffer)
+{
+  buffer->data = NULL;
+  buffer->length = 0;
+  buffer->capacity = 0;
+}
+
+void buffer_free(Buffer *buffer)
+{
+  free(buffer->data);
+  buffer_init(buffer);
+}
+
+bool buffer_append(Buffer *buffer, const char *data, size_t length)
+{
+  if (buffer->length + length > buffer->capacity)
+  {
+    /* Double until it fits */
+    size_t capacity = buffer->capacity ? buffer->capacity : BUFFER_MIN_CAPACITY;
+    while (capacity < buffer->length + length)
+      capacity *= 2;
+
+    char *grown = realloc(buffer->data, capacity);
+    if (grown == NULL)
+      return false;
+
+    buffer->data = grown;
+    buffer->capacity = capacity;
+  }
+
+  memcpy(buffer->data + buffer->length, data, length);
+  buffer->length += length;
+  return true;
+}
+
+void buffer_consume(Buffer *buffer, size_t length)
+{
+  if (length >= buffer->length)
+  {
+    buffer->length = 0;
+    return;
+  }
+
+  memmove(buffer->data, buffer->data + length, buffer->length - length);
+  buffer->length -= length;
+}
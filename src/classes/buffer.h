@@ -0,0 +1,23 @@
+#ifndef BUFFER_H
+#define BUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Growable byte buffer, used to collect output before sending it somewhere */
+typedef struct
+{
+  char *data;
+  size_t length;
+  size_t capacity;
+} Buffer;
+
+void buffer_init(Buffer *buffer);
+void buffer_free(Buffer *buffer);
+
+/* Returns false if the buffer couldn't grow (nothing gets appended then) */
+bool buffer_append(Buffer *buffer, const char *data, size_t length);
+/* Drops the first `length` bytes (what was already sent) */
+void buffer_consume(Buffer *buffer, size_t length);
+
+#endif /* BUFFER_H */
@@ -0,0 +1,96 @@
+#include <stddef.h>
+
+#include "journal.h"
+
+void journal_init(Journal *journal, Arena *arena)
+{
+  journal->arena = arena;
+  journal->first = NULL;
+  journal_clear(journal);
+}
+
+void journal_clear(Journal *journal)
+{
+  journal->chunk = NULL;
+  journal->position = 0;
+  journal->length = 0;
+  journal->end = 0;
+}
+
+/* The chunk after the cursor's (the first one if the cursor hasn't got one yet) */
+static JournalChunk *_next_chunk(const Journal *journal)
+{
+  return (journal->chunk == NULL) ? journal->first : journal->chunk->next;
+}
+
+bool journal_push(Journal *journal, uint32_t entry)
+{
+  if (journal->chunk == NULL || journal->position == JOURNAL_CHUNK_ENTRIES)
+  {
+    JournalChunk *next = _next_chunk(journal);
+    if (next == NULL)
+    {
+      next = arena_alloc(journal->arena, sizeof(JournalChunk));
+      if (next == NULL)
+        return false;
+
+      next->prev = journal->chunk;
+      next->next = NULL;
+      if (journal->chunk == NULL)
+        journal->first = next;
+      else
+        journal->chunk->next = next;
+    }
+
+    journal->chunk = next;
+    journal->position = 0;
+  }
+
+  journal->chunk->entries[journal->position++] = entry;
+  journal->end = ++journal->length;
+  return true;
+}
+
+bool journal_back(Journal *journal, uint32_t *entry)
+{
+  if (journal->length == 0)
+    return false;
+
+  if (journal->position == 0)
+  {
+    journal->chunk = journal->chunk->prev;
+    journal->position = JOURNAL_CHUNK_ENTRIES;
+  }
+
+  *entry = journal->chunk->entries[--journal->position];
+  journal->length--;
+  return true;
+}
+
+bool journal_forward(Journal *journal, uint32_t *entry)
+{
+  if (!journal_peek(journal, entry))
+    return false;
+
+  if (journal->chunk == NULL || journal->position == JOURNAL_CHUNK_ENTRIES)
+  {
+    journal->chunk = _next_chunk(journal);
+    journal->position = 0;
+  }
+
+  journal->position++;
+  journal->length++;
+  return true;
+}
+
+bool journal_peek(const Journal *journal, uint32_t *entry)
+{
+  if (journal->length == journal->end)
+    return false;
+
+  if (journal->chunk == NULL || journal->position == JOURNAL_CHUNK_ENTRIES)
+    *entry = _next_chunk(journal)->entries[0];
+  else
+    *entry = journal->chunk->entries[journal->position];
+  return true;
+}
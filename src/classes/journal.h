@@ -0,0 +1,52 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+/* Entries every chunk holds */
+#define JOURNAL_CHUNK_ENTRIES 1024
+
+typedef struct JournalChunk
+{
+  struct JournalChunk *prev;
+  struct JournalChunk *next;
+  uint32_t entries[JOURNAL_CHUNK_ENTRIES];
+} JournalChunk;
+
+/*
+ * Undo log: a list of 32 bit entries and a cursor that goes back (undo) and forth (redo) over it.
+ * Entries mean whatever the owner wants, the journal just stores them.
+ *
+ * Chunks come from an arena and stay linked once allocated, pushing after going back drops
+ * the entries after the cursor (like any redo history) and reuses their chunks.
+ */
+typedef struct
+{
+  Arena *arena;
+  JournalChunk *first;
+  /* The cursor: chunk and position the next entry is written at */
+  JournalChunk *chunk;
+  uint32_t position;
+  /* Entries before the cursor, and entries there are in total (the ones after the cursor can be redone) */
+  uint32_t length;
+  uint32_t end;
+} Journal;
+
+/* No memory is taken until the first push */
+void journal_init(Journal *journal, Arena *arena);
+/* Forgets every entry, keeping the chunks */
+void journal_clear(Journal *journal);
+
+/* Writes an entry at the cursor and drops everything after it, returns false if there was no memory left */
+bool journal_push(Journal *journal, uint32_t entry);
+/* Moves the cursor back over an entry, false if it's at the start */
+bool journal_back(Journal *journal, uint32_t *entry);
+/* Moves the cursor forward over an entry, false if it's at the end */
+bool journal_forward(Journal *journal, uint32_t *entry);
+/* The entry journal_forward would return, without moving */
+bool journal_peek(const Journal *journal, uint32_t *entry);
+
+#endif /* JOURNAL_H */
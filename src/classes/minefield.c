@@ -1,3 +1,6 @@
+#include <stdlib.h>
+#include <string.h>
+
 #include "minefield.h"
 
 /* Just initialize it */
@@ -7,4 +10,29 @@ void init_minefield(Minefield *minefield)
   minefield->has_bomb = false;
   minefield->is_flagged = false;
   minefield->is_mined = false;
-}
\ No newline at end of file
+}
+
+Minefield **minefield_board_alloc(uint16_t width, uint16_t height, Arena *arena)
+{
+  Minefield **board = arena_alloc(arena, sizeof(Minefield *) * height);
+  Minefield *cells = arena_alloc(arena, sizeof(Minefield) * width * height);
+  if (board == NULL || cells == NULL)
+    return NULL;
+
+  /* Rows are just pointers into the cells, one after the other */
+  for (uint16_t i = 0; i < height; i++)
+  {
+    board[i] = &cells[(uint32_t)i * width];
+    /* Init every space in the row */
+    for (uint16_t j = 0; j < width; j++)
+      init_minefield(&board[i][j]);
+  }
+
+  return board;
+}
+
+void minefield_board_copy(Minefield **dst, Minefield **src, uint16_t width, uint16_t height)
+{
+  for (uint16_t i = 0; i < height; i++)
+    memcpy(dst[i], src[i], sizeof(Minefield) * width);
+}
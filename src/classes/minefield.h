@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "arena.h"
+
 /* Minefield struct definition */
 typedef struct
 {
@@ -15,4 +17,12 @@ typedef struct
 
 void init_minefield(Minefield *minefield);
 
-#endif /* MINEFIELD_H */
\ No newline at end of file
+/*
+ * Creates a 2D array of initialized Minefields (a single allocation, the arena owns it),
+ * returns NULL if allocation was unsuccesful
+ */
+Minefield **minefield_board_alloc(uint16_t width, uint16_t height, Arena *arena);
+/* Copies every cell of src into dst (both must have the same size) */
+void minefield_board_copy(Minefield **dst, Minefield **src, uint16_t width, uint16_t height);
+
+#endif /* MINEFIELD_H */
@@ -0,0 +1,32 @@
+#include "rng.h"
+
+/* splitmix64 step, spreads similar seeds (1, 2, 3...) far apart */
+static uint64_t _mix(uint64_t x)
+{
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+void rng_seed(Rng *rng, uint64_t seed)
+{
+  rng->state = _mix(seed);
+  /* xorshift gets stuck on 0 forever */
+  if (rng->state == 0)
+    rng->state = 0x9E3779B97F4A7C15ULL;
+}
+
+uint64_t rng_next(Rng *rng)
+{
+  rng->state ^= rng->state >> 12;
+  rng->state ^= rng->state << 25;
+  rng->state ^= rng->state >> 27;
+  return rng->state * 0x2545F4914F6CDD1DULL;
+}
+
+uint32_t rng_below(Rng *rng, uint32_t bound)
+{
+  /* Multiply-shift instead of modulo, a lot less biased for big bounds */
+  return (uint32_t)(((rng_next(rng) >> 32) * bound) >> 32);
+}
@@ -0,0 +1,21 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+/*
+ * Small seedable random number generator (xorshift64*), every thread or
+ * generator gets its own instead of sharing rand()'s hidden global state.
+ */
+typedef struct
+{
+  uint64_t state;
+} Rng;
+
+/* Any seed is fine, including 0 */
+void rng_seed(Rng *rng, uint64_t seed);
+uint64_t rng_next(Rng *rng);
+/* Uniform number in [0, bound) */
+uint32_t rng_below(Rng *rng, uint32_t bound);
+
+#endif /* RNG_H */
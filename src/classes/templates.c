@@ -4,18 +4,30 @@
 
 void template_init(Template *templ, const char *name, uint16_t width, uint16_t height, uint16_t bomb_amount)
 {
-  /* Copy the name to the struct */
-  memcpy(templ->name, name, sizeof(templ->name) - 1);
+  /* Copy the name to the struct, names that don't fit get cut */
+  strncpy(templ->name, name, sizeof(templ->name) - 1);
   /* Null terminate it just in case */
   templ->name[sizeof(templ->name) - 1] = '\0';
 
   templ->width = width;
   templ->height = height;
   templ->bomb_amount = bomb_amount;
+
+  /* Any board is fine unless template_difficulty says otherwise */
+  templ->min_3bv = 0;
+  templ->max_3bv = 0;
+  templ->max_tier = 0;
 }
 
 void template_colors(Template *templ, uint8_t fg_color, uint8_t bg_color)
 {
   templ->fg_color = fg_color;
   templ->bg_color = bg_color;
+}
+
+void template_difficulty(Template *templ, uint16_t min_3bv, uint16_t max_3bv, uint8_t max_tier)
+{
+  templ->min_3bv = min_3bv;
+  templ->max_3bv = max_3bv;
+  templ->max_tier = max_tier;
 }
\ No newline at end of file
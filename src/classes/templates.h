@@ -13,9 +13,17 @@ typedef struct
   uint16_t bomb_amount;
   uint8_t fg_color;
   uint8_t bg_color;
+  /*
+   * Difficulty the generated boards must fall in, 0 means no limit
+   * max_tier uses the SolverTier values from app/solver.h
+   */
+  uint16_t min_3bv;
+  uint16_t max_3bv;
+  uint8_t max_tier;
 } Template;
 
 void template_init(Template *templ, const char *name, uint16_t width, uint16_t height, uint16_t bomb_amount);
 void template_colors(Template *templ, uint8_t fg_color, uint8_t bg_color);
+void template_difficulty(Template *templ, uint16_t min_3bv, uint16_t max_3bv, uint8_t max_tier);
 
 #endif /* TEMPLATES_H */
\ No newline at end of file
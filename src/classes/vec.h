@@ -1,3 +1,7 @@
+#ifndef VEC_H
+#define VEC_H
+
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef struct
@@ -6,4 +10,6 @@ typedef struct
   int32_t y;
 } Vec2;
 
-bool vec_cmpr(Vec2 vec_a, Vec2 vec_b);
\ No newline at end of file
+bool vec_cmpr(Vec2 vec_a, Vec2 vec_b);
+
+#endif /* VEC_H */
@@ -0,0 +1,1819 @@
+/**
+ * engine_test.c
+ * Differential test for the engine ('make test'): random seeded games are played on the engine
+ * and on a reference model at the same time, and the boards are compared after every step.
+ *
+ * The reference is the game as simple as it gets, the way game.c first did it: a recursive
+ * _show_field, a _sweep_field that counts the flags around, every counter recounted from scratch
+ * and undo/redo as copies of the whole board. Generation is checked against the original
+ * counting loop of _generate_bombs.
+ *
+ * Every sequence comes from its own seed, the workers take them in order. The first failure
+ * stops everyone, gets shrunk (actions are dropped while it keeps failing) and is printed as
+ * a line that replays it:
+ *
+ * engine_test [sequences] [threads]
+ * engine_test --replay "<width> <height> <bombs> <seed> <actions...>"
+ *
+ * Actions are c<x>,<y> (click), f<x>,<y> (flag), s (sweep all), u (undo) and r (redo).
+ *
+ * The bit plane engine (bitengine.h) plays every case along with the engine and has to match it,
+ * it picks the position up from the engine's board after undos and redos (it has none of its own).
+ * The bit plane kernels it's built on (bitplane.h) have to count what metrics.h counts on the board.
+ *
+ * Then the shared board (coop.h) gets dozens of threads playing on it at once, and once they're
+ * done its counters, its floods and what every player's change feed said are checked against the cells.
+ *
+ * The sampler (sampler.h) has to land close to the exact chances on boards small enough to count
+ * every layout of, and is timed on a big one.
+ *
+ * Last, a server (server.h) gets forked off and a scripted client opens a burst of sessions on it,
+ * plays a few keys on each and times how long one already playing waits while the rest get their boards
+ * (and then sends it a burst of arrow keys at once).
+ * A coop server gets players one after the other, each one playing the shared board to its end.
+ */
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#endif
+
+#include "app/bitengine.h"
+#include "app/coop.h"
+#include "app/engine.h"
+#include "app/generator.h"
+#include "app/metrics.h"
+#include "app/sampler.h"
+#include "app/server.h"
+#include "app/solver.h"
+#include "classes/arena.h"
+#include "classes/minefield.h"
+#include "classes/rng.h"
+#include "classes/templates.h"
+#include "utils/consoleutils.h"
+#include "utils/threads.h"
+#include "utils/timer.h"
+
+#define MAX_WIDTH 36
+#define MAX_HEIGHT 30
+/* Random sizes stay smaller, the reference gets slow on big boards */
+#define RANDOM_WIDTH 30
+#define RANDOM_HEIGHT 20
+#define MAX_CELLS (MAX_WIDTH * MAX_HEIGHT)
+#define MAX_ACTIONS 120
+#define DEFAULT_SEQUENCES 1000000
+
+typedef enum
+{
+  ACTION_CLICK,
+  ACTION_FLAG,
+  ACTION_SWEEP_ALL,
+  ACTION_UNDO,
+  ACTION_REDO
+} ActionKind;
+
+typedef struct
+{
+  uint8_t kind;
+  uint16_t x;
+  uint16_t y;
+} Action;
+
+/* A board and what's done on it */
+typedef struct
+{
+  uint16_t width;
+  uint16_t height;
+  uint16_t bombs;
+  uint64_t seed;
+  uint32_t action_count;
+  Action actions[MAX_ACTIONS];
+} Case;
+
+/*
+REFERENCE MODEL
+*/
+
+/* Everything an action can change, undo/redo just copy it around */
+typedef struct
+{
+  bool flagged[MAX_CELLS];
+  bool shown[MAX_CELLS];
+  EngineState state;
+} RefGame;
+
+typedef struct
+{
+  uint16_t width;
+  uint16_t height;
+  bool bomb[MAX_CELLS];
+  uint8_t count[MAX_CELLS];
+  RefGame game;
+  RefGame undo[MAX_ACTIONS];
+  RefGame redo[MAX_ACTIONS];
+  uint32_t undo_count;
+  uint32_t redo_count;
+} Reference;
+
+static void _ref_show(Reference *ref, int32_t x, int32_t y);
+
+static void _ref_show_surrounding(Reference *ref, int32_t x, int32_t y, bool bypass_flags)
+{
+  for (int32_t i = -1; i <= 1; i++)
+    for (int32_t j = -1; j <= 1; j++)
+    {
+      if (y + i < 0 || y + i >= ref->height || x + j < 0 || x + j >= ref->width || (i == 0 && j == 0))
+        continue;
+      if (!bypass_flags && ref->game.flagged[(y + i) * ref->width + x + j])
+        continue;
+      _ref_show(ref, x + j, y + i);
+    }
+}
+
+static void _ref_show(Reference *ref, int32_t x, int32_t y)
+{
+  const int32_t index = y * ref->width + x;
+  if (ref->game.shown[index])
+    return;
+
+  ref->game.shown[index] = true;
+  ref->game.flagged[index] = false;
+  if (ref->bomb[index])
+    ref->game.state = ENGINE_LOST;
+
+  if (ref->count[index] == 0)
+    _ref_show_surrounding(ref, x, y, true);
+}
+
+static uint8_t _ref_flags_around(const Reference *ref, int32_t x, int32_t y)
+{
+  uint8_t flags = 0;
+  for (int32_t i = -1; i <= 1; i++)
+    for (int32_t j = -1; j <= 1; j++)
+      if (y + i >= 0 && y + i < ref->height && x + j >= 0 && x + j < ref->width)
+        flags += ref->game.flagged[(y + i) * ref->width + x + j];
+  return flags;
+}
+
+static void _ref_sweep(Reference *ref, int32_t x, int32_t y)
+{
+  const int32_t index = y * ref->width + x;
+  if (ref->game.shown[index] && _ref_flags_around(ref, x, y) == ref->count[index])
+    _ref_show_surrounding(ref, x, y, false);
+}
+
+static void _ref_check_win(Reference *ref)
+{
+  uint32_t shown = 0, safe = 0;
+  for (int32_t i = 0; i < ref->width * ref->height; i++)
+  {
+    safe += !ref->bomb[i];
+    shown += ref->game.shown[i] && !ref->bomb[i];
+  }
+
+  if (ref->game.state == ENGINE_PLAYING && shown == safe)
+  {
+    ref->game.state = ENGINE_WON;
+    for (int32_t i = 0; i < ref->width * ref->height; i++)
+      if (ref->bomb[i])
+        ref->game.flagged[i] = true;
+  }
+}
+
+static void _ref_apply(Reference *ref, const Action *action)
+{
+  if (action->kind == ACTION_UNDO || action->kind == ACTION_REDO)
+  {
+    RefGame *from = (action->kind == ACTION_UNDO) ? ref->undo : ref->redo;
+    RefGame *to = (action->kind == ACTION_UNDO) ? ref->redo : ref->undo;
+    uint32_t *from_count = (action->kind == ACTION_UNDO) ? &ref->undo_count : &ref->redo_count;
+    uint32_t *to_count = (action->kind == ACTION_UNDO) ? &ref->redo_count : &ref->undo_count;
+
+    if (*from_count == 0)
+      return;
+    to[(*to_count)++] = ref->game;
+    ref->game = from[--(*from_count)];
+    return;
+  }
+
+  const RefGame before = ref->game;
+  const int32_t index = action->y * ref->width + action->x;
+
+  if (ref->game.state == ENGINE_PLAYING)
+  {
+    if (action->kind == ACTION_CLICK)
+    {
+      if (ref->bomb[index])
+        ref->game.state = ENGINE_LOST;
+      else if (ref->game.shown[index])
+        _ref_sweep(ref, action->x, action->y);
+      else if (!ref->game.flagged[index])
+        _ref_show(ref, action->x, action->y);
+      _ref_check_win(ref);
+    }
+    else if (action->kind == ACTION_FLAG)
+    {
+      if (!ref->game.shown[index])
+        ref->game.flagged[index] = !ref->game.flagged[index];
+    }
+    else
+    {
+      for (int32_t y = 0; y < ref->height && ref->game.state == ENGINE_PLAYING; y++)
+        for (int32_t x = 0; x < ref->width && ref->game.state == ENGINE_PLAYING; x++)
+          if (!ref->bomb[y * ref->width + x] && ref->count[y * ref->width + x] > 0)
+            _ref_sweep(ref, x, y);
+      _ref_check_win(ref);
+    }
+  }
+
+  /* Only actions that changed something can be undone, and they drop what was undone */
+  if (memcmp(&before, &ref->game, sizeof(RefGame)) != 0)
+  {
+    ref->undo[ref->undo_count++] = before;
+    ref->redo_count = 0;
+  }
+}
+
+/* 3BV left, straight from the definition: openings without a shown 0, plus lonely numbers that aren't shown */
+static bool _ref_is_zero(const Reference *ref, int32_t x, int32_t y)
+{
+  return !ref->bomb[y * ref->width + x] && ref->count[y * ref->width + x] == 0;
+}
+
+static bool _ref_flood_opening(const Reference *ref, int32_t x, int32_t y, bool *seen)
+{
+  bool opened = ref->game.shown[y * ref->width + x];
+  seen[y * ref->width + x] = true;
+
+  for (int32_t i = -1; i <= 1; i++)
+    for (int32_t j = -1; j <= 1; j++)
+    {
+      if (y + i < 0 || y + i >= ref->height || x + j < 0 || x + j >= ref->width)
+        continue;
+      if (_ref_is_zero(ref, x + j, y + i) && !seen[(y + i) * ref->width + x + j])
+        opened = _ref_flood_opening(ref, x + j, y + i, seen) || opened;
+    }
+  return opened;
+}
+
+static uint32_t _ref_remaining_3bv(const Reference *ref)
+{
+  bool seen[MAX_CELLS] = {false};
+  uint32_t remaining = 0;
+
+  for (int32_t y = 0; y < ref->height; y++)
+    for (int32_t x = 0; x < ref->width; x++)
+    {
+      const int32_t index = y * ref->width + x;
+      if (ref->bomb[index])
+        continue;
+
+      if (_ref_is_zero(ref, x, y))
+      {
+        if (!seen[index])
+          remaining += !_ref_flood_opening(ref, x, y, seen);
+        continue;
+      }
+
+      bool touches_zero = false;
+      for (int32_t i = -1; i <= 1; i++)
+        for (int32_t j = -1; j <= 1; j++)
+          if (y + i >= 0 && y + i < ref->height && x + j >= 0 && x + j < ref->width)
+            touches_zero = touches_zero || _ref_is_zero(ref, x + j, y + i);
+      remaining += !touches_zero && !ref->game.shown[index];
+    }
+
+  return remaining;
+}
+
+/*
+RUNNING A CASE
+*/
+
+/* Memory a worker reuses for all of its cases */
+typedef struct
+{
+  Arena arena;
+  Arena journal_arena;
+  Reference ref;
+} Workspace;
+
+/* Checks the generated board against the original counting, writes what's wrong to `why` */
+static bool _check_generation(Workspace *space, const Case *test, Minefield **board, char *why, size_t why_size)
+{
+  const uint16_t w = test->width, h = test->height;
+  Minefield **again = minefield_board_alloc(w, h, &space->arena);
+  if (again == NULL)
+  {
+    snprintf(why, why_size, "out of memory");
+    return false;
+  }
+
+  Vec2 blessing = generator_fill(board, w, h, test->bombs, test->seed, &space->arena);
+  Vec2 blessing_again = generator_fill(again, w, h, test->bombs, test->seed, &space->arena);
+
+  uint8_t counts[MAX_CELLS] = {0};
+  uint32_t bombs = 0, zeros = 0;
+  for (int32_t y = 0; y < h; y++)
+    for (int32_t x = 0; x < w; x++)
+    {
+      if (!board[y][x].has_bomb)
+        continue;
+      bombs++;
+      /* _generate_bombs counted the bomb itself too */
+      for (int32_t k = -1; k <= 1; k++)
+        for (int32_t l = -1; l <= 1; l++)
+          if (y + k >= 0 && y + k < h && x + l >= 0 && x + l < w)
+            counts[(y + k) * w + x + l]++;
+    }
+
+  for (int32_t y = 0; y < h; y++)
+    for (int32_t x = 0; x < w; x++)
+    {
+      const Minefield *field = &board[y][x];
+      zeros += !field->has_bomb && field->bomb_amount == 0;
+
+      if (field->bomb_amount != counts[y * w + x] || field->is_flagged || field->is_mined)
+      {
+        snprintf(why, why_size, "generated cell (%d, %d) has %u bombs around, expected %u", x, y, field->bomb_amount, counts[y * w + x]);
+        return false;
+      }
+      if (memcmp(field, &again[y][x], sizeof(Minefield)) != 0)
+      {
+        snprintf(why, why_size, "the same seed generated a different cell at (%d, %d)", x, y);
+        return false;
+      }
+    }
+
+  if (bombs != test->bombs)
+  {
+    snprintf(why, why_size, "generated %u bombs, expected %u", bombs, test->bombs);
+    return false;
+  }
+
+  bool blessing_ok = (blessing.x < 0) ? zeros == 0 : !board[blessing.y][blessing.x].has_bomb && board[blessing.y][blessing.x].bomb_amount == 0;
+  if (!blessing_ok || !vec_cmpr(blessing, blessing_again))
+  {
+    snprintf(why, why_size, "bad blessing (%d, %d)", blessing.x, blessing.y);
+    return false;
+  }
+  return true;
+}
+
+static bool _compare(const Reference *ref, const Engine *engine, char *why, size_t why_size)
+{
+  uint32_t revealed = 0, flags = 0, correct_flags = 0;
+
+  for (int32_t y = 0; y < ref->height; y++)
+    for (int32_t x = 0; x < ref->width; x++)
+    {
+      const int32_t index = y * ref->width + x;
+      const Minefield *field = &engine->board[y][x];
+
+      if (field->is_mined != ref->game.shown[index] || field->is_flagged != ref->game.flagged[index])
+      {
+        snprintf(why, why_size, "cell (%d, %d) is %s%s, expected %s%s", x, y, field->is_mined ? "shown" : "covered",
+                 field->is_flagged ? " and flagged" : "", ref->game.shown[index] ? "shown" : "covered",
+                 ref->game.flagged[index] ? " and flagged" : "");
+        return false;
+      }
+
+      revealed += ref->game.shown[index] && !ref->bomb[index];
+      flags += ref->game.flagged[index];
+      correct_flags += ref->game.flagged[index] && ref->bomb[index];
+
+      uint8_t flags_around = 0, hidden_around = 0;
+      for (int32_t i = -1; i <= 1; i++)
+        for (int32_t j = -1; j <= 1; j++)
+        {
+          if (y + i < 0 || y + i >= ref->height || x + j < 0 || x + j >= ref->width || (i == 0 && j == 0))
+            continue;
+          flags_around += ref->game.flagged[(y + i) * ref->width + x + j];
+          hidden_around += !ref->game.flagged[(y + i) * ref->width + x + j] && !ref->game.shown[(y + i) * ref->width + x + j];
+        }
+      if (engine->flags_around[index] != flags_around || engine->hidden_around[index] != hidden_around)
+      {
+        snprintf(why, why_size, "cell (%d, %d) has %u flags and %u hidden around, expected %u and %u", x, y,
+                 engine->flags_around[index], engine->hidden_around[index], flags_around, hidden_around);
+        return false;
+      }
+    }
+
+  uint32_t remaining_3bv = _ref_remaining_3bv(ref);
+  if (engine->state != ref->game.state || engine->revealed != revealed || engine->flags != flags ||
+      engine->correct_flags != correct_flags || engine->remaining_3bv != remaining_3bv)
+  {
+    snprintf(why, why_size, "state %d revealed %u flags %u correct %u 3BV %u, expected %d %u %u %u %u", engine->state,
+             engine->revealed, engine->flags, engine->correct_flags, engine->remaining_3bv, ref->game.state, revealed,
+             flags, correct_flags, remaining_3bv);
+    return false;
+  }
+  return true;
+}
+
+/* The bit plane engine against the engine, writes what's wrong to `why` */
+static bool _compare_bits(const BitEngine *bits, const Engine *engine, char *why, size_t why_size)
+{
+  for (uint16_t y = 0; y < engine->height; y++)
+    for (uint16_t x = 0; x < engine->width; x++)
+    {
+      const Minefield *field = &engine->board[y][x];
+      if (bitengine_is_shown(bits, x, y) != field->is_mined || bitengine_is_flagged(bits, x, y) != field->is_flagged)
+      {
+        snprintf(why, why_size, "bit engine: cell %u,%u is %s%s, engine has it %s%s", x, y, bitengine_is_shown(bits, x, y) ? "shown" : "covered",
+                 bitengine_is_flagged(bits, x, y) ? " and flagged" : "", field->is_mined ? "shown" : "covered", field->is_flagged ? " and flagged" : "");
+        return false;
+      }
+    }
+
+  if (bits->revealed != engine->revealed || bits->flags != engine->flags || bits->state != engine->state)
+  {
+    snprintf(why, why_size, "bit engine: revealed %u, flags %u, state %d, engine has %u, %u, %d", bits->revealed, bits->flags, bits->state,
+             engine->revealed, engine->flags, engine->state);
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Plays a case on both, returns the step it failed at (0 is generation, N the Nth action)
+ * or -1 if everything matched
+ */
+static int32_t _run(Workspace *space, const Case *test, char *why, size_t why_size)
+{
+  arena_reset(&space->arena);
+  arena_reset(&space->journal_arena);
+
+  Minefield **board = minefield_board_alloc(test->width, test->height, &space->arena);
+  if (board == NULL || !_check_generation(space, test, board, why, why_size))
+    return 0;
+
+  Engine engine;
+  if (!engine_init(&engine, board, test->width, test->height, test->bombs, &space->arena, &space->journal_arena))
+  {
+    snprintf(why, why_size, "engine_init failed");
+    return 0;
+  }
+
+  BitEngine bits;
+  if (!bitengine_init(&bits, board, test->width, test->height, test->bombs))
+  {
+    snprintf(why, why_size, "bitengine_init failed");
+    return 0;
+  }
+  for (uint16_t y = 0; y < test->height; y++)
+    for (uint16_t x = 0; x < test->width; x++)
+      if (!board[y][x].has_bomb && bitengine_amount(&bits, x, y) != board[y][x].bomb_amount)
+      {
+        snprintf(why, why_size, "bit engine: %u bombs around %u,%u, the board has %u", bitengine_amount(&bits, x, y), x, y, board[y][x].bomb_amount);
+        bitengine_free(&bits);
+        return 0;
+      }
+
+  Reference *ref = &space->ref;
+  memset(&ref->game, 0, sizeof(RefGame));
+  ref->game.state = ENGINE_PLAYING;
+  ref->width = test->width;
+  ref->height = test->height;
+  ref->undo_count = ref->redo_count = 0;
+  for (int32_t y = 0; y < test->height; y++)
+    for (int32_t x = 0; x < test->width; x++)
+    {
+      ref->bomb[y * test->width + x] = board[y][x].has_bomb;
+      ref->count[y * test->width + x] = board[y][x].bomb_amount;
+    }
+
+  int32_t failed = -1;
+  for (uint32_t i = 0; i < test->action_count && failed < 0; i++)
+  {
+    const Action *action = &test->actions[i];
+    switch (action->kind)
+    {
+    case ACTION_CLICK:
+      engine_click(&engine, action->x, action->y);
+      bitengine_click(&bits, action->x, action->y);
+      break;
+    case ACTION_FLAG:
+      engine_flag(&engine, action->x, action->y);
+      bitengine_flag(&bits, action->x, action->y);
+      break;
+    case ACTION_SWEEP_ALL:
+      engine_sweep_all(&engine);
+      bitengine_sweep_all(&bits);
+      break;
+    case ACTION_UNDO:
+      engine_undo(&engine);
+      bitengine_load(&bits, board, engine.state);
+      break;
+    default:
+      engine_redo(&engine);
+      bitengine_load(&bits, board, engine.state);
+      break;
+    }
+    engine_clear_changes(&engine);
+
+    _ref_apply(ref, action);
+    if (!_compare(ref, &engine, why, why_size) || !_compare_bits(&bits, &engine, why, why_size))
+      failed = i + 1;
+  }
+
+  bitengine_free(&bits);
+  return failed;
+}
+
+/*
+ * A random case, actions peek at the board now and then so games last longer than
+ * the first random click on a bomb
+ */
+static void _make_case(Workspace *space, uint64_t seed, Case *test)
+{
+  Rng rng;
+  rng_seed(&rng, seed);
+
+  /* Nearly every game is on a template size, they get a share of the cases */
+  static const uint16_t template_sizes[][2] = {{10, 10}, {16, 16}, {30, 16}, {36, 20}, {36, 30}};
+  if (rng_below(&rng, 8) == 0)
+  {
+    const uint32_t size = rng_below(&rng, sizeof(template_sizes) / sizeof(template_sizes[0]));
+    test->width = template_sizes[size][0];
+    test->height = template_sizes[size][1];
+  }
+  else
+  {
+    test->width = 2 + rng_below(&rng, RANDOM_WIDTH - 1);
+    test->height = 1 + rng_below(&rng, RANDOM_HEIGHT);
+  }
+  const uint32_t total = (uint32_t)test->width * test->height;
+  /* Mostly playable densities, sometimes anything */
+  test->bombs = 1 + rng_below(&rng, (rng_below(&rng, 4) == 0) ? total - 1 : total / 4 + 1);
+  test->seed = rng_next(&rng);
+  test->action_count = 1 + rng_below(&rng, MAX_ACTIONS);
+
+  arena_reset(&space->arena);
+  Minefield **board = minefield_board_alloc(test->width, test->height, &space->arena);
+  if (board != NULL)
+    generator_fill(board, test->width, test->height, test->bombs, test->seed, &space->arena);
+
+  for (uint32_t i = 0; i < test->action_count; i++)
+  {
+    Action *action = &test->actions[i];
+    uint32_t roll = rng_below(&rng, 100);
+    action->kind = (roll < 50) ? ACTION_CLICK : (roll < 75) ? ACTION_FLAG : (roll < 83) ? ACTION_SWEEP_ALL : (roll < 94) ? ACTION_UNDO : ACTION_REDO;
+
+    /* Clicks aim for safe cells and flags for bombs most of the time */
+    uint32_t index = rng_below(&rng, total);
+    bool want_bomb = action->kind == ACTION_FLAG;
+    for (uint32_t tries = 0; board != NULL && tries < 8 && rng_below(&rng, 10) < 8; tries++)
+    {
+      if (board[index / test->width][index % test->width].has_bomb == want_bomb)
+        break;
+      index = rng_below(&rng, total);
+    }
+    action->x = index % test->width;
+    action->y = index / test->width;
+  }
+}
+
+/* Drops every action it can while the case keeps failing */
+static void _shrink(Workspace *space, Case *test)
+{
+  char why[256];
+  Case candidate;
+
+  int32_t step = _run(space, test, why, sizeof(why));
+  if (step > 0)
+    test->action_count = step;
+
+  for (uint32_t chunk = test->action_count / 2; chunk >= 1; chunk /= 2)
+  {
+    for (uint32_t start = 0; start + chunk <= test->action_count;)
+    {
+      candidate = *test;
+      memmove(&candidate.actions[start], &candidate.actions[start + chunk], sizeof(Action) * (test->action_count - start - chunk));
+      candidate.action_count -= chunk;
+
+      step = _run(space, &candidate, why, sizeof(why));
+      if (step >= 0)
+      {
+        *test = candidate;
+        if (step > 0)
+          test->action_count = step;
+      }
+      else
+        start += chunk;
+    }
+  }
+}
+
+static void _print_case(const Case *test, FILE *file)
+{
+  fprintf(file, "%u %u %u %llu", test->width, test->height, test->bombs, (unsigned long long)test->seed);
+  for (uint32_t i = 0; i < test->action_count; i++)
+  {
+    const Action *action = &test->actions[i];
+    if (action->kind == ACTION_CLICK || action->kind == ACTION_FLAG)
+      fprintf(file, " %c%u,%u", (action->kind == ACTION_CLICK) ? 'c' : 'f', action->x, action->y);
+    else
+      fprintf(file, " %c", (action->kind == ACTION_SWEEP_ALL) ? 's' : (action->kind == ACTION_UNDO) ? 'u' : 'r');
+  }
+}
+
+static bool _parse_case(const char *text, Case *test)
+{
+  unsigned width, height, bombs;
+  unsigned long long seed;
+  int used;
+
+  if (sscanf(text, "%u %u %u %llu%n", &width, &height, &bombs, &seed, &used) != 4 || width < 1 || width > MAX_WIDTH ||
+      height < 1 || height > MAX_HEIGHT || bombs < 1 || bombs >= width * height)
+    return false;
+
+  test->width = width;
+  test->height = height;
+  test->bombs = bombs;
+  test->seed = seed;
+  test->action_count = 0;
+
+  text += used;
+  char token[32];
+  while (test->action_count < MAX_ACTIONS && sscanf(text, "%31s%n", token, &used) == 1)
+  {
+    text += used;
+    Action *action = &test->actions[test->action_count++];
+    unsigned x = 0, y = 0;
+
+    switch (token[0])
+    {
+    case 'c':
+    case 'f':
+      if (sscanf(token + 1, "%u,%u", &x, &y) != 2 || x >= width || y >= height)
+        return false;
+      action->kind = (token[0] == 'c') ? ACTION_CLICK : ACTION_FLAG;
+      break;
+    case 's':
+      action->kind = ACTION_SWEEP_ALL;
+      break;
+    case 'u':
+      action->kind = ACTION_UNDO;
+      break;
+    case 'r':
+      action->kind = ACTION_REDO;
+      break;
+    default:
+      return false;
+    }
+    action->x = x;
+    action->y = y;
+  }
+  return true;
+}
+
+/*
+WORKERS
+*/
+
+typedef struct
+{
+  uint64_t sequences;
+  atomic_uint_fast64_t next;
+  atomic_uint_fast64_t steps;
+  atomic_bool failed;
+  /* The first failure, written by whoever set `failed` */
+  Case failure;
+} Run;
+
+typedef struct
+{
+  Run *run;
+  Workspace *space;
+} Worker;
+
+static void _worker(void *arg)
+{
+  Worker *worker = arg;
+  Run *run = worker->run;
+  Case test;
+  char why[256];
+  uint64_t steps = 0;
+
+  while (!atomic_load(&run->failed))
+  {
+    uint64_t sequence = atomic_fetch_add(&run->next, 1);
+    if (sequence >= run->sequences)
+      break;
+
+    _make_case(worker->space, sequence, &test);
+    steps += test.action_count;
+
+    bool expected = false;
+    if (_run(worker->space, &test, why, sizeof(why)) >= 0 && atomic_compare_exchange_strong(&run->failed, &expected, true))
+      run->failure = test;
+  }
+
+  atomic_fetch_add(&run->steps, steps);
+}
+
+static Workspace *_workspace_new()
+{
+  Workspace *space = malloc(sizeof(Workspace));
+  if (space != NULL)
+  {
+    arena_init(&space->arena, 0);
+    arena_init(&space->journal_arena, 0);
+  }
+  return space;
+}
+
+static void _workspace_free(Workspace *space)
+{
+  arena_free(&space->arena);
+  arena_free(&space->journal_arena);
+  free(space);
+}
+
+/* Shrinks and prints a failing case, returns the exit code */
+static int _report(Workspace *space, Case *test)
+{
+  char why[256];
+
+  _shrink(space, test);
+  int32_t step = _run(space, test, why, sizeof(why));
+
+  printf("FAILED at step %d: %s\nReplay with: engine_test --replay \"", step, why);
+  _print_case(test, stdout);
+  printf("\"\n");
+  return 1;
+}
+
+/*
+SHARED BOARD
+*/
+
+/* Every bot plays this many actions, unless the game ends first */
+#define COOP_ACTIONS 20000
+#define COOP_POLL_EVERY 64
+
+typedef struct
+{
+  CoopBoard *coop;
+  int32_t player;
+  uint64_t seed;
+  /* The board as the player's feed told it */
+  uint8_t *view;
+  uint64_t actions;
+  Arena scratch;
+} CoopBot;
+
+static void _coop_poll(CoopBot *bot)
+{
+  uint32_t cells[256], count;
+  while ((count = coop_poll(bot->coop, bot->player, cells, 256)) > 0)
+    for (uint32_t i = 0; i < count; i++)
+      bot->view[cells[i]] = atomic_load(&bot->coop->cells[cells[i]]);
+}
+
+/* Clicks safe cells and flags bombs at random (so no sweep ever blows up), polling its feed as it goes */
+static void _coop_bot(void *arg)
+{
+  CoopBot *bot = arg;
+  CoopBoard *coop = bot->coop;
+  Rng rng;
+  rng_seed(&rng, bot->seed);
+
+  for (uint32_t i = 0; i < COOP_ACTIONS && coop_state(coop) == ENGINE_PLAYING; i++)
+  {
+    const uint32_t index = rng_below(&rng, (uint32_t)coop->width * coop->height);
+    const uint16_t x = index % coop->width, y = index / coop->width;
+
+    if (rng_below(&rng, COOP_ACTIONS) == 0)
+      coop_sweep_all(coop, &bot->scratch);
+    else if (atomic_load(&coop->cells[index]) & COOP_BOMB)
+      coop_flag(coop, x, y);
+    else
+      coop_click(coop, x, y, &bot->scratch);
+    bot->actions++;
+
+    if (i % COOP_POLL_EVERY == 0)
+      _coop_poll(bot);
+  }
+}
+
+/* Once every bot is done: counters, floods, state and every player's view against the board */
+static bool _coop_check(CoopBoard *coop, CoopBot *bots, uint32_t bot_count, char *why, size_t why_size)
+{
+  const int32_t w = coop->width, h = coop->height;
+  uint32_t revealed = 0, flags = 0, correct_flags = 0;
+
+  for (int32_t y = 0; y < h; y++)
+    for (int32_t x = 0; x < w; x++)
+    {
+      const uint8_t cell = atomic_load(&coop->cells[y * w + x]);
+      revealed += (cell & COOP_SHOWN) && !(cell & COOP_BOMB);
+      flags += (cell & COOP_FLAG) != 0;
+      correct_flags += (cell & COOP_FLAG) && (cell & COOP_BOMB);
+      if (!(cell & COOP_SHOWN) || (cell & (COOP_AMOUNT_MASK | COOP_BOMB)))
+        continue;
+
+      /* A shown 0 always has everything around it shown, whoever flooded which part */
+      for (int32_t i = -1; i <= 1; i++)
+        for (int32_t j = -1; j <= 1; j++)
+          if (y + i >= 0 && y + i < h && x + j >= 0 && x + j < w && !(atomic_load(&coop->cells[(y + i) * w + x + j]) & COOP_SHOWN))
+          {
+            snprintf(why, why_size, "(%d, %d) is covered next to a shown 0", x + j, y + i);
+            return false;
+          }
+    }
+
+  const uint32_t safe = (uint32_t)w * h - coop->bomb_amount;
+  if (revealed != atomic_load(&coop->revealed) || flags != atomic_load(&coop->flags) || correct_flags != atomic_load(&coop->correct_flags))
+  {
+    snprintf(why, why_size, "revealed %u flags %u correct %u, counted %u %u %u", atomic_load(&coop->revealed),
+             atomic_load(&coop->flags), atomic_load(&coop->correct_flags), revealed, flags, correct_flags);
+    return false;
+  }
+  if (coop_state(coop) != ((revealed == safe) ? ENGINE_WON : ENGINE_PLAYING) || (coop_state(coop) == ENGINE_WON && correct_flags != coop->bomb_amount))
+  {
+    snprintf(why, why_size, "state %d with %u of %u safe cells shown and %u bombs flagged", coop_state(coop), revealed, safe, correct_flags);
+    return false;
+  }
+
+  for (uint32_t i = 0; i < bot_count; i++)
+  {
+    _coop_poll(&bots[i]);
+    for (uint32_t index = 0; index < (uint32_t)w * h; index++)
+      if (bots[i].view[index] != atomic_load(&coop->cells[index]))
+      {
+        snprintf(why, why_size, "player %u's feed missed the change of (%u, %u)", i, index % w, index / w);
+        return false;
+      }
+  }
+  return true;
+}
+
+/* Dozens of bots playing the same board at once, one thread each, returns false if it didn't add up */
+static bool _coop_round(uint16_t width, uint16_t height, uint16_t bombs, uint32_t bot_count, uint64_t seed)
+{
+  Arena arena;
+  arena_init(&arena, 0);
+  CoopBoard *coop = malloc(sizeof(CoopBoard));
+  CoopBot *bots = calloc(bot_count, sizeof(CoopBot));
+  Thread *threads = malloc(sizeof(Thread) * bot_count);
+  Minefield **board = minefield_board_alloc(width, height, &arena);
+  char why[256] = "out of memory";
+  bool ok = false;
+
+  if (coop == NULL || bots == NULL || threads == NULL || board == NULL)
+    goto done;
+  generator_fill(board, width, height, bombs, seed, &arena);
+  if (!coop_init(coop, board, width, height, bombs, &arena))
+    goto done;
+
+  for (uint32_t i = 0; i < bot_count; i++)
+  {
+    bots[i].coop = coop;
+    bots[i].player = coop_join(coop);
+    bots[i].seed = seed + i + 1;
+    bots[i].view = arena_calloc(&arena, (uint32_t)width * height, 1);
+    arena_init(&bots[i].scratch, 0);
+    if (bots[i].player < 0 || bots[i].view == NULL)
+      goto done;
+  }
+
+  const uint64_t started_at = timer_now_ms();
+  uint32_t started = 0;
+  while (started < bot_count && thread_start(&threads[started], _coop_bot, &bots[started]))
+    started++;
+  /* Whoever couldn't get a thread plays afterwards */
+  for (uint32_t i = started; i < bot_count; i++)
+    _coop_bot(&bots[i]);
+  for (uint32_t i = 0; i < started; i++)
+    thread_join(&threads[i]);
+  const uint64_t took = timer_now_ms() - started_at;
+
+  uint64_t actions = 0;
+  for (uint32_t i = 0; i < bot_count; i++)
+    actions += bots[i].actions;
+
+  ok = _coop_check(coop, bots, bot_count, why, sizeof(why));
+  printf("Shared %ux%u board, %u players: %llu actions in %.1fs, %s (%s)\n", width, height, bot_count,
+         (unsigned long long)actions, took / 1000.0, ok ? "passed" : "FAILED",
+         ok ? ((coop_state(coop) == ENGINE_WON) ? "won" : "still playing") : why);
+
+done:
+  if (!ok && strcmp(why, "out of memory") == 0)
+    printf("Shared %ux%u board: out of memory\n", width, height);
+  for (uint32_t i = 0; bots != NULL && i < bot_count; i++)
+    arena_free(&bots[i].scratch);
+  free(threads);
+  free(bots);
+  free(coop);
+  arena_free(&arena);
+  return ok;
+}
+
+/*
+SOLVER
+*/
+
+/*
+ * Games played with solver_next_move from the blessing on: a deduced move (anything but a guess)
+ * that flags a safe cell or loses the game is a failure. Moves out of the pattern table count as matrix ones.
+ */
+static bool _solver_round(uint16_t width, uint16_t height, uint16_t bombs, uint32_t games, uint64_t seed)
+{
+  Arena arena, journal_arena, scratch;
+  arena_init(&arena, 0);
+  arena_init(&journal_arena, 0);
+  arena_init(&scratch, 0);
+  uint64_t moves[SOLVER_TIER_GUESS + 1] = {0}, matrix_us = 0;
+  uint32_t won = 0;
+  char why[128] = "";
+  Rng rng;
+  rng_seed(&rng, seed);
+
+  for (uint32_t game = 0; game < games && why[0] == '\0'; game++)
+  {
+    arena_reset(&arena);
+    arena_reset(&journal_arena);
+    Minefield **board = minefield_board_alloc(width, height, &arena);
+    Engine engine;
+    if (board == NULL)
+      return false;
+    const Vec2 blessing = generator_fill(board, width, height, bombs, rng_next(&rng), &arena);
+    if (!engine_init(&engine, board, width, height, bombs, &arena, &journal_arena))
+      return false;
+    engine_click(&engine, blessing.x, blessing.y);
+
+    SolverMove move;
+    while (engine.state == ENGINE_PLAYING && why[0] == '\0')
+    {
+      const uint64_t started_at = timer_now_us();
+      if (!solver_next_move(board, width, height, &move, &scratch))
+        break;
+      if (move.tier == SOLVER_TIER_MATRIX)
+        matrix_us += timer_now_us() - started_at;
+      moves[move.tier]++;
+
+      if (move.flag)
+        engine_flag(&engine, move.cell.x, move.cell.y);
+      else
+        engine_click(&engine, move.cell.x, move.cell.y);
+      engine_clear_changes(&engine);
+
+      if (move.tier != SOLVER_TIER_GUESS && ((move.flag && !board[move.cell.y][move.cell.x].has_bomb) || engine.state == ENGINE_LOST))
+        snprintf(why, sizeof(why), "tier %d move on %d,%d was wrong (game %u)", move.tier, move.cell.x, move.cell.y, game);
+    }
+    won += engine.state == ENGINE_WON;
+  }
+
+  printf("Solver on %ux%u boards, %u games (%u won): %llu single, %llu subset, %llu matrix (%.1fus a move, earlier tiers included), %llu guesses, %s%s%s\n",
+         width, height, games, won, (unsigned long long)moves[SOLVER_TIER_SINGLE], (unsigned long long)moves[SOLVER_TIER_SUBSET],
+         (unsigned long long)moves[SOLVER_TIER_MATRIX], moves[SOLVER_TIER_MATRIX] ? matrix_us / (double)moves[SOLVER_TIER_MATRIX] : 0.0,
+         (unsigned long long)moves[SOLVER_TIER_GUESS], why[0] ? "FAILED (" : "passed", why, why[0] ? ")" : "");
+  arena_free(&scratch);
+  arena_free(&journal_arena);
+  arena_free(&arena);
+  return why[0] == '\0';
+}
+
+/*
+BIT ENGINE
+*/
+
+/*
+ * The bit plane kernels against the Minefield ones: openings, 3BV and islands against metrics_compute_3bv,
+ * shown safe cells and wrong flags (some random ones on every board) against plain loops. Both sides are timed.
+ */
+static bool _planes_round(uint16_t width, uint16_t height, uint16_t bombs, uint32_t boards, uint64_t seed)
+{
+  Arena arena, scratch;
+  arena_init(&arena, 0);
+  arena_init(&scratch, 0);
+  BoardPlanes planes;
+  uint64_t took[2] = {0, 0};
+  char why[160] = "";
+  Rng rng;
+  rng_seed(&rng, seed);
+  if (!board_planes_init(&planes, width, height))
+    return false;
+
+  for (uint32_t b = 0; b < boards && why[0] == '\0'; b++)
+  {
+    arena_reset(&arena);
+    Minefield **board = minefield_board_alloc(width, height, &arena);
+    if (board == NULL)
+      return false;
+    generator_fill(board, width, height, bombs, rng_next(&rng), &arena);
+
+    uint32_t safe = 0, mismatch = 0;
+    for (uint16_t i = 0; i < height; i++)
+      for (uint16_t j = 0; j < width; j++)
+      {
+        board[i][j].is_mined = rng_below(&rng, 4) == 0;
+        board[i][j].is_flagged = !board[i][j].is_mined && rng_below(&rng, 8) == 0;
+        safe += board[i][j].is_mined && !board[i][j].has_bomb;
+        mismatch += board[i][j].is_flagged != board[i][j].has_bomb;
+      }
+
+    BoardMetrics metrics;
+    uint64_t started_at = timer_now_us();
+    const bool counted = metrics_compute_3bv(&metrics, board, width, height, &scratch);
+    took[0] += timer_now_us() - started_at;
+
+    uint32_t openings, lonely, islands;
+    started_at = timer_now_us();
+    board_planes_load(&planes, board);
+    const bool planes_counted = board_planes_3bv(&planes, &scratch, &openings, &lonely, &islands);
+    took[1] += timer_now_us() - started_at;
+
+    uint32_t only_openings;
+    if (!counted || !planes_counted || !board_planes_openings(&planes, &scratch, &only_openings))
+      snprintf(why, sizeof(why), "out of memory");
+    else if (openings != metrics.openings || only_openings != metrics.openings || openings + lonely != metrics.three_bv ||
+             islands != metrics.islands)
+      snprintf(why, sizeof(why), "board %u: %u/%u openings, %u 3BV, %u islands instead of %u, %u, %u", b, openings, only_openings,
+               openings + lonely, islands, metrics.openings, metrics.three_bv, metrics.islands);
+    else if (board_planes_revealed_safe(&planes) != safe || board_planes_flag_mismatch(&planes) != mismatch)
+      snprintf(why, sizeof(why), "board %u: %u shown safe and %u wrong flags instead of %u and %u", b,
+               board_planes_revealed_safe(&planes), board_planes_flag_mismatch(&planes), safe, mismatch);
+  }
+
+  printf("Bit planes (%s) on %ux%u boards with %u bombs, %u boards: 3BV in %.1fus on the planes (loading them included), %.1fus on the board, %s%s%s\n",
+         bitplane_simd_name(), width, height, bombs, boards, took[1] / (double)boards, took[0] / (double)boards,
+         why[0] ? "FAILED (" : "passed", why, why[0] ? ")" : "");
+  board_planes_free(&planes);
+  arena_free(&scratch);
+  arena_free(&arena);
+  return why[0] == '\0';
+}
+
+/*
+ * Self-play speed: every safe cell of each board clicked in a random order (the ones shown already
+ * skipped) on the engine and on the bit engine, only the moves are timed
+ */
+static bool _bits_round(uint16_t width, uint16_t height, uint16_t bombs, uint32_t games, uint64_t seed)
+{
+  Arena arena, journal_arena;
+  arena_init(&arena, 0);
+  arena_init(&journal_arena, 0);
+  const uint32_t total = (uint32_t)width * height;
+  uint64_t moves[2] = {0, 0}, took[2] = {0, 0};
+  bool ok = true;
+  Rng rng;
+  rng_seed(&rng, seed);
+
+  for (uint32_t game = 0; game < games && ok; game++)
+  {
+    arena_reset(&arena);
+    arena_reset(&journal_arena);
+    Minefield **board = minefield_board_alloc(width, height, &arena);
+    uint32_t *order = arena_alloc(&arena, sizeof(uint32_t) * total);
+    Engine engine;
+    BitEngine bits;
+    if (board == NULL || order == NULL)
+      return false;
+    generator_fill(board, width, height, bombs, rng_next(&rng), &arena);
+    if (!bitengine_init(&bits, board, width, height, bombs))
+      return false;
+    if (!engine_init(&engine, board, width, height, bombs, &arena, &journal_arena))
+    {
+      bitengine_free(&bits);
+      return false;
+    }
+
+    uint32_t safe = 0;
+    for (uint32_t i = 0; i < total; i++)
+      if (!board[i / width][i % width].has_bomb)
+      {
+        uint32_t j = rng_below(&rng, safe + 1);
+        order[safe++] = order[j];
+        order[j] = i;
+      }
+
+    uint64_t started_at = timer_now_us();
+    for (uint32_t i = 0; i < safe; i++)
+      if (!board[order[i] / width][order[i] % width].is_mined)
+      {
+        engine_click(&engine, order[i] % width, order[i] / width);
+        engine_clear_changes(&engine);
+        moves[0]++;
+      }
+    took[0] += timer_now_us() - started_at;
+
+    started_at = timer_now_us();
+    for (uint32_t i = 0; i < safe; i++)
+      if (!bitengine_is_shown(&bits, order[i] % width, order[i] / width))
+      {
+        bitengine_click(&bits, order[i] % width, order[i] / width);
+        moves[1]++;
+      }
+    took[1] += timer_now_us() - started_at;
+
+    ok = engine.state == ENGINE_WON && bits.state == ENGINE_WON && moves[0] == moves[1];
+    bitengine_free(&bits);
+  }
+
+  printf("Self-play on %ux%u boards, %u games: %.1fM moves/s on the engine, %.1fM on the bit engine, %s\n", width, height, games,
+         took[0] ? moves[0] / (double)took[0] : 0.0, took[1] ? moves[1] / (double)took[1] : 0.0, ok ? "passed" : "FAILED (games differ)");
+  arena_free(&journal_arena);
+  arena_free(&arena);
+  return ok;
+}
+
+/*
+FLOOD
+*/
+
+/* Same cells, counts and counters on both engines */
+static bool _flood_compare(const Engine *serial, const Engine *parallel, char *why, size_t why_size)
+{
+  for (uint16_t y = 0; y < serial->height; y++)
+    for (uint16_t x = 0; x < serial->width; x++)
+    {
+      const uint32_t index = (uint32_t)y * serial->width + x;
+      if (serial->board[y][x].is_mined != parallel->board[y][x].is_mined ||
+          serial->board[y][x].is_flagged != parallel->board[y][x].is_flagged)
+      {
+        snprintf(why, why_size, "cell %u,%u differs", x, y);
+        return false;
+      }
+      if (serial->flags_around[index] != parallel->flags_around[index] || serial->hidden_around[index] != parallel->hidden_around[index])
+      {
+        snprintf(why, why_size, "counts around %u,%u differ", x, y);
+        return false;
+      }
+    }
+
+  if (serial->revealed != parallel->revealed || serial->flags != parallel->flags || serial->correct_flags != parallel->correct_flags ||
+      serial->remaining_3bv != parallel->remaining_3bv || serial->state != parallel->state)
+  {
+    snprintf(why, why_size, "counters differ (revealed %u/%u, 3BV left %u/%u)", serial->revealed, parallel->revealed,
+             serial->remaining_3bv, parallel->remaining_3bv);
+    return false;
+  }
+  if (!engine_verify(parallel))
+  {
+    snprintf(why, why_size, "parallel engine doesn't verify");
+    return false;
+  }
+  return true;
+}
+
+/*
+ * The same game on a huge board flooded on one thread and on `threads` of them: wrong flags in the
+ * way of the flood, the biggest opening clicked, undone and redone, then a few more clicks and sweeps
+ */
+static bool _flood_round(uint16_t width, uint16_t height, uint16_t bombs, uint32_t threads, uint64_t seed)
+{
+  Arena arena, journal_arena;
+  arena_init(&arena, 0);
+  arena_init(&journal_arena, 0);
+  Engine *engines = calloc(2, sizeof(Engine));
+  Minefield **boards[2] = {minefield_board_alloc(width, height, &arena), minefield_board_alloc(width, height, &arena)};
+  char why[256] = "out of memory";
+  bool ok = false;
+  uint64_t took[2] = {0, 0};
+
+  if (engines == NULL || boards[0] == NULL || boards[1] == NULL)
+    goto done;
+  generator_fill(boards[0], width, height, bombs, seed, &arena);
+  minefield_board_copy(boards[1], boards[0], width, height);
+  if (!engine_init(&engines[0], boards[0], width, height, bombs, &arena, &journal_arena) ||
+      !engine_init(&engines[1], boards[1], width, height, bombs, &arena, &journal_arena) || engines[1].flood == NULL)
+    goto done;
+  engines[0].flood_threads = 1;
+  engines[1].flood_threads = threads;
+
+  /* The 0 with the biggest opening */
+  const uint32_t total = (uint32_t)width * height;
+  uint32_t *sizes = arena_calloc(&arena, total, sizeof(uint32_t));
+  if (sizes == NULL)
+    goto done;
+  uint32_t biggest = 0;
+  for (uint32_t i = 0; i < total; i++)
+    if (engines[0].labels[i] < total && ++sizes[engines[0].labels[i]] > sizes[biggest])
+      biggest = engines[0].labels[i];
+
+  Rng rng;
+  rng_seed(&rng, seed);
+  for (uint32_t i = 0; i < total / 64; i++)
+  {
+    const uint32_t index = rng_below(&rng, total);
+    for (uint32_t e = 0; e < 2; e++)
+      engine_flag(&engines[e], index % width, index / width);
+  }
+
+  ok = _flood_compare(&engines[0], &engines[1], why, sizeof(why));
+  for (uint32_t step = 0; ok && step < 40; step++)
+  {
+    const uint32_t index = (step == 0) ? biggest : rng_below(&rng, total);
+    for (uint32_t e = 0; e < 2; e++)
+    {
+      const uint64_t started_at = timer_now_us();
+      if (step == 1)
+        engine_undo(&engines[e]);
+      else if (step == 2)
+        engine_redo(&engines[e]);
+      else if (step % 8 == 7)
+        engine_sweep_all(&engines[e]);
+      else if (!boards[e][index / width][index % width].has_bomb)
+        engine_click(&engines[e], index % width, index / width);
+      engine_clear_changes(&engines[e]);
+      if (step == 0)
+        took[e] = timer_now_us() - started_at;
+    }
+    if (!_flood_compare(&engines[0], &engines[1], why, sizeof(why)))
+    {
+      snprintf(why + strlen(why), sizeof(why) - strlen(why), " after step %u", step);
+      ok = false;
+    }
+  }
+
+  printf("Flood on a %ux%u board, opening of %u cells: %.1fms on 1 thread, %.1fms on %u, %s%s%s\n", width, height, sizes[biggest],
+         took[0] / 1000.0, took[1] / 1000.0, threads, ok ? "passed" : "FAILED (", ok ? "" : why, ok ? "" : ")");
+
+done:
+  if (!ok && strcmp(why, "out of memory") == 0)
+    printf("Flood on a %ux%u board: out of memory\n", width, height);
+  free(engines);
+  arena_free(&journal_arena);
+  arena_free(&arena);
+  return ok;
+}
+
+/*
+SAMPLER
+*/
+
+/* Frontiers at most this big get every layout counted */
+#define SAMPLER_EXACT_CELLS 18
+/* How far off an estimate may be (the margins are on the optimistic side, see sampler.h) */
+#define SAMPLER_TOLERANCE 0.03
+
+/*
+ * Exact chances of every covered cell having a bomb (same order as `cells`), every layout of the
+ * covered cells next to a number weighted by the ways the other ones can hold the bombs left
+ * @return false if there's more than SAMPLER_EXACT_CELLS of them
+ */
+static bool _exact_chances(Minefield **board, uint16_t width, uint16_t height, uint16_t bombs, double *chances, uint32_t *cells,
+                           uint32_t *cell_count)
+{
+  const uint32_t total = (uint32_t)width * height;
+  uint32_t frontier[SAMPLER_EXACT_CELLS], frontier_count = 0, interior = 0;
+
+  *cell_count = 0;
+  for (uint32_t index = 0; index < total; index++)
+  {
+    const int32_t x = index % width, y = index / width;
+    if (board[y][x].is_mined)
+    {
+      bombs -= board[y][x].has_bomb;
+      continue;
+    }
+
+    bool numbered = false;
+    for (int32_t i = -1; i <= 1; i++)
+      for (int32_t j = -1; j <= 1; j++)
+        numbered |= y + i >= 0 && y + i < height && x + j >= 0 && x + j < width && board[y + i][x + j].is_mined &&
+                    !board[y + i][x + j].has_bomb;
+    if (numbered && frontier_count == SAMPLER_EXACT_CELLS)
+      return false;
+    if (numbered)
+      frontier[frontier_count++] = index;
+    else
+      interior++;
+    cells[(*cell_count)++] = index;
+  }
+
+  /* ways[k]: ways the interior holds k bombs */
+  double ways[SAMPLER_EXACT_CELLS + 1], weight_total = 0, interior_weight = 0, frontier_weight[SAMPLER_EXACT_CELLS] = {0};
+  for (uint32_t used = 0; used <= frontier_count; used++)
+  {
+    const int32_t left = (int32_t)bombs - used;
+    ways[used] = (left < 0 || left > (int32_t)interior) ? 0 : 1;
+    for (int32_t k = 0; k < left && ways[used] > 0; k++)
+      ways[used] = ways[used] * (interior - k) / (k + 1);
+  }
+
+  for (uint32_t layout = 0; layout < ((uint32_t)1 << frontier_count); layout++)
+  {
+    const uint32_t used = __builtin_popcount(layout);
+    if (ways[used] == 0)
+      continue;
+
+    /* Every shown number has to get its bombs */
+    bool fits = true;
+    for (uint32_t index = 0; index < total && fits; index++)
+    {
+      const int32_t x = index % width, y = index / width;
+      if (!board[y][x].is_mined || board[y][x].has_bomb)
+        continue;
+
+      int32_t around = 0;
+      for (int32_t i = -1; i <= 1; i++)
+        for (int32_t j = -1; j <= 1; j++)
+        {
+          if (y + i < 0 || y + i >= height || x + j < 0 || x + j >= width || (i == 0 && j == 0))
+            continue;
+          const Minefield *neighbour = &board[y + i][x + j];
+          if (neighbour->is_mined)
+            around += neighbour->has_bomb;
+          for (uint32_t f = 0; f < frontier_count && !neighbour->is_mined; f++)
+            around += frontier[f] == (uint32_t)((y + i) * width + x + j) && (layout >> f & 1);
+        }
+      fits = around == board[y][x].bomb_amount;
+    }
+    if (!fits)
+      continue;
+
+    weight_total += ways[used];
+    interior_weight += ways[used] * (bombs - used);
+    for (uint32_t f = 0; f < frontier_count; f++)
+      frontier_weight[f] += (layout >> f & 1) ? ways[used] : 0;
+  }
+
+  for (uint32_t c = 0; c < *cell_count; c++)
+  {
+    chances[c] = (interior > 0) ? interior_weight / weight_total / interior : 0;
+    for (uint32_t f = 0; f < frontier_count; f++)
+      if (frontier[f] == cells[c])
+        chances[c] = frontier_weight[f] / weight_total;
+  }
+  return weight_total > 0;
+}
+
+/*
+ * Boards opened from the blessing with a few more safe cells clicked until the frontier is small
+ * enough to count, the sampler's chances have to be within SAMPLER_TOLERANCE of the exact ones
+ */
+static bool _sampler_exact_round(uint16_t width, uint16_t height, uint16_t bombs, uint32_t boards, uint64_t seed)
+{
+  Arena arena, journal_arena;
+  arena_init(&arena, 0);
+  arena_init(&journal_arena, 0);
+  const uint32_t total = (uint32_t)width * height;
+  uint32_t checked = 0;
+  uint64_t samples = 0;
+  double worst = 0;
+  char why[128] = "";
+  Rng rng;
+  rng_seed(&rng, seed);
+
+  for (uint32_t game = 0; game < boards && why[0] == '\0'; game++)
+  {
+    arena_reset(&arena);
+    arena_reset(&journal_arena);
+    Minefield **board = minefield_board_alloc(width, height, &arena);
+    double *chances = arena_alloc(&arena, sizeof(double) * total);
+    uint32_t *cells = arena_alloc(&arena, sizeof(uint32_t) * total), cell_count;
+    Engine engine;
+    if (board == NULL || chances == NULL || cells == NULL)
+      return false;
+    const Vec2 blessing = generator_fill(board, width, height, bombs, rng_next(&rng), &arena);
+    if (!engine_init(&engine, board, width, height, bombs, &arena, &journal_arena))
+      return false;
+    engine_click(&engine, blessing.x, blessing.y);
+
+    /* Safe clicks until it's small enough (or won) */
+    bool counted = false;
+    for (uint32_t tries = 0; tries < 64 && engine.state == ENGINE_PLAYING; tries++)
+    {
+      if ((counted = _exact_chances(board, width, height, bombs, chances, cells, &cell_count)))
+        break;
+      const uint32_t index = rng_below(&rng, total);
+      if (!board[index / width][index % width].has_bomb)
+        engine_click(&engine, index % width, index / width);
+    }
+    if (!counted || engine.state != ENGINE_PLAYING)
+      continue;
+
+    Sampler sampler;
+    if (!sampler_start(&sampler, board, width, height, bombs, thread_cpu_count(), rng_next(&rng)))
+      return false;
+    while (!sampler_done(&sampler))
+      thread_yield();
+
+    for (uint32_t c = 0; c < cell_count && why[0] == '\0'; c++)
+    {
+      double chance, margin;
+      const uint16_t x = cells[c] % width, y = cells[c] / width;
+      if (!sampler_estimate(&sampler, x, y, &chance, &margin))
+        snprintf(why, sizeof(why), "no estimate for %u,%u (board %u)", x, y, game);
+      else if (chance - chances[c] > SAMPLER_TOLERANCE || chances[c] - chance > SAMPLER_TOLERANCE)
+        snprintf(why, sizeof(why), "%u,%u is %.3f, not %.3f (board %u)", x, y, chance, chances[c], game);
+      else if (chance - chances[c] > worst || chances[c] - chance > worst)
+        worst = (chance > chances[c]) ? chance - chances[c] : chances[c] - chance;
+    }
+    samples += sampler_samples(&sampler);
+    sampler_stop(&sampler);
+    checked++;
+  }
+
+  printf("Sampler on %ux%u boards, %u counted exactly: %llu layouts a board, off by %.3f at most, %s%s%s\n", width, height, checked,
+         checked ? (unsigned long long)(samples / checked) : 0ull, worst, why[0] ? "FAILED (" : "passed", why, why[0] ? ")" : "");
+  arena_free(&journal_arena);
+  arena_free(&arena);
+  return why[0] == '\0' && checked > 0;
+}
+
+/* A big board with a few hundred safe clicks on it, timed until the sampler is done or `seconds` is up */
+static bool _sampler_speed_round(uint16_t width, uint16_t height, uint16_t bombs, uint32_t seconds, uint64_t seed)
+{
+  Arena arena, journal_arena;
+  arena_init(&arena, 0);
+  arena_init(&journal_arena, 0);
+  Minefield **board = minefield_board_alloc(width, height, &arena);
+  Engine engine;
+  Sampler sampler;
+  bool ok = false;
+  Rng rng;
+  rng_seed(&rng, seed);
+
+  if (board == NULL)
+    goto done;
+  const Vec2 blessing = generator_fill(board, width, height, bombs, seed, &arena);
+  if (!engine_init(&engine, board, width, height, bombs, &arena, &journal_arena))
+    goto done;
+  engine_click(&engine, blessing.x, blessing.y);
+  for (uint32_t i = 0; i < 400; i++)
+  {
+    const uint32_t index = rng_below(&rng, (uint32_t)width * height);
+    if (!board[index / width][index % width].has_bomb)
+      engine_click(&engine, index % width, index / width);
+  }
+
+  const uint64_t started_at = timer_now_ms();
+  if (!sampler_start(&sampler, board, width, height, bombs, thread_cpu_count(), seed))
+    goto done;
+  while (!sampler_done(&sampler) && timer_now_ms() - started_at < seconds * 1000ull)
+    thread_yield();
+  const uint64_t took = timer_now_ms() - started_at;
+  const bool converged = sampler_done(&sampler);
+  const uint64_t samples = sampler_samples(&sampler);
+  const uint32_t frontier = sampler.frontier_count, threads = sampler.thread_count;
+  sampler_stop(&sampler);
+
+  /* Nothing to check on a board this big, only that it gets somewhere */
+  ok = samples > 0;
+  printf("Sampler on a %ux%u board, frontier of %u cells: %llu layouts in %.1fs on %u threads (%s), %s\n", width, height, frontier,
+         (unsigned long long)samples, took / 1000.0, threads, converged ? "converged" : "still going", ok ? "passed" : "FAILED");
+
+done:
+  arena_free(&journal_arena);
+  arena_free(&arena);
+  return ok;
+}
+
+/*
+SERVER
+*/
+
+#ifdef __linux__
+
+/* Sessions opened at once, and how long anything may take before the round gives up */
+#define SERVER_TEST_SESSIONS 48
+#define SERVER_TEST_TIMEOUT_MS 30000
+/* Keys the first session sends while the others connect, and how long any of them may wait */
+#define SERVER_TEST_KEYS 10
+#define SERVER_TEST_MAX_LATENCY_MS 50
+/* Arrow keys sent at once, more than fit in the server's input buffer */
+#define SERVER_TEST_ARROWS 40
+
+/* Connects to the server, retrying while it's still starting up, -1 if it never came up */
+static int _client_connect(const char *path)
+{
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+
+  const uint64_t started_at = timer_now_ms();
+  while (timer_now_ms() - started_at < SERVER_TEST_TIMEOUT_MS)
+  {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+      return fd;
+    if (fd >= 0)
+      close(fd);
+    csleep(0.01);
+  }
+  return -1;
+}
+
+/* Reads until `text` shows up (anything at all if it's empty), returns false if it didn't in time */
+static bool _client_expect(int fd, const char *text, uint32_t timeout_ms)
+{
+  /* The end of what came before is kept, in case `text` is split between reads */
+  char window[4096 + 64] = "";
+  size_t kept = 0;
+  const size_t tail = strlen(text);
+  const uint64_t started_at = timer_now_ms();
+
+  while (timer_now_ms() - started_at < timeout_ms)
+  {
+    struct pollfd wait = {.fd = fd, .events = POLLIN};
+    if (poll(&wait, 1, 10) <= 0)
+      continue;
+
+    ssize_t length = read(fd, window + kept, 4096);
+    if (length <= 0)
+      return false;
+    window[kept + length] = '\0';
+    if (strstr(window, text) != NULL)
+      return true;
+
+    kept = (kept + length < tail) ? kept + length : tail;
+    memmove(window, window + strlen(window) - kept, kept);
+  }
+  return false;
+}
+
+/* Whatever the session has sent and not been read yet */
+static void _client_drain(int fd)
+{
+  char chunk[4096];
+  struct pollfd wait = {.fd = fd, .events = POLLIN};
+  while (poll(&wait, 1, 0) > 0 && read(fd, chunk, sizeof(chunk)) > 0)
+    ;
+}
+
+/* Reads everything for a while, returns false if the server closed the session meanwhile */
+static bool _client_alive(int fd, uint32_t ms)
+{
+  char chunk[4096];
+  const uint64_t started_at = timer_now_ms();
+  while (timer_now_ms() - started_at < ms)
+  {
+    struct pollfd wait = {.fd = fd, .events = POLLIN};
+    if (poll(&wait, 1, 10) > 0 && read(fd, chunk, sizeof(chunk)) <= 0)
+      return false;
+  }
+  return true;
+}
+
+/* Starts a server on `templ` in a child process, it listens on `path` */
+static pid_t _server_fork(const char *path, const Template *templ, bool coop)
+{
+  fflush(stdout);
+  pid_t server = fork();
+  if (server == 0)
+  {
+    /* The server says where it's listening, that isn't part of the test */
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0)
+      dup2(null_fd, STDOUT_FILENO);
+    char address[80];
+    snprintf(address, sizeof(address), "unix:%s", path);
+    _exit(server_run(address, templ, NULL, coop));
+  }
+  return server;
+}
+
+static void _server_kill(pid_t server, const char *path)
+{
+  kill(server, SIGKILL);
+  waitpid(server, NULL, 0);
+  unlink(path);
+}
+
+/*
+ * A forked server on the Hard template (boards it has to search for), one session to play on first,
+ * then a burst of them: every one has to get its board and answer keys, and the first one's keys have
+ * to keep coming back quickly while the rest are waiting for theirs
+ */
+static bool _server_round(uint64_t seed)
+{
+  Template templ;
+  template_init(&templ, "Hard", 30, 16, 99);
+  template_difficulty(&templ, 0, 0, SOLVER_TIER_SUBSET);
+
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/csweeper_test_%d_%llu.sock", (int)getpid(), (unsigned long long)seed);
+  pid_t server = _server_fork(path, &templ, false);
+  if (server < 0)
+    return false;
+
+  int first = _client_connect(path), clients[SERVER_TEST_SESSIONS];
+  uint32_t opened = 0, boards = 0, answered = 0;
+  uint64_t worst_key_ms = 0;
+  char why[128] = "";
+
+  if (first < 0 || !_client_expect(first, templ.name, SERVER_TEST_TIMEOUT_MS))
+    snprintf(why, sizeof(why), "the first session never got its board");
+
+  const uint64_t started_at = timer_now_ms();
+  for (; why[0] == '\0' && opened < SERVER_TEST_SESSIONS; opened++)
+  {
+    clients[opened] = _client_connect(path);
+    if (clients[opened] < 0)
+      snprintf(why, sizeof(why), "session %u couldn't connect", opened);
+  }
+
+  /* The first session flags and unflags the cell under its cursor while the others wait for their boards */
+  for (uint32_t key = 0; key < SERVER_TEST_KEYS && why[0] == '\0'; key++)
+  {
+    _client_drain(first);
+    const uint64_t key_at = timer_now_ms();
+    if (write(first, "f", 1) != 1 || !_client_expect(first, "", SERVER_TEST_TIMEOUT_MS))
+      snprintf(why, sizeof(why), "the first session stopped answering");
+    if (timer_now_ms() - key_at > worst_key_ms)
+      worst_key_ms = timer_now_ms() - key_at;
+    csleep(0.01);
+  }
+
+  /* Everybody gets a board, then clicks the blessing (the cursor starts on it) */
+  for (uint32_t i = 0; i < opened && why[0] == '\0'; i++)
+  {
+    if (!_client_expect(clients[i], templ.name, SERVER_TEST_TIMEOUT_MS))
+      snprintf(why, sizeof(why), "session %u never got its board", i);
+    else
+      boards++;
+  }
+  const uint64_t all_boards_ms = timer_now_ms() - started_at;
+  for (uint32_t i = 0; i < opened && why[0] == '\0'; i++)
+  {
+    _client_drain(clients[i]);
+    if (write(clients[i], "\r", 1) != 1 || !_client_expect(clients[i], "", SERVER_TEST_TIMEOUT_MS))
+      snprintf(why, sizeof(why), "session %u didn't answer its keys", i);
+    else
+      answered++;
+  }
+  /* Key repeat over a slow link: arrows in a single write, cut into pieces by the server's decoding */
+  if (why[0] == '\0')
+  {
+    char arrows[SERVER_TEST_ARROWS * 3 + 1] = "";
+    for (uint32_t i = 0; i < SERVER_TEST_ARROWS; i++)
+      strcat(arrows, (i % 2) ? "\033[D" : "\033[C");
+    if (send(first, arrows, strlen(arrows), MSG_NOSIGNAL) != (ssize_t)strlen(arrows) || !_client_alive(first, 200))
+      snprintf(why, sizeof(why), "%d arrows in a single write closed the session", SERVER_TEST_ARROWS);
+  }
+  if (why[0] == '\0' && worst_key_ms > SERVER_TEST_MAX_LATENCY_MS)
+    snprintf(why, sizeof(why), "a key waited %llums", (unsigned long long)worst_key_ms);
+
+  for (uint32_t i = 0; i < opened; i++)
+    if (clients[i] >= 0)
+      close(clients[i]);
+  if (first >= 0)
+    close(first);
+  _server_kill(server, path);
+
+  printf("Server with %u sessions on '%s': %u boards in %.2fs, %u answered, keys waited %llums at worst, %s%s%s\n", opened + 1,
+         templ.name, boards, all_boards_ms / 1000.0, answered, (unsigned long long)worst_key_ms, why[0] ? "FAILED (" : "passed", why,
+         why[0] ? ")" : "");
+  return why[0] == '\0';
+}
+
+/*
+ * A forked coop server and players one after the other, every one of them plays until the shared
+ * board is over (clicking around at random) and leaves: the next one has to get a new board to play
+ * on, not the one that's over
+ */
+static bool _coop_server_round(uint32_t games, uint64_t seed)
+{
+  static const char *arrows[] = {"\033[A", "\033[B", "\033[C", "\033[D"};
+  Template templ;
+  template_init(&templ, "Beginner", 9, 9, 10);
+
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/csweeper_test_%d_%llu.sock", (int)getpid(), (unsigned long long)seed);
+  pid_t server = _server_fork(path, &templ, true);
+  if (server < 0)
+    return false;
+
+  Rng rng;
+  rng_seed(&rng, seed);
+  uint32_t played = 0, clicks = 0;
+  char why[128] = "";
+
+  for (; played < games && why[0] == '\0'; played++)
+  {
+    int fd = _client_connect(path);
+    if (fd < 0 || !_client_expect(fd, templ.name, SERVER_TEST_TIMEOUT_MS))
+      snprintf(why, sizeof(why), "player %u never got a board", played);
+    else if (send(fd, "f", 1, MSG_NOSIGNAL) != 1 || !_client_alive(fd, 200))
+      snprintf(why, sizeof(why), "player %u was sent away on its first key", played);
+
+    /* The cursor starts on the blessing, then anywhere until the board is won or lost */
+    const char *key = "\r";
+    const uint64_t started_at = timer_now_ms();
+    while (why[0] == '\0' && send(fd, key, strlen(key), MSG_NOSIGNAL) > 0 && _client_alive(fd, 5))
+    {
+      key = (rng_below(&rng, 2) == 0) ? "\r" : arrows[rng_below(&rng, 4)];
+      clicks += key[0] == '\r';
+      if (timer_now_ms() - started_at > SERVER_TEST_TIMEOUT_MS)
+        snprintf(why, sizeof(why), "player %u's board never ended", played);
+    }
+
+    if (fd >= 0)
+      close(fd);
+  }
+  _server_kill(server, path);
+
+  printf("Shared server on '%s': %u players in a row, %u clicks, %s%s%s\n", templ.name, played, clicks,
+         why[0] ? "FAILED (" : "passed", why, why[0] ? ")" : "");
+  return why[0] == '\0';
+}
+
+#endif /* __linux__ */
+
+int main(int argc, char **argv)
+{
+  if (argc >= 3 && strcmp(argv[1], "--replay") == 0)
+  {
+    Case test;
+    char why[256];
+    Workspace *space = _workspace_new();
+
+    if (space == NULL || !_parse_case(argv[2], &test))
+    {
+      fprintf(stderr, "Couldn't read the case\n");
+      return 2;
+    }
+
+    int result = 0;
+    if (_run(space, &test, why, sizeof(why)) >= 0)
+      result = _report(space, &test);
+    else
+      printf("Passed\n");
+    _workspace_free(space);
+    return result;
+  }
+
+  uint64_t sequences = (argc >= 2) ? strtoull(argv[1], NULL, 10) : DEFAULT_SEQUENCES;
+  uint32_t thread_count = (argc >= 3) ? strtoul(argv[2], NULL, 10) : thread_cpu_count();
+  if (thread_count == 0)
+    thread_count = 1;
+
+  Run *run = malloc(sizeof(Run));
+  Thread *threads = malloc(sizeof(Thread) * thread_count);
+  Worker *workers = malloc(sizeof(Worker) * thread_count);
+  if (run == NULL || threads == NULL || workers == NULL)
+    return 2;
+
+  run->sequences = sequences;
+  atomic_init(&run->next, 0);
+  atomic_init(&run->steps, 0);
+  atomic_init(&run->failed, false);
+
+  printf("Engine vs. reference: %llu sequences on %u threads\n", (unsigned long long)sequences, thread_count);
+  fflush(stdout);
+  const uint64_t started_at = timer_now_ms();
+
+  for (uint32_t i = 0; i < thread_count; i++)
+  {
+    workers[i].run = run;
+    workers[i].space = _workspace_new();
+    if (workers[i].space == NULL)
+      return 2;
+  }
+
+  /* The main thread works too, workers take the next sequence so it's fine if some threads don't start */
+  uint32_t started = 1;
+  while (started < thread_count && thread_start(&threads[started], _worker, &workers[started]))
+    started++;
+  _worker(&workers[0]);
+  for (uint32_t i = 1; i < started; i++)
+    thread_join(&threads[i]);
+
+  int result = 0;
+  if (atomic_load(&run->failed))
+    result = _report(workers[0].space, &run->failure);
+  else
+    printf("Passed: %llu sequences, %llu steps compared in %.1fs\n", (unsigned long long)sequences,
+           (unsigned long long)atomic_load(&run->steps), (timer_now_ms() - started_at) / 1000.0);
+
+  /* A small board everybody keeps running into each other on (and wins), and a huge one */
+  if (result == 0 && !(_coop_round(64, 64, 600, 32, 1) && _coop_round(1000, 1000, 60000, COOP_MAX_PLAYERS, 2)))
+    result = 1;
+  if (result == 0 && !(_solver_round(30, 16, 99, 300, 6) && _solver_round(36, 30, 252, 300, 7)))
+    result = 1;
+  /* Expert boards, and sparse ones wider than a word with openings that wind around */
+  if (result == 0 && !(_planes_round(30, 16, 99, 20000, 12) && _planes_round(300, 200, 6000, 500, 13)))
+    result = 1;
+  if (result == 0 && !(_bits_round(30, 16, 99, 20000, 4) && _bits_round(36, 30, 252, 20000, 5)))
+    result = 1;
+  /* Forced onto 8 threads, there might be less CPUs than that */
+  if (result == 0 && !_flood_round(2000, 2000, 50000, 8, 3))
+    result = 1;
+  if (result == 0 && !(_sampler_exact_round(9, 9, 10, 40, 8) && _sampler_exact_round(16, 16, 40, 40, 9) &&
+                       _sampler_speed_round(200, 200, 6000, 5, 10)))
+    result = 1;
+#ifdef __linux__
+  if (result == 0 && !(_server_round(11) && _coop_server_round(3, 14)))
+    result = 1;
+#endif
+
+  for (uint32_t i = 0; i < thread_count; i++)
+    _workspace_free(workers[i].space);
+  free(workers);
+  free(threads);
+  free(run);
+  return result;
+}
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /*
 HEADER FILES
@@ -9,6 +10,11 @@ HEADER FILES
 #include "utils/input.h"        /* Input Functions */
 #include "app/menus.h"          /* Game Menus */
 #include "app/game.h"           /* Game Functions */
+#include "app/solver.h"         /* Solver Tiers */
+#include "app/server.h"         /* Server Mode */
+#include "app/autoplay.h"       /* Solver Autoplay */
+#include "app/stats.h"          /* Results Log */
+#include "utils/profile.h"      /* Instrumentation */
 
 /*
  * Templates (un)thankfully had to be hardcoded,
@@ -30,31 +36,63 @@ HEADER FILES
 #define MIN_HEIGHT 10
 #define MAX_HEIGHT 40
 
-int main()
+/* Where the instrumentation goes on exit (CSWEEPER_PROFILE) */
+static const char *profile_path = NULL;
+
+static void _dump_profile()
 {
-  /*
-  Activate and register for deactivate special functions for the console
-  to activate non-blocking input (necessary for UNIX)
-  */
-#ifndef _WIN32
-  init_term();
-  atexit(reset_term);
-#endif
+  FILE *file = fopen(profile_path, "w");
+  if (file == NULL)
+    return;
+  profile_dump_json(file);
+  fclose(file);
+}
+
+/* Results of every finished game, NULL if the files couldn't be opened */
+static StatsStore stats_store;
+static StatsStore *stats = NULL;
+
+static void _close_stats()
+{
+  stats_close(stats);
+}
+
+int main(int argc, char **argv)
+{
+  /* Whole frames go out in a single write, everything that waits for input flushes first */
+  setvbuf(stdout, NULL, _IOFBF, CONSOLE_STDOUT_BUFFER);
+
+  /* CSWEEPER_PROFILE=<file> dumps the counters and timings as JSON on exit */
+  profile_path = getenv("CSWEEPER_PROFILE");
+  if (profile_path != NULL && profile_path[0] != '\0')
+    atexit(_dump_profile);
+
+  /* CSWEEPER_STATS=<path> keeps the results somewhere else than csweeper_stats.log/.idx */
+  const char *stats_path = getenv("CSWEEPER_STATS");
+  if (stats_open(&stats_store, (stats_path != NULL && stats_path[0] != '\0') ? stats_path : "csweeper_stats"))
+  {
+    stats = &stats_store;
+    atexit(_close_stats);
+  }
 
   /* Template definitions */
   Template templates[TEMPLATE_COUNT];
 
   /* Template init takes: Template Pointer, Template Name, Width, Height, Bomb Amount */
   /* Template colors takes: Template Pointer, Foreground Color, Background Color */
+  /* Template difficulty takes: Template Pointer, Min 3BV, Max 3BV, Max Solver Tier (0 for no limit) */
 
   template_init(&templates[0], "Easy", 10, 10, 10);
   template_colors(&templates[0], CC_BLUE, 0);
+  template_difficulty(&templates[0], 0, 0, SOLVER_TIER_SINGLE);
 
   template_init(&templates[1], "Medium", 16, 16, 40);
   template_colors(&templates[1], CC_GREEN, 0);
+  template_difficulty(&templates[1], 0, 0, SOLVER_TIER_SUBSET);
 
   template_init(&templates[2], "Hard", 30, 16, 99);
   template_colors(&templates[2], CC_YELLOW, 0);
+  template_difficulty(&templates[2], 0, 0, SOLVER_TIER_SUBSET);
 
   template_init(&templates[3], "Expert", 36, 20, 165);
   template_colors(&templates[3], CC_RED, 0);
@@ -62,6 +100,41 @@ int main()
   template_init(&templates[4], "Master", 36, 30, 252);
   template_colors(&templates[4], CC_WHITE, CC_RED);
 
+  /*
+  Server mode: main --server <unix:path | tcp:port> [template number] [--coop]
+  --coop puts everybody on the same board
+  */
+  if (argc >= 3 && strcmp(argv[1], "--server") == 0)
+  {
+    bool coop = strcmp(argv[argc - 1], "--coop") == 0;
+    int32_t template = (argc - coop >= 4) ? atoi(argv[3]) : 1;
+    if (template <= 0 || template > TEMPLATE_COUNT)
+    {
+      printf("The template doesn't exist...\n");
+      return 1;
+    }
+    return server_run(argv[2], &templates[template - 1], stats, coop);
+  }
+
+  /*
+  Activate and register for deactivate special functions for the console
+  to activate non-blocking input (necessary for UNIX)
+  */
+#ifndef _WIN32
+  init_term();
+  atexit(reset_term);
+  /* The game relayouts itself when the terminal is resized */
+  console_watch_resize();
+#endif
+
+  /* Shortest escapes the terminal understands */
+  console_detect_capabilities();
+
+#ifndef _WIN32
+  /* Play on the alternate screen, reset_term brings the old one back */
+  console_alternate_screen(true);
+#endif
+
   /* Start the program */
   clear_screen();
 
@@ -84,7 +157,7 @@ int main()
     case (1):
     {
       /* Display the current templates */
-      template_menu(templates, TEMPLATE_COUNT);
+      template_menu(templates, TEMPLATE_COUNT, stats);
       /* Get the user option */
       int32_t template = read_int("> ");
 
@@ -101,12 +174,12 @@ int main()
       else
       {
         console_foreground_set(CC_BLUE);
-        printf("Depending on your terminal's size, it is possible the game doesn't fit properly on the screen. If this does happen, try to resize and press R to refresh the screen"); /* Print print print */
+        printf("If the board doesn't fit on your terminal, only the part around the cursor is shown. Resizing the terminal updates the game right away"); /* Print print print */
 
         fflush(stdout); /* For some reason stuff doesn't show up so I gotta force it to */
 
         csleep(3.5);
-        start_template_game(&templates[template - 1]);
+        start_template_game(&templates[template - 1], stats);
       }
       break;
     }
@@ -145,11 +218,46 @@ int main()
       }
 
       /* Start the game let's GOOO */
-      start_custom_game(width, height, bomb_amount);
+      start_custom_game(width, height, bomb_amount, stats);
       break;
           /* Read from th*/}
-    /* Case 3: Let's get the fuck out of here */
+    /* Case 3: Sit back and let the solver play a template */
     case (3):
+    {
+      template_menu(templates, TEMPLATE_COUNT, stats);
+      int32_t template = read_int("> ");
+
+      if (template <= 0 || template > TEMPLATE_COUNT)
+      {
+        printf("The template doesn't exist...");
+        fflush(stdout);
+
+        csleep(2);
+        break;
+      }
+
+      autoplay_menu();
+      int32_t mode = read_int("> ");
+
+      if (mode == 1)
+      {
+        int32_t speed;
+        while (true)
+        {
+          speed = read_int("| Moves per second (0 for as fast as it can): ");
+          if (speed < 0 || speed > 1000)
+            printf("Invalid speed! (Accepted range: 0-1000)\n");
+          else
+            break;
+        }
+        autoplay_watch(&templates[template - 1], speed);
+      }
+      else if (mode == 2)
+        autoplay_benchmark(&templates[template - 1], AUTOPLAY_BENCHMARK_GAMES);
+      break;
+    }
+    /* Case 4: Let's get the fuck out of here */
+    case (4):
     {
       trigger_exit = true;
       break;
@@ -0,0 +1,146 @@
+/*
+ * Pattern table generator for the solver, the makefile runs it before building anything the solver is in.
+ *
+ * A pattern is a run of up to PATTERN_MAX_RUN numbers in a straight line, with all of their covered
+ * neighbours on one side of it: a cell next to every number, plus one past each end (an end is open
+ * if that one is covered, closed if it's shown, a bomb or off the board). It's read the same way
+ * whichever side of the line the covered cells are on, so one table covers all 4 of them.
+ *
+ * Every number goes in as the bombs it's still missing (0 to 3), and every way the bombs could lie
+ * on the covered cells is tried: whatever is the same in all of the layouts that fit is forced.
+ * A run read backwards is another key, that one's entry is just this one's mirrored.
+ *
+ * The table is indexed by pattern_offsets[length] + (ends << 2 * length) + the missing bombs of
+ * number i at bits 2i, ends having bit 0 if the cell before the run is open and bit 1 if the one
+ * after it is. Bit j of an entry is the covered cell next to number j - 1, safe cells in the low
+ * byte and bombs in the high one, 0 means nothing is forced (or no layout fits).
+ *
+ * Usage: pattern_gen <output header>
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define PATTERN_MAX_RUN 5
+
+/* Keys of a run of `length` numbers: 4 ways its ends can be times 4 counts for every number */
+static uint32_t _keys(uint32_t length)
+{
+  return 4u << (2 * length);
+}
+
+/* Cells reversed, in both bytes */
+static uint16_t _mirror(uint16_t entry, uint32_t length)
+{
+  const uint32_t cells = length + 2;
+  uint16_t mirrored = 0;
+
+  for (uint32_t j = 0; j < cells; j++)
+  {
+    if (entry & (1u << j))
+      mirrored |= 1u << (cells - 1 - j);
+    if (entry & (1u << (j + 8)))
+      mirrored |= 1u << (cells - 1 - j + 8);
+  }
+  return mirrored;
+}
+
+/* The same run read from the other end */
+static uint32_t _reverse(uint32_t key, uint32_t length)
+{
+  const uint32_t ends = key >> (2 * length);
+  uint32_t reversed = ((ends & 1) << 1) | (ends >> 1);
+
+  for (uint32_t i = 0; i < length; i++)
+    reversed = (reversed << 2) | ((key >> (2 * i)) & 3);
+  return reversed;
+}
+
+/* Tries every layout of the covered cells */
+static uint16_t _solve(uint32_t key, uint32_t length)
+{
+  const uint32_t cells = length + 2;
+  const uint32_t ends = key >> (2 * length);
+  uint32_t open = (1u << cells) - 1;
+  if (!(ends & 1))
+    open &= ~1u;
+  if (!(ends & 2))
+    open &= ~(1u << (cells - 1));
+
+  uint32_t always = open, never = open;
+  bool fits_any = false;
+  for (uint32_t layout = 0; layout < (1u << cells); layout++)
+  {
+    if (layout & ~open)
+      continue;
+
+    /* Number i sees the cells i, i + 1 and i + 2 */
+    bool fits = true;
+    for (uint32_t i = 0; i < length && fits; i++)
+      fits = (uint32_t)__builtin_popcount((layout >> i) & 7) == ((key >> (2 * i)) & 3);
+    if (!fits)
+      continue;
+
+    fits_any = true;
+    always &= layout;
+    never &= ~layout;
+  }
+
+  return fits_any ? (uint16_t)(never | (always << 8)) : 0;
+}
+
+int main(int argc, char **argv)
+{
+  static uint16_t table[PATTERN_MAX_RUN + 1][4u << (2 * PATTERN_MAX_RUN)];
+
+  if (argc != 2)
+  {
+    fprintf(stderr, "usage: %s <output header>\n", argv[0]);
+    return 1;
+  }
+
+  FILE *out = fopen(argv[1], "w");
+  if (out == NULL)
+  {
+    perror(argv[1]);
+    return 1;
+  }
+
+  uint32_t size = 0, solved = 0, forced = 0;
+  fprintf(out, "/* Made by src/pattern_gen.c, see there for what's in it */\n");
+  fprintf(out, "#define PATTERN_MAX_RUN %d\n\n", PATTERN_MAX_RUN);
+  fprintf(out, "static const uint16_t pattern_offsets[PATTERN_MAX_RUN + 1] = {");
+  for (uint32_t length = 0; length <= PATTERN_MAX_RUN; length++)
+  {
+    fprintf(out, "%s%u", length ? ", " : "", size);
+    if (length > 0)
+      size += _keys(length);
+  }
+  fprintf(out, "};\n\n");
+
+  fprintf(out, "static const uint16_t pattern_table[%u] = {", size);
+  for (uint32_t length = 1; length <= PATTERN_MAX_RUN; length++)
+    for (uint32_t key = 0; key < _keys(length); key++)
+    {
+      const uint32_t reversed = _reverse(key, length);
+      if (reversed < key)
+        table[length][key] = _mirror(table[length][reversed], length);
+      else
+      {
+        table[length][key] = _solve(key, length);
+        solved++;
+      }
+      forced += table[length][key] != 0;
+
+      fprintf(out, "%s0x%04x,", (key % 8 == 0) ? "\n    " : " ", table[length][key]);
+    }
+  fprintf(out, "\n};\n");
+
+  if (fclose(out) != 0)
+  {
+    perror(argv[1]);
+    return 1;
+  }
+  printf("%u patterns (%u solved, the rest mirrored), %u force something\n", size, solved, forced);
+  return 0;
+}
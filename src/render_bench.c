@@ -0,0 +1,147 @@
+/*
+ * Byte count benchmark for the terminal output.
+ *
+ * Plays the same scripted game on every standard template (draw the board, open the blessing,
+ * walk the cursor over every cell and flag some of them) with the old escapes and with the
+ * compact ones, and prints how many bytes each one sent. Then plays it again on the null render
+ * backend, which only counts the operations. Build and run with 'make bench'.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "app/game.h"
+#include "classes/buffer.h"
+#include "classes/templates.h"
+#include "utils/consoleutils.h"
+
+#define TEMPLATE_COUNT 5
+#define MODE_COUNT 3
+
+typedef struct
+{
+  const char *name;
+  uint16_t colors;
+  bool compact;
+} Mode;
+
+static const Mode modes[MODE_COUNT] = {
+    {"legacy", 256, false},
+    {"compact", 256, true},
+    {"16 colors", 16, true},
+};
+
+/* Bytes sent to draw the board, and to play on it */
+typedef struct
+{
+  size_t draw;
+  size_t play;
+} Result;
+
+/* Open the blessing, then walk over every row (back and forth), flagging every 5th covered cell */
+static void _play(Game *game)
+{
+  game_handle_key(game, VK_ENTER);
+  uint32_t steps = 0;
+  for (uint16_t row = 0; row < game->height && game->running; row++)
+  {
+    for (uint16_t column = 1; column < game->width; column++)
+    {
+      game_handle_key(game, (row % 2 == 0) ? VK_RIGHT : VK_LEFT);
+      if (++steps % 5 == 0 && !game->board[game->cursor.y][game->cursor.x].is_mined)
+        game_handle_key(game, 'f');
+    }
+    game_handle_key(game, VK_DOWN);
+  }
+}
+
+static bool _run(const Template *templ, const Mode *mode, Result *result)
+{
+  Buffer output;
+  ConsoleState console;
+  buffer_init(&output);
+  console_state_init(&console, mode->colors, mode->compact);
+  console_set_output(&output, &console);
+
+  Game game;
+  if (!game_init(&game, templ, templ->width, templ->height, templ->bomb_amount, 1))
+  {
+    console_set_output(NULL, NULL);
+    return false;
+  }
+
+  game_draw(&game);
+  result->draw = output.length;
+
+  _play(&game);
+  result->play = output.length - result->draw;
+
+  console_set_output(NULL, NULL);
+  game_free(&game);
+  buffer_free(&output);
+  return true;
+}
+
+/* Same game on the null backend, nothing is drawn */
+static bool _run_headless(const Template *templ, RenderCounts *counts)
+{
+  Game game;
+  if (!game_init(&game, templ, templ->width, templ->height, templ->bomb_amount, 1))
+    return false;
+
+  console_set_backend(&render_null_backend, counts);
+  game_draw(&game);
+  _play(&game);
+  console_set_backend(NULL, NULL);
+
+  game_free(&game);
+  return true;
+}
+
+int main()
+{
+  Template templates[TEMPLATE_COUNT];
+
+  /* Same sizes as the game's templates, without difficulty ranges so the boards are always the same */
+  template_init(&templates[0], "Easy", 10, 10, 10);
+  template_init(&templates[1], "Medium", 16, 16, 40);
+  template_init(&templates[2], "Hard", 30, 16, 99);
+  template_init(&templates[3], "Expert", 36, 20, 165);
+  template_init(&templates[4], "Master", 36, 30, 252);
+
+  printf("%-8s %-10s %10s %10s %10s %8s\n", "template", "escapes", "draw", "play", "total", "vs old");
+  for (int32_t i = 0; i < TEMPLATE_COUNT; i++)
+  {
+    size_t legacy_total = 0;
+    for (int32_t j = 0; j < MODE_COUNT; j++)
+    {
+      Result result;
+      if (!_run(&templates[i], &modes[j], &result))
+      {
+        printf("Couldn't set up a '%s' game\n", templates[i].name);
+        return 1;
+      }
+
+      size_t total = result.draw + result.play;
+      if (j == 0)
+        legacy_total = total;
+      printf("%-8s %-10s %10zu %10zu %10zu %7.1f%%\n", templates[i].name, modes[j].name,
+             result.draw, result.play, total, 100.0 * total / legacy_total);
+    }
+  }
+
+  printf("\n%-8s %10s %10s %10s %10s %10s\n", "null", "clears", "moves", "colors", "texts", "bytes");
+  for (int32_t i = 0; i < TEMPLATE_COUNT; i++)
+  {
+    RenderCounts counts = {0};
+    if (!_run_headless(&templates[i], &counts))
+    {
+      printf("Couldn't set up a '%s' game\n", templates[i].name);
+      return 1;
+    }
+    printf("%-8s %10llu %10llu %10llu %10llu %10llu\n", templates[i].name, (unsigned long long)counts.clears,
+           (unsigned long long)counts.moves, (unsigned long long)counts.colors,
+           (unsigned long long)counts.texts, (unsigned long long)counts.bytes);
+  }
+
+  return 0;
+}
@@ -1,30 +1,447 @@
+#include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "consoleutils.h"
+#include "profile.h"
+
+/*
+Where everything gets printed, NULL means straight to stdout
+*/
+static Buffer *console_output = NULL;
+
+/*
+What we know about the local console, and about whatever console_output goes to
+*/
+static ConsoleState local_state = {256, true, CONSOLE_UNKNOWN_COLOR, CONSOLE_UNKNOWN_COLOR, 0, 0, true, false, false};
+static ConsoleState *console_state = &local_state;
+/* Whether the local console is on the alternate screen */
+static bool alternate_screen = false;
+
+/*
+What the console functions draw with, the ANSI terminal (console_output) unless it's swapped
+*/
+static const RenderBackend *console_backend = &console_ansi_backend;
+static void *console_backend_context = NULL;
+
+/* Private mode escapes */
+#define FRAME_BEGIN "\033[?2026h\033[?25l"
+#define FRAME_END "\033[?25h\033[?2026l"
+#define ALTERNATE_SCREEN_ENTER "\033[?1049h"
+#define ALTERNATE_SCREEN_LEAVE "\033[?1049l"
+
+void console_state_init(ConsoleState *state, uint16_t colors, bool compact)
+{
+  state->colors = colors;
+  state->compact = compact;
+  state->fg = CONSOLE_UNKNOWN_COLOR;
+  state->bg = CONSOLE_UNKNOWN_COLOR;
+  state->x = 0;
+  state->y = 0;
+  state->private_modes = colors > 0;
+  state->frames = false;
+  state->in_frame = false;
+}
+
+void console_detect_capabilities()
+{
+  const char *term = getenv("TERM");
+  const char *colorterm = getenv("COLORTERM");
+
+  /* No TERM (Windows) keeps the 256 colors we always used */
+  uint16_t colors = 256;
+  if (colorterm != NULL && colorterm[0] != '\0')
+    colors = 256; /* truecolor / 24bit terminals have 256 too */
+  else if (term != NULL)
+  {
+    if (strcmp(term, "dumb") == 0)
+      colors = 0;
+    else if (strstr(term, "256color") != NULL)
+      colors = 256;
+    else if (strncmp(term, "linux", 5) == 0 || strncmp(term, "vt", 2) == 0 ||
+             strncmp(term, "ansi", 4) == 0 || strncmp(term, "cons", 4) == 0)
+      colors = 16;
+  }
+
+  local_state.colors = colors;
+  /* Dumb terminals would print the escapes */
+  local_state.private_modes = colors > 0;
+}
+
+static void _end_frame();
+
+void console_set_output(Buffer *buffer, ConsoleState *state)
+{
+  /* Whatever was being drawn on the old output is complete */
+  _end_frame();
+
+  console_output = buffer;
+  console_state = (state != NULL) ? state : &local_state;
+}
+
+Buffer *console_get_output()
+{
+  return console_output;
+}
+
+void console_set_backend(const RenderBackend *backend, void *context)
+{
+  /* Whatever was being drawn on the terminal is complete */
+  if (console_backend == &console_ansi_backend)
+    _end_frame();
+
+  console_backend = (backend != NULL) ? backend : &console_ansi_backend;
+  console_backend_context = context;
+}
+
+const RenderBackend *console_get_backend(void **context)
+{
+  if (context != NULL)
+    *context = console_backend_context;
+  return console_backend;
+}
+
+/* Bytes sent to stdout since it was last flushed */
+static size_t stdout_pending = 0;
+
+/* Sends bytes as they are */
+static void _send(const char *data, size_t length)
+{
+  profile_count(PROFILE_BYTES, length);
+  if (console_output == NULL)
+  {
+    fwrite(data, 1, length, stdout);
+    stdout_pending += length;
+  }
+  else
+    buffer_append(console_output, data, length);
+}
+
+/* Sends bytes, opening a frame first if frames are on */
+static void _write(const char *data, size_t length)
+{
+  ConsoleState *state = console_state;
+  if (state->frames && state->private_modes && !state->in_frame)
+  {
+    _send(FRAME_BEGIN, sizeof(FRAME_BEGIN) - 1);
+    state->in_frame = true;
+  }
+  _send(data, length);
+}
+
+static void _end_frame()
+{
+  if (!console_state->in_frame)
+    return;
+  _send(FRAME_END, sizeof(FRAME_END) - 1);
+  console_state->in_frame = false;
+}
+
+/* Follows the cursor through printed text */
+static void _track(const char *text, size_t length)
+{
+  ConsoleState *state = console_state;
+
+  for (size_t i = 0; i < length; i++)
+  {
+    unsigned char c = text[i];
+
+    if (c == '\r')
+      state->x = 1;
+    else if (c == '\n')
+    {
+      /* The column after a \n depends on the terminal's settings, unless it already is the first one */
+      if (state->y)
+        state->y++;
+      if (state->x != 1)
+        state->x = 0;
+    }
+    else if (c < 0x20 || c == 0x7F)
+      state->x = state->y = 0; /* Escapes, tabs... who knows */
+    else if ((c & 0xC0) != 0x80 && state->x)
+      state->x++; /* UTF-8 continuation bytes don't take space */
+  }
+}
+
+/* printf for escapes, which don't move the cursor through _track */
+static void _emit(const char *format, ...)
+{
+  char escape[32];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(escape, sizeof(escape), format, args);
+  va_end(args);
+
+  if (length > 0)
+    _write(escape, length);
+}
+
+void console_print(const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+
+  /* Almost everything fits in here, only go to the heap for the big ones (they could be any size) */
+  char small[256];
+  va_list copy;
+  va_copy(copy, args);
+  int length = vsnprintf(small, sizeof(small), format, copy);
+  va_end(copy);
+
+  char *big = (length >= (int)sizeof(small)) ? malloc((size_t)length + 1) : NULL;
+  if (big != NULL)
+  {
+    vsnprintf(big, (size_t)length + 1, format, args);
+    console_backend->text(console_backend_context, big, length);
+    free(big);
+  }
+  else if (length > 0)
+  {
+    /* Out of memory for a big one, at least the start of it shows up */
+    if (length >= (int)sizeof(small))
+      length = sizeof(small) - 1;
+    console_backend->text(console_backend_context, small, length);
+  }
+
+  va_end(args);
+}
+
+void console_flush()
+{
+  console_backend->flush(console_backend_context);
+}
+
+void console_set_frames(bool enabled)
+{
+  if (!enabled)
+    _end_frame();
+  console_state->frames = enabled;
+}
+
+void console_alternate_screen(bool enabled)
+{
+  if (!local_state.private_modes || enabled == alternate_screen)
+    return;
+
+  fflush(stdout);
+  fputs(enabled ? ALTERNATE_SCREEN_ENTER : ALTERNATE_SCREEN_LEAVE, stdout);
+  fflush(stdout);
+  alternate_screen = enabled;
+
+  /* It's a different screen, nothing we knew about the old one applies */
+  local_state.x = local_state.y = 0;
+}
+
+void console_restore()
+{
+  const RenderBackend *backend = console_backend;
+  void *context = console_backend_context;
+  Buffer *output = console_output;
+  ConsoleState *state = console_state;
+  console_set_backend(NULL, NULL);
+  console_set_output(NULL, NULL);
+
+  _end_frame();
+  local_state.frames = false;
+  console_color_reset();
+  console_alternate_screen(false);
+  fflush(stdout);
+
+  console_output = output;
+  console_state = state;
+  console_backend = backend;
+  console_backend_context = context;
+}
+
+/* CUU/CUD/CUF/CUB, the 1 is implied */
+static int _move(char *out, size_t size, int32_t amount, char direction)
+{
+  if (amount == 1)
+    return snprintf(out, size, "\033[%c", direction);
+  return snprintf(out, size, "\033[%d%c", amount, direction);
+}
+
+/*
+Writes the shortest way to get from (state->x, state->y) to (x, y), relative moves are only
+an option if we know where the cursor is
+*/
+static int _shortest_move(char *out, size_t size, const ConsoleState *state, uint16_t x, uint16_t y)
+{
+  int length;
+  if (x == 1 && y == 1)
+    length = snprintf(out, size, "\033[H");
+  else if (x == 1)
+    length = snprintf(out, size, "\033[%dH", y);
+  else
+    length = snprintf(out, size, "\033[%d;%dH", y, x);
+
+  if (state->x == 0 || state->y == 0)
+    return length;
+
+  const int32_t dx = (int32_t)x - state->x;
+  const int32_t dy = (int32_t)y - state->y;
+  char candidate[32];
+  int used = 0;
+
+  /* Vertical and horizontal moves */
+  if (dy != 0)
+    used += _move(candidate + used, sizeof(candidate) - used, dy > 0 ? dy : -dy, dy > 0 ? 'B' : 'A');
+  if (dx != 0)
+    used += _move(candidate + used, sizeof(candidate) - used, dx > 0 ? dx : -dx, dx > 0 ? 'C' : 'D');
+  if (used < length)
+  {
+    memcpy(out, candidate, used + 1);
+    length = used;
+  }
+
+  /* Start of a line: carriage return and line feeds (or a move down) */
+  if (x == 1)
+  {
+    used = snprintf(candidate, sizeof(candidate), "\r");
+    if (dy > 0 && dy <= 2)
+      used += snprintf(candidate + used, sizeof(candidate) - used, dy == 1 ? "\n" : "\n\n");
+    else if (dy != 0)
+      used += _move(candidate + used, sizeof(candidate) - used, dy > 0 ? dy : -dy, dy > 0 ? 'B' : 'A');
+
+    if (used < length)
+    {
+      memcpy(out, candidate, used + 1);
+      length = used;
+    }
+  }
+
+  return length;
+}
 
 /*
 Macros for setting console position
 */
-#define GOTOXY(x, y) printf("%c[%d;%df", 0x1B, y, x);
-#define RESETXY printf("\033[H")
+#define GOTOXY(x, y) _emit("%c[%d;%df", 0x1B, y, x);
 
 void console_gotoxy(uint16_t x, uint16_t y)
 {
-  GOTOXY(x, y);
+  console_backend->move(console_backend_context, x, y);
+}
+
+static void _ansi_move(void *context, uint16_t x, uint16_t y)
+{
+  ConsoleState *state = console_state;
+
+  if (!state->compact)
+  {
+    GOTOXY(x, y)
+  }
+  else if (state->x != x || state->y != y)
+  {
+    char move[32];
+    int length = _shortest_move(move, sizeof(move), state, x, y);
+    _write(move, length);
+  }
+
+  state->x = x;
+  state->y = y;
 }
 
 void console_pos_reset()
 {
-  RESETXY;
+  console_gotoxy(1, 1);
 }
 
 /*
 Macros for setting foreground and background colors based on ANSI
 */
-#define ANSI_SET_FG_COLOR(x) printf("\033[38;5;%dm", x)
-#define ANSI_SET_BG_COLOR(x) printf("\033[48;5;%dm", x)
+#define ANSI_SET_FG_COLOR(x) _emit("\033[38;5;%dm", x)
+#define ANSI_SET_BG_COLOR(x) _emit("\033[48;5;%dm", x)
+
+#define ANSI_SET_DEFAULT_FG_COLOR _emit("\033[39m")
+#define ANSI_SET_DEFAULT_BG_COLOR _emit("\033[49m")
+
+/* Closest of the 16 basic colors to one of the 256 */
+static uint16_t _to_16_colors(uint16_t color)
+{
+  if (color < 16)
+    return color;
+
+  /* Grays */
+  if (color >= 232)
+    return (color < 238) ? 0 : (color < 244) ? 8 : (color < 250) ? 7 : 15;
 
-#define ANSI_SET_DEFAULT_FG_COLOR printf("\033[39m")
-#define ANSI_SET_DEFAULT_BG_COLOR printf("\033[49m")
+  /* 6x6x6 cube, every channel 0 to 5 */
+  uint16_t cube = color - 16;
+  uint16_t r = cube / 36, g = (cube / 6) % 6, b = cube % 6;
+  uint16_t basic = (r >= 2) | ((g >= 2) << 1) | ((b >= 2) << 2);
+  bool bright = r >= 4 || g >= 4 || b >= 4;
+  return basic + (bright ? 8 : 0);
+}
+
+/* SGR parameter for a color (30-37, 90-97 and 38;5;n, 40 higher for backgrounds) */
+static int _color_parameter(char *out, size_t size, uint16_t color, bool background, uint16_t colors)
+{
+  if (color == CONSOLE_DEFAULT_COLOR)
+    return snprintf(out, size, background ? "49" : "39");
+
+  if (colors < 256)
+    color = _to_16_colors(color);
+
+  if (color < 8)
+    return snprintf(out, size, "%d", (background ? 40 : 30) + color);
+  if (color < 16)
+    return snprintf(out, size, "%d", (background ? 100 : 90) + color - 8);
+  return snprintf(out, size, background ? "48;5;%d" : "38;5;%d", color);
+}
+
+/* Sets whatever changed (both in a single escape) */
+static void _ansi_colors(void *context, uint16_t fg, uint16_t bg, bool set_fg, bool set_bg)
+{
+  ConsoleState *state = console_state;
+
+  if (!state->compact)
+  {
+    /* The way it always was, every call sends its escape */
+    if (set_fg && fg == CONSOLE_DEFAULT_COLOR)
+      ANSI_SET_DEFAULT_FG_COLOR;
+    else if (set_fg)
+      ANSI_SET_FG_COLOR(fg);
+    if (set_bg && bg == CONSOLE_DEFAULT_COLOR)
+      ANSI_SET_DEFAULT_BG_COLOR;
+    else if (set_bg)
+      ANSI_SET_BG_COLOR(bg);
+  }
+  else if (state->colors > 0)
+  {
+    set_fg = set_fg && fg != state->fg;
+    set_bg = set_bg && bg != state->bg;
+    if (!set_fg && !set_bg)
+      return;
+
+    char escape[32] = "\033[";
+    int length = 2;
+    /* Both back to default is a plain reset */
+    if (!(set_fg && set_bg && fg == CONSOLE_DEFAULT_COLOR && bg == CONSOLE_DEFAULT_COLOR))
+    {
+      if (set_fg)
+        length += _color_parameter(escape + length, sizeof(escape) - length, fg, false, state->colors);
+      if (set_fg && set_bg)
+        escape[length++] = ';';
+      if (set_bg)
+        length += _color_parameter(escape + length, sizeof(escape) - length, bg, true, state->colors);
+    }
+    escape[length++] = 'm';
+    _write(escape, length);
+  }
+
+  if (set_fg)
+    state->fg = fg;
+  if (set_bg)
+    state->bg = bg;
+}
+
+static void _colors_set(uint16_t fg, uint16_t bg, bool set_fg, bool set_bg)
+{
+  console_backend->colors(console_backend_context, fg, bg, set_fg, set_bg);
+}
 
 /*
 Multiple functions to control colors in general :PPP
@@ -32,44 +449,147 @@ Multiple functions to control colors in general :PPP
 
 void console_foreground_set(uint8_t color)
 {
-  ANSI_SET_FG_COLOR(color);
+  _colors_set(color, 0, true, false);
 }
 
 void console_background_set(uint8_t color)
 {
-  ANSI_SET_BG_COLOR(color);
+  _colors_set(0, color, false, true);
+}
+
+void console_colors_set(uint16_t fg, uint16_t bg)
+{
+  _colors_set(fg, bg, true, true);
 }
 
 void console_foreground_reset()
 {
-  ANSI_SET_DEFAULT_FG_COLOR;
+  _colors_set(CONSOLE_DEFAULT_COLOR, 0, true, false);
 }
 
 void console_background_reset()
 {
-  ANSI_SET_DEFAULT_BG_COLOR;
+  _colors_set(0, CONSOLE_DEFAULT_COLOR, false, true);
 }
 
 void console_color_reset()
 {
-  ANSI_SET_DEFAULT_FG_COLOR;
-  ANSI_SET_DEFAULT_BG_COLOR;
+  _colors_set(CONSOLE_DEFAULT_COLOR, CONSOLE_DEFAULT_COLOR, true, true);
 }
 
 /* Platform Specific behaviour */
 #ifdef _WIN32
 #include <windows.h>
-#include <stdlib.h>
 
 #define psleep(x) Sleep(x * 1000)
 #define clrscr system("cls")
 
+bool console_get_size(uint16_t *columns, uint16_t *rows)
+{
+  CONSOLE_SCREEN_BUFFER_INFO info;
+  if (!GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info))
+    return false;
+
+  *columns = info.srWindow.Right - info.srWindow.Left + 1;
+  *rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+  return true;
+}
+
+void console_watch_resize()
+{
+}
+
+int console_resize_fd()
+{
+  return -1;
+}
+
+/* No signal for it, the size is checked every time the event loop wakes up */
+bool console_resized()
+{
+  static uint16_t last_columns = 0, last_rows = 0;
+  uint16_t columns, rows;
+  if (!console_get_size(&columns, &rows) || (columns == last_columns && rows == last_rows))
+    return false;
+
+  bool first = last_columns == 0;
+  last_columns = columns;
+  last_rows = rows;
+  return !first;
+}
+
 #elif defined(__unix__) || defined(__APPLE__) || defined(__linux__)
 
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <unistd.h>
+#include <sys/ioctl.h>
 
 #define psleep(x) usleep(x * 1000000)
-#define clrscr printf("\033[2J\033[1;1H")
+#define clrscr _emit(console_state->compact ? "\033[2J\033[H" : "\033[2J\033[1;1H")
+
+/* Self-pipe, the SIGWINCH handler writes a byte on [1], event loops wait on [0] */
+static int resize_pipe[2] = {-1, -1};
+
+static void _on_resize(int sig)
+{
+  (void)sig;
+  int saved_errno = errno;
+  char byte = 0;
+  /* If the pipe's full there's already a resize waiting, nothing's lost */
+  ssize_t ignored = write(resize_pipe[1], &byte, 1);
+  (void)ignored;
+  errno = saved_errno;
+}
+
+bool console_get_size(uint16_t *columns, uint16_t *rows)
+{
+  struct winsize size;
+  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) < 0 || size.ws_col == 0 || size.ws_row == 0)
+    return false;
+
+  *columns = size.ws_col;
+  *rows = size.ws_row;
+  return true;
+}
+
+void console_watch_resize()
+{
+  if (resize_pipe[0] >= 0 || pipe(resize_pipe) < 0)
+    return;
+
+  for (int32_t i = 0; i < 2; i++)
+  {
+    fcntl(resize_pipe[i], F_SETFL, fcntl(resize_pipe[i], F_GETFL) | O_NONBLOCK);
+    fcntl(resize_pipe[i], F_SETFD, FD_CLOEXEC);
+  }
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = _on_resize;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGWINCH, &action, NULL);
+}
+
+int console_resize_fd()
+{
+  return resize_pipe[0];
+}
+
+bool console_resized()
+{
+  if (resize_pipe[0] < 0)
+    return false;
+
+  /* Many resizes in a row are a single relayout */
+  char drain[64];
+  bool resized = false;
+  while (read(resize_pipe[0], drain, sizeof(drain)) > 0)
+    resized = true;
+  return resized;
+}
 
 #else
 #error This target cannot be compiled. Please add definitions for your current build system.
@@ -77,10 +597,55 @@ void console_color_reset()
 
 void clear_screen()
 {
-  clrscr;
+  console_backend->clear(console_backend_context);
+}
+
+static void _ansi_clear(void *context)
+{
+  /* Output that isn't going to this console can't use the system's clear */
+  if (console_output != NULL)
+    _emit(console_state->compact ? "\033[2J\033[H" : "\033[2J\033[1;1H");
+  else
+  {
+    fflush(stdout);
+    clrscr;
+  }
+
+  console_state->x = 1;
+  console_state->y = 1;
 }
 
 void csleep(double seconds)
 {
   psleep(seconds);
-}
\ No newline at end of file
+}
+
+static void _ansi_text(void *context, const char *text, size_t length)
+{
+  _write(text, length);
+  _track(text, length);
+}
+
+static void _ansi_flush(void *context)
+{
+  _end_frame();
+  if (console_output == NULL)
+  {
+    const uint64_t started_at = profile_start();
+    fflush(stdout);
+    profile_stop(PROFILE_FLUSH, started_at);
+
+    /*
+     * stdio does the writes so they can't be counted, this is a guess: stdout is fully buffered
+     * (see CONSOLE_STDOUT_BUFFER), a write every time the buffer fills up. Anything printed with
+     * plain printf isn't in stdout_pending, so it can be off by a write or so.
+     */
+    profile_count(PROFILE_SYSCALLS, (stdout_pending + CONSOLE_STDOUT_BUFFER - 1) / CONSOLE_STDOUT_BUFFER);
+    stdout_pending = 0;
+    local_state.x = local_state.y = 0;
+  }
+}
+
+/* The terminal (or the buffer set with console_set_output), the context isn't used */
+const RenderBackend console_ansi_backend = {
+    "ansi", _ansi_clear, _ansi_move, _ansi_colors, _ansi_text, _ansi_flush};
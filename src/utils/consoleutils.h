@@ -1,8 +1,107 @@
 #ifndef CONSOLE_UTILS_H
 #define CONSOLE_UTILS_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include "../classes/buffer.h"
+#include "render.h"
+
+/*
+Size of stdout's buffer, main makes it fully buffered so a whole frame goes out in a single write
+(anything that waits for the user has to flush first)
+*/
+#define CONSOLE_STDOUT_BUFFER 65536
+
+/* Color value for the terminal's default color */
+#define CONSOLE_DEFAULT_COLOR 0xFFFF
+/* We don't know what's set on the terminal (nothing was set yet) */
+#define CONSOLE_UNKNOWN_COLOR 0xFFFE
+
+/*
+What we know about a terminal, so nothing gets sent twice and every escape
+is as short as it can be. Every output has its own (the local console, each server session).
+*/
+typedef struct
+{
+  /* Colors the terminal can show: 0, 16 or 256 (the rest get approximated) */
+  uint16_t colors;
+  /* Shortest escapes and no redundant colors, false sends the long forms every time (like before) */
+  bool compact;
+  /* Colors currently set, a color or CONSOLE_DEFAULT_COLOR/CONSOLE_UNKNOWN_COLOR */
+  uint16_t fg;
+  uint16_t bg;
+  /* Cursor position (from 1), 0 if we don't know where it is */
+  uint16_t x;
+  uint16_t y;
+  /* The terminal understands private modes (alternate screen, synchronized output, hiding the cursor) */
+  bool private_modes;
+  /* Output is sent in frames (see console_set_frames), and whether one is open right now */
+  bool frames;
+  bool in_frame;
+} ConsoleState;
+
+/* Nothing known about the terminal yet (private modes are assumed if it has colors) */
+void console_state_init(ConsoleState *state, uint16_t colors, bool compact);
+
+/*
+Looks at TERM and COLORTERM once to know how many colors the local console has,
+call it at startup (before that, 256 colors are assumed)
+*/
+void console_detect_capabilities();
+
+/*
+Everything printed through these functions goes to stdout, unless an output buffer
+is set (used by the server to draw every session into its own buffer), the buffer
+comes with the state of the terminal it goes to
+*/
+void console_set_output(Buffer *buffer, ConsoleState *state);
+Buffer *console_get_output();
+/*
+Render backend everything below draws with, the ANSI terminal (console_ansi_backend) by default.
+Another backend (see render.h) gets every console_print, console_gotoxy, color and clear_screen
+instead, NULL goes back to the terminal. Frames and the alternate screen only apply to the terminal.
+*/
+extern const RenderBackend console_ansi_backend;
+void console_set_backend(const RenderBackend *backend, void *context);
+/* The current backend, and its context if context isn't NULL */
+const RenderBackend *console_get_backend(void **context);
+
+/* printf, but to the current output */
+void console_print(const char *format, ...);
+/*
+Flushes stdout (buffers are sent by whoever owns them), the local cursor position is
+forgotten since anything may be printed with printf afterwards. Ends the current frame.
+*/
+void console_flush();
+
+/*
+Frames: everything printed between two flushes (or until the output changes) is wrapped in
+synchronized output markers (DEC mode 2026) with the cursor hidden, so the terminal shows it
+all at once instead of drawing half a board. Terminals without mode 2026 just ignore the markers.
+Applies to the current output.
+*/
+void console_set_frames(bool enabled);
+
+/* Switches the local console to the alternate screen (and back), if it has one */
+void console_alternate_screen(bool enabled);
+
+/* Leaves the local console the way it was found: no frame, cursor shown, main screen, default colors */
+void console_restore();
+
+/* Size of the local console in characters, returns false if it isn't a terminal */
+bool console_get_size(uint16_t *columns, uint16_t *rows);
+
+/*
+Starts watching for resizes (SIGWINCH writes to a self-pipe, so event loops can wait on
+console_resize_fd next to their input), call it once at startup
+*/
+void console_watch_resize();
+/* File descriptor that turns readable when the console is resized, -1 if there's none (Windows) */
+int console_resize_fd();
+/* Whether the console was resized since the last call (Windows checks the size instead) */
+bool console_resized();
+
 void console_gotoxy(uint16_t x, uint16_t y);
 void console_pos_reset();
 
@@ -31,6 +130,8 @@ Functions for added type checking and just ease of use
 */
 void console_foreground_set(uint8_t color);
 void console_background_set(uint8_t color);
+/* Both at once (one escape), any of them can be CONSOLE_DEFAULT_COLOR */
+void console_colors_set(uint16_t fg, uint16_t bg);
 void console_foreground_reset();
 void console_background_reset();
 void console_color_reset();
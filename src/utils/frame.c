@@ -0,0 +1,146 @@
+#include <stdlib.h>
+
+#include "frame.h"
+#include "consoleutils.h"
+
+static bool _cell_equals(FrameCell a, FrameCell b)
+{
+  return a.glyph == b.glyph && a.glyph_fg == b.glyph_fg && a.glyph_bg == b.glyph_bg &&
+         a.bracket_fg == b.bracket_fg && a.bracket_bg == b.bracket_bg;
+}
+
+static void _mark_dirty(Frame *frame, uint32_t index)
+{
+  if (frame->is_dirty[index])
+    return;
+  frame->is_dirty[index] = true;
+  frame->dirty[frame->dirty_count++] = index;
+}
+
+bool frame_init(Frame *frame, uint16_t width, uint16_t height, Arena *arena)
+{
+  const uint32_t total = (uint32_t)width * height;
+
+  frame->width = width;
+  frame->height = height;
+  frame->view_x = 0;
+  frame->view_y = 0;
+  frame->view_width = width;
+  frame->view_height = height;
+  frame->dirty_count = 0;
+  frame->wanted = arena_calloc(arena, total, sizeof(FrameCell));
+  frame->shown = arena_calloc(arena, total, sizeof(FrameCell));
+  frame->dirty = arena_alloc(arena, sizeof(uint32_t) * total);
+  frame->is_dirty = arena_calloc(arena, total, sizeof(bool));
+  if (frame->wanted == NULL || frame->shown == NULL || frame->dirty == NULL || frame->is_dirty == NULL)
+    return false;
+
+  /* Nothing's on screen yet */
+  frame_invalidate(frame);
+  return true;
+}
+
+void frame_set(Frame *frame, uint16_t x, uint16_t y, FrameCell cell)
+{
+  uint32_t index = (uint32_t)y * frame->width + x;
+  frame->wanted[index] = cell;
+  _mark_dirty(frame, index);
+}
+
+FrameCell frame_get(const Frame *frame, uint16_t x, uint16_t y)
+{
+  return frame->wanted[(uint32_t)y * frame->width + x];
+}
+
+void frame_invalidate(Frame *frame)
+{
+  const uint32_t total = (uint32_t)frame->width * frame->height;
+
+  /* A glyph no cell ever has, so every cell differs */
+  for (uint32_t index = 0; index < total; index++)
+  {
+    frame->shown[index].glyph = '\0';
+    _mark_dirty(frame, index);
+  }
+}
+
+static bool _in_view(uint16_t x, uint16_t y, uint16_t view_x, uint16_t view_y, uint16_t view_width, uint16_t view_height)
+{
+  return x >= view_x && x < view_x + view_width && y >= view_y && y < view_y + view_height;
+}
+
+void frame_set_view(Frame *frame, uint16_t x, uint16_t y, uint16_t width, uint16_t height)
+{
+  /* At least a cell, and never past the board */
+  width = (width < 1) ? 1 : (width > frame->width) ? frame->width : width;
+  height = (height < 1) ? 1 : (height > frame->height) ? frame->height : height;
+  x = (x > frame->width - width) ? frame->width - width : x;
+  y = (y > frame->height - height) ? frame->height - height : y;
+
+  const uint16_t old_x = frame->view_x, old_y = frame->view_y;
+  const uint16_t old_width = frame->view_width, old_height = frame->view_height;
+
+  frame->view_x = x;
+  frame->view_y = y;
+  frame->view_width = width;
+  frame->view_height = height;
+
+  /* Every cell on screen moved */
+  if (x != old_x || y != old_y)
+  {
+    frame_invalidate(frame);
+    return;
+  }
+
+  /* Same corner, only the cells that went in or out of the view matter */
+  const uint16_t max_width = (width > old_width) ? width : old_width;
+  const uint16_t max_height = (height > old_height) ? height : old_height;
+  for (uint16_t i = y; i < y + max_height; i++)
+    for (uint16_t j = x; j < x + max_width; j++)
+    {
+      bool was_visible = _in_view(j, i, old_x, old_y, old_width, old_height);
+      bool is_visible = _in_view(j, i, x, y, width, height);
+      if (was_visible == is_visible)
+        continue;
+
+      /* Not on screen anymore (or not yet), it has to be drawn when it shows up */
+      uint32_t index = (uint32_t)i * frame->width + j;
+      frame->shown[index].glyph = '\0';
+      if (is_visible)
+        _mark_dirty(frame, index);
+    }
+}
+
+uint32_t frame_present(Frame *frame)
+{
+  uint32_t drawn = 0;
+
+  for (uint32_t i = 0; i < frame->dirty_count; i++)
+  {
+    uint32_t index = frame->dirty[i];
+    uint16_t x = index % frame->width, y = index / frame->width;
+    frame->is_dirty[index] = false;
+
+    /* Cells off screen get drawn when the view reaches them (see frame_set_view) */
+    FrameCell cell = frame->wanted[index];
+    if (!_in_view(x, y, frame->view_x, frame->view_y, frame->view_width, frame->view_height) ||
+        _cell_equals(cell, frame->shown[index]))
+      continue;
+
+    console_gotoxy((x - frame->view_x) * 3 + 1, y - frame->view_y + 1);
+    console_colors_set(cell.bracket_fg, cell.bracket_bg);
+    console_print("[");
+    console_colors_set(cell.glyph_fg, cell.glyph_bg);
+    console_print("%c", cell.glyph);
+    console_colors_set(cell.bracket_fg, cell.bracket_bg);
+    console_print("]");
+
+    frame->shown[index] = cell;
+    drawn++;
+  }
+
+  if (drawn > 0)
+    console_color_reset();
+  frame->dirty_count = 0;
+  return drawn;
+}
@@ -0,0 +1,72 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "consoleutils.h"
+#include "../classes/arena.h"
+
+/* Use the console's default color */
+#define FRAME_DEFAULT_COLOR CONSOLE_DEFAULT_COLOR
+
+/*
+ * What a board cell looks like on screen: '[', the glyph and ']',
+ * the brackets and the glyph have their own colors
+ */
+typedef struct
+{
+  char glyph;
+  uint16_t glyph_fg;
+  uint16_t glyph_bg;
+  uint16_t bracket_fg;
+  uint16_t bracket_bg;
+} FrameCell;
+
+/*
+ * Frame buffer for the board, it remembers what every cell looks like on screen
+ * and what it should look like, frame_present only emits the cells that differ.
+ *
+ * Only the cells inside the view (the part of the board that fits on the terminal) are drawn,
+ * cell (x, y) goes at console position ((x - view_x) * 3 + 1, y - view_y + 1).
+ */
+typedef struct
+{
+  uint16_t width;
+  uint16_t height;
+  /* Top left cell on screen, and how many cells fit */
+  uint16_t view_x;
+  uint16_t view_y;
+  uint16_t view_width;
+  uint16_t view_height;
+  /* What every cell should look like */
+  FrameCell *wanted;
+  /* What every cell looks like on screen right now */
+  FrameCell *shown;
+  /* Cells set since the last frame_present (each one only once) */
+  uint32_t *dirty;
+  uint32_t dirty_count;
+  bool *is_dirty;
+} Frame;
+
+/* The buffers come from the arena (and go away with it), returns false if memory couldn't be allocated */
+bool frame_init(Frame *frame, uint16_t width, uint16_t height, Arena *arena);
+
+/* Sets what the cell should look like (nothing is drawn until frame_present) */
+void frame_set(Frame *frame, uint16_t x, uint16_t y, FrameCell cell);
+FrameCell frame_get(const Frame *frame, uint16_t x, uint16_t y);
+
+/* The screen was cleared, the next frame_present redraws every cell */
+void frame_invalidate(Frame *frame);
+
+/**
+ * frame_set_view
+ * Moves or resizes the view (clamped to the board). Moving it redraws every cell on the
+ * next frame_present, resizing it only draws the cells that weren't on screen before.
+ */
+void frame_set_view(Frame *frame, uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+
+/* Draws the cells that changed on the current console output, returns how many */
+uint32_t frame_present(Frame *frame);
+
+#endif /* FRAME_H */
@@ -5,18 +5,42 @@
 
 #ifdef _WIN32
 #include <conio.h>
+#include <windows.h>
 
 #elif defined(__unix__) || defined(__APPLE__) || defined(__linux__)
 #include <termios.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
 #include <sys/select.h>
 
+#include "consoleutils.h"
+#include "input.h"
+
 static struct termios oldt, newt;
+static bool term_saved = false;
+
+/* Ctrl+C (or being killed) shouldn't leave the terminal raw and on the alternate screen */
+static void _restore_and_die(int sig)
+{
+  reset_term();
+  signal(sig, SIG_DFL);
+  raise(sig);
+}
 
 void init_term(void)
 {
-  tcgetattr(STDIN_FILENO, &oldt);
+  /* Only the terminal we found at the start is worth going back to */
+  if (!term_saved)
+  {
+    tcgetattr(STDIN_FILENO, &oldt);
+    term_saved = true;
+
+    signal(SIGINT, _restore_and_die);
+    signal(SIGTERM, _restore_and_die);
+    signal(SIGHUP, _restore_and_die);
+  }
   newt = oldt;
   newt.c_lflag &= ~(ICANON | ECHO);
   tcsetattr(STDIN_FILENO, TCSANOW, &newt);
@@ -24,7 +48,16 @@ void init_term(void)
 
 void reset_term(void)
 {
-  tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
+  console_restore();
+  if (term_saved)
+    tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
+}
+
+/* Lines with echo (for read_int) or single keys */
+static void _line_mode(bool enabled)
+{
+  if (term_saved)
+    tcsetattr(STDIN_FILENO, TCSANOW, enabled ? &oldt : &newt);
 }
 
 int kbhit(void)
@@ -122,6 +155,86 @@ vkey_t get_key(void)
   return VK_NONE;
 }
 
+bool wait_key(int32_t timeout_ms)
+{
+#ifdef _WIN32
+  HANDLE console = GetStdHandle(STD_INPUT_HANDLE);
+  DWORD start = GetTickCount();
+  while (!_kbhit())
+  {
+    DWORD waited = GetTickCount() - start;
+    if (timeout_ms >= 0 && waited >= (DWORD)timeout_ms)
+      return false;
+    /* The console also wakes us up for events that aren't keys (focus, mouse...), _kbhit drops them */
+    if (WaitForSingleObject(console, timeout_ms < 0 ? INFINITE : (DWORD)timeout_ms - waited) != WAIT_OBJECT_0)
+      return false;
+  }
+  return true;
+#else
+  fd_set fds;
+  FD_ZERO(&fds);
+  FD_SET(STDIN_FILENO, &fds);
+
+  /* Resizes wake us up too (see console_watch_resize) */
+  int resize_fd = console_resize_fd();
+  if (resize_fd >= 0)
+    FD_SET(resize_fd, &fds);
+  int max_fd = (resize_fd > STDIN_FILENO) ? resize_fd : STDIN_FILENO;
+
+  struct timeval tv = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+  return select(max_fd + 1, &fds, NULL, NULL, timeout_ms < 0 ? NULL : &tv) > 0 && FD_ISSET(STDIN_FILENO, &fds);
+#endif
+}
+
+vkey_t decode_key(const unsigned char *bytes, size_t length, size_t *consumed)
+{
+  *consumed = 0;
+  if (length == 0)
+    return VK_NONE;
+
+  /* ESC or Escape sequences */
+  if (bytes[0] == 27)
+  {
+    if (length == 1)
+    {
+      *consumed = 1;
+      return VK_ESCAPE; // Single ESC press
+    }
+    if (bytes[1] != '[')
+    {
+      *consumed = 2;
+      return VK_NONE;
+    }
+    /* Wait for the rest of the sequence */
+    if (length < 3)
+      return VK_NONE;
+
+    *consumed = 3;
+    switch (bytes[2])
+    {
+    case 'A':
+      return VK_UP;
+    case 'B':
+      return VK_DOWN;
+    case 'C':
+      return VK_RIGHT;
+    case 'D':
+      return VK_LEFT;
+    }
+    return VK_NONE;
+  }
+
+  /* Raw terminals send \r (or \r\n) for enter */
+  if (bytes[0] == '\r')
+  {
+    *consumed = (length > 1 && bytes[1] == '\n') ? 2 : 1;
+    return VK_ENTER;
+  }
+
+  *consumed = 1;
+  return (vkey_t)bytes[0];
+}
+
 #define INPUT_ERROR_MSG "Input error!\n"
 #define INT_ERROR_MSG "Invalid number, try again.\n"
 
@@ -129,8 +242,9 @@ vkey_t get_key(void)
 int32_t read_int(const char *prompt)
 {
 #ifndef _WIN32
-  // Switch to canonical mode if not already
-  reset_term();
+  // Switch to canonical mode if not already (and finish whatever frame was being drawn)
+  console_flush();
+  _line_mode(true);
 #endif
   char line[100];
   int value;
@@ -138,12 +252,14 @@ int32_t read_int(const char *prompt)
   while (1)
   {
     printf("%s", prompt);
+    fflush(stdout);
     if (!fgets(line, sizeof(line), stdin))
     {
       printf(INPUT_ERROR_MSG);
+      fflush(stdout);
 #ifndef _WIN32
       /* Activate terminal mode again */
-      init_term();
+      _line_mode(false);
 #endif
       return INT32_MIN;
     }
@@ -152,7 +268,7 @@ int32_t read_int(const char *prompt)
     {
 #ifndef _WIN32
       /* Activate terminal mode again */
-      init_term();
+      _line_mode(false);
 #endif
       return value;
     }
@@ -161,6 +277,6 @@ int32_t read_int(const char *prompt)
   }
 #ifndef _WIN32
   /* Activate terminal mode again */
-  init_term();
+  _line_mode(false);
 #endif
 }
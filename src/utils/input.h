@@ -1,6 +1,8 @@
 #ifndef GETCH_H
 #define GETCH_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /* --- Key Enum --- */
@@ -31,6 +33,18 @@ int getch(void);
 
 vkey_t get_key(void);
 
+/*
+ * Sleeps until there's a key to read (true), the console is resized or timeout_ms passes (false),
+ * a negative timeout waits forever. Check console_resized afterwards.
+ */
+bool wait_key(int32_t timeout_ms);
+
+/*
+ * Same keys as get_key, but read from a chunk of bytes (for input that doesn't come from this console).
+ * `consumed` is set to the bytes used, 0 if the chunk ends in the middle of an escape sequence.
+ */
+vkey_t decode_key(const unsigned char *bytes, size_t length, size_t *consumed);
+
 int32_t read_int(const char *prompt);
 
 #endif /* GETCH_H */
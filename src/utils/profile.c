@@ -0,0 +1,137 @@
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "profile.h"
+#include "timer.h"
+
+typedef struct
+{
+  atomic_uint_fast64_t count;
+  atomic_uint_fast64_t total_us;
+  atomic_uint_fast64_t max_us;
+  atomic_uint_fast64_t last_us;
+  /* Ring of the recent measurements */
+  atomic_uint_fast32_t samples[PROFILE_SAMPLES];
+  atomic_uint next_sample;
+} SpanData;
+
+static SpanData spans[PROFILE_SPAN_COUNT];
+static atomic_uint_fast64_t counters[PROFILE_COUNTER_COUNT];
+
+static const char *span_names[PROFILE_SPAN_COUNT] = {"generate", "solver", "reveal", "render", "flush", "frame", "latency"};
+static const char *counter_names[PROFILE_COUNTER_COUNT] = {"bytes", "syscalls", "frames", "keys"};
+
+/* The frame in progress, and what the last one took */
+static uint64_t frame_started_at = 0;
+static uint64_t frame_bytes_at = 0, frame_syscalls_at = 0;
+static uint64_t last_frame_bytes = 0, last_frame_syscalls = 0;
+
+uint64_t profile_start(void)
+{
+  return timer_now_us();
+}
+
+void profile_stop(ProfileSpan span, uint64_t started_at)
+{
+  profile_record(span, timer_now_us() - started_at);
+}
+
+void profile_record(ProfileSpan span, uint64_t us)
+{
+  SpanData *data = &spans[span];
+
+  atomic_fetch_add_explicit(&data->count, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&data->total_us, us, memory_order_relaxed);
+  atomic_store_explicit(&data->last_us, us, memory_order_relaxed);
+
+  uint64_t max = atomic_load_explicit(&data->max_us, memory_order_relaxed);
+  while (us > max && !atomic_compare_exchange_weak_explicit(&data->max_us, &max, us, memory_order_relaxed, memory_order_relaxed))
+    ;
+
+  uint32_t slot = atomic_fetch_add_explicit(&data->next_sample, 1, memory_order_relaxed) % PROFILE_SAMPLES;
+  atomic_store_explicit(&data->samples[slot], (us > UINT32_MAX) ? UINT32_MAX : us, memory_order_relaxed);
+}
+
+static int _compare_samples(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+void profile_stats(ProfileSpan span, ProfileStats *stats)
+{
+  SpanData *data = &spans[span];
+
+  stats->count = atomic_load_explicit(&data->count, memory_order_relaxed);
+  stats->total_us = atomic_load_explicit(&data->total_us, memory_order_relaxed);
+  stats->max_us = atomic_load_explicit(&data->max_us, memory_order_relaxed);
+  stats->last_us = atomic_load_explicit(&data->last_us, memory_order_relaxed);
+  stats->p99_us = 0;
+
+  uint32_t sample_count = (stats->count < PROFILE_SAMPLES) ? stats->count : PROFILE_SAMPLES;
+  if (sample_count == 0)
+    return;
+
+  uint32_t samples[PROFILE_SAMPLES];
+  for (uint32_t i = 0; i < sample_count; i++)
+    samples[i] = atomic_load_explicit(&data->samples[i], memory_order_relaxed);
+  qsort(samples, sample_count, sizeof(uint32_t), _compare_samples);
+  stats->p99_us = samples[(sample_count * 99 - 1) / 100];
+}
+
+void profile_count(ProfileCounter counter, uint64_t amount)
+{
+  atomic_fetch_add_explicit(&counters[counter], amount, memory_order_relaxed);
+}
+
+uint64_t profile_counter(ProfileCounter counter)
+{
+  return atomic_load_explicit(&counters[counter], memory_order_relaxed);
+}
+
+void profile_frame_begin(void)
+{
+  frame_started_at = timer_now_us();
+  frame_bytes_at = profile_counter(PROFILE_BYTES);
+  frame_syscalls_at = profile_counter(PROFILE_SYSCALLS);
+}
+
+void profile_frame_end(void)
+{
+  profile_stop(PROFILE_FRAME, frame_started_at);
+  profile_count(PROFILE_FRAMES, 1);
+  last_frame_bytes = profile_counter(PROFILE_BYTES) - frame_bytes_at;
+  last_frame_syscalls = profile_counter(PROFILE_SYSCALLS) - frame_syscalls_at;
+}
+
+void profile_last_frame(uint64_t *bytes, uint64_t *syscalls)
+{
+  *bytes = last_frame_bytes;
+  *syscalls = last_frame_syscalls;
+}
+
+bool profile_dump_json(FILE *file)
+{
+  fprintf(file, "{\n  \"spans\": {\n");
+  for (int32_t i = 0; i < PROFILE_SPAN_COUNT; i++)
+  {
+    ProfileStats stats;
+    profile_stats(i, &stats);
+    fprintf(file, "    \"%s\": {\"count\": %llu, \"total_us\": %llu, \"mean_us\": %.1f, \"max_us\": %llu, \"p99_us\": %llu}%s\n",
+            span_names[i], (unsigned long long)stats.count, (unsigned long long)stats.total_us,
+            stats.count ? (double)stats.total_us / stats.count : 0.0, (unsigned long long)stats.max_us,
+            (unsigned long long)stats.p99_us, (i + 1 < PROFILE_SPAN_COUNT) ? "," : "");
+  }
+
+  fprintf(file, "  },\n  \"counters\": {\n");
+  for (int32_t i = 0; i < PROFILE_COUNTER_COUNT; i++)
+    fprintf(file, "    \"%s\": %llu%s\n", counter_names[i], (unsigned long long)profile_counter(i),
+            (i + 1 < PROFILE_COUNTER_COUNT) ? "," : "");
+
+  /* Per frame averages, what the overlay shows for the last frame only */
+  uint64_t frames = profile_counter(PROFILE_FRAMES);
+  fprintf(file, "  },\n  \"per_frame\": {\"bytes\": %.1f, \"syscalls\": %.2f}\n}\n",
+          frames ? (double)profile_counter(PROFILE_BYTES) / frames : 0.0,
+          frames ? (double)profile_counter(PROFILE_SYSCALLS) / frames : 0.0);
+  return !ferror(file);
+}
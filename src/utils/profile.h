@@ -0,0 +1,80 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Built-in instrumentation: timing spans around the hot paths and a few counters.
+ * Everything is global and lock-free (the generator's workers time the solver too),
+ * spans keep their last PROFILE_SAMPLES measurements to get the p99 from.
+ */
+
+/* Measurements kept per span for the p99 */
+#define PROFILE_SAMPLES 128
+
+typedef enum
+{
+  /* A whole board generation (every attempt included) */
+  PROFILE_GENERATE,
+  /* A single solver_analyze */
+  PROFILE_SOLVER,
+  /* A click, flood reveal included */
+  PROFILE_REVEAL,
+  /* Presenting the frame buffer */
+  PROFILE_RENDER,
+  /* Sending the local console's output to the terminal */
+  PROFILE_FLUSH,
+  /* Everything the game loop did after waking up, until its output was flushed */
+  PROFILE_FRAME,
+  /* Input to photon: from reading the key until what it drew was flushed */
+  PROFILE_LATENCY,
+  PROFILE_SPAN_COUNT
+} ProfileSpan;
+
+typedef enum
+{
+  /* Bytes sent to every console (the local one and server sessions) */
+  PROFILE_BYTES,
+  /*
+   * write/send calls the output took: counted on every send for server sessions, only estimated
+   * for the local console (stdio does its writes, see _ansi_flush in consoleutils.c)
+   */
+  PROFILE_SYSCALLS,
+  PROFILE_FRAMES,
+  PROFILE_KEYS,
+  PROFILE_COUNTER_COUNT
+} ProfileCounter;
+
+typedef struct
+{
+  uint64_t count;
+  uint64_t total_us;
+  uint64_t max_us;
+  /* The latest measurement, and the p99 of the recent ones */
+  uint64_t last_us;
+  uint64_t p99_us;
+} ProfileStats;
+
+/* Start of a span, pass it to profile_stop */
+uint64_t profile_start(void);
+void profile_stop(ProfileSpan span, uint64_t started_at);
+void profile_record(ProfileSpan span, uint64_t us);
+void profile_stats(ProfileSpan span, ProfileStats *stats);
+
+void profile_count(ProfileCounter counter, uint64_t amount);
+uint64_t profile_counter(ProfileCounter counter);
+
+/*
+ * A frame of the game loop, frames are timed as PROFILE_FRAME and remember
+ * the bytes and syscalls they took (only one frame at a time, from the game loop's thread)
+ */
+void profile_frame_begin(void);
+void profile_frame_end(void);
+void profile_last_frame(uint64_t *bytes, uint64_t *syscalls);
+
+/* Every span and counter as a JSON object, returns false if the file couldn't be written */
+bool profile_dump_json(FILE *file);
+
+#endif /* PROFILE_H */
@@ -0,0 +1,197 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "render.h"
+#include "consoleutils.h"
+
+/*
+NULL BACKEND
+*/
+
+static void _null_clear(void *context)
+{
+  ((RenderCounts *)context)->clears++;
+}
+
+static void _null_move(void *context, uint16_t x, uint16_t y)
+{
+  ((RenderCounts *)context)->moves++;
+}
+
+static void _null_colors(void *context, uint16_t fg, uint16_t bg, bool set_fg, bool set_bg)
+{
+  ((RenderCounts *)context)->colors++;
+}
+
+static void _null_text(void *context, const char *text, size_t length)
+{
+  RenderCounts *counts = context;
+  counts->texts++;
+  counts->bytes += length;
+}
+
+static void _null_flush(void *context)
+{
+  ((RenderCounts *)context)->flushes++;
+}
+
+const RenderBackend render_null_backend = {
+    "null", _null_clear, _null_move, _null_colors, _null_text, _null_flush};
+
+/*
+SNAPSHOT BACKEND
+*/
+
+bool render_screen_init(RenderScreen *screen, uint16_t width, uint16_t height)
+{
+  screen->width = width;
+  screen->height = height;
+  screen->cells = malloc(sizeof(RenderScreenCell) * width * height);
+  if (screen->cells == NULL)
+    return false;
+
+  screen->fg = screen->bg = CONSOLE_DEFAULT_COLOR;
+  render_screen_backend.clear(screen);
+  return true;
+}
+
+void render_screen_free(RenderScreen *screen)
+{
+  free(screen->cells);
+  screen->cells = NULL;
+}
+
+static void _screen_clear(void *context)
+{
+  RenderScreen *screen = context;
+  RenderScreenCell blank = {' ', screen->fg, screen->bg};
+
+  for (uint32_t i = 0; i < (uint32_t)screen->width * screen->height; i++)
+    screen->cells[i] = blank;
+  screen->x = screen->y = 0;
+}
+
+static void _screen_move(void *context, uint16_t x, uint16_t y)
+{
+  RenderScreen *screen = context;
+  screen->x = x - 1;
+  screen->y = y - 1;
+}
+
+static void _screen_colors(void *context, uint16_t fg, uint16_t bg, bool set_fg, bool set_bg)
+{
+  RenderScreen *screen = context;
+  if (set_fg)
+    screen->fg = fg;
+  if (set_bg)
+    screen->bg = bg;
+}
+
+static void _screen_text(void *context, const char *text, size_t length)
+{
+  RenderScreen *screen = context;
+
+  for (size_t i = 0; i < length; i++)
+  {
+    if (text[i] == '\r')
+      screen->x = 0;
+    else if (text[i] == '\n')
+    {
+      screen->x = 0;
+      screen->y++;
+    }
+    else
+    {
+      if (screen->x < screen->width && screen->y < screen->height)
+      {
+        RenderScreenCell cell = {text[i], screen->fg, screen->bg};
+        screen->cells[(uint32_t)screen->y * screen->width + screen->x] = cell;
+      }
+      screen->x++;
+    }
+  }
+}
+
+static void _screen_flush(void *context)
+{
+}
+
+const RenderBackend render_screen_backend = {
+    "snapshot", _screen_clear, _screen_move, _screen_colors, _screen_text, _screen_flush};
+
+bool render_screen_write_text(const RenderScreen *screen, FILE *file)
+{
+  for (uint16_t i = 0; i < screen->height; i++)
+  {
+    const RenderScreenCell *row = &screen->cells[(uint32_t)i * screen->width];
+
+    uint16_t length = screen->width;
+    while (length > 0 && row[length - 1].glyph == ' ')
+      length--;
+
+    for (uint16_t j = 0; j < length; j++)
+      fputc(row[j].glyph, file);
+    fputc('\n', file);
+  }
+  return !ferror(file);
+}
+
+/* Pixels every character takes on the PPM, and where its glyph goes inside */
+#define CELL_WIDTH 6
+#define CELL_HEIGHT 12
+#define GLYPH_LEFT 1
+#define GLYPH_RIGHT 5
+#define GLYPH_TOP 3
+#define GLYPH_BOTTOM 10
+
+/* RGB for one of the 256 colors, the xterm palette */
+static void _color_rgb(uint16_t color, bool background, uint8_t rgb[3])
+{
+  static const uint8_t basic[16][3] = {
+      {0, 0, 0}, {205, 0, 0}, {0, 205, 0}, {205, 205, 0}, {0, 0, 238}, {205, 0, 205}, {0, 205, 205}, {229, 229, 229}, {127, 127, 127}, {255, 0, 0}, {0, 255, 0}, {255, 255, 0}, {92, 92, 255}, {255, 0, 255}, {0, 255, 255}, {255, 255, 255}};
+  static const uint8_t levels[6] = {0, 95, 135, 175, 215, 255};
+
+  /* Light gray on black, like most terminals */
+  if (color == CONSOLE_DEFAULT_COLOR || color == CONSOLE_UNKNOWN_COLOR)
+    color = background ? 0 : 7;
+
+  if (color < 16)
+    memcpy(rgb, basic[color], 3);
+  else if (color < 232)
+  {
+    rgb[0] = levels[(color - 16) / 36];
+    rgb[1] = levels[((color - 16) / 6) % 6];
+    rgb[2] = levels[(color - 16) % 6];
+  }
+  else
+    rgb[0] = rgb[1] = rgb[2] = 8 + (color - 232) * 10;
+}
+
+bool render_screen_write_ppm(const RenderScreen *screen, FILE *file)
+{
+  /* A row of pixels at a time, screens can be as wide as the terminal */
+  const size_t line_size = (size_t)screen->width * CELL_WIDTH * 3;
+  uint8_t *line = malloc(line_size);
+  if (line == NULL)
+    return false;
+
+  fprintf(file, "P6\n%d %d\n255\n", screen->width * CELL_WIDTH, screen->height * CELL_HEIGHT);
+  for (uint32_t y = 0; y < (uint32_t)screen->height * CELL_HEIGHT; y++)
+  {
+    const RenderScreenCell *row = &screen->cells[(y / CELL_HEIGHT) * screen->width];
+    const uint32_t cell_y = y % CELL_HEIGHT;
+
+    for (uint32_t x = 0; x < (uint32_t)screen->width * CELL_WIDTH; x++)
+    {
+      const RenderScreenCell *cell = &row[x / CELL_WIDTH];
+      const uint32_t cell_x = x % CELL_WIDTH;
+      bool on_glyph = cell->glyph != ' ' && cell_x >= GLYPH_LEFT && cell_x < GLYPH_RIGHT &&
+                      cell_y >= GLYPH_TOP && cell_y < GLYPH_BOTTOM;
+
+      _color_rgb(on_glyph ? cell->fg : cell->bg, !on_glyph, &line[x * 3]);
+    }
+    fwrite(line, 1, line_size, file);
+  }
+  free(line);
+  return !ferror(file);
+}
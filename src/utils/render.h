@@ -0,0 +1,82 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+Where the console functions (console_print, console_gotoxy, the colors, clear_screen...) end up.
+The ANSI terminal is the default one (see consoleutils.c), console_set_backend swaps it for any other.
+Colors are the same values the console functions take (CONSOLE_DEFAULT_COLOR included), positions start from 1.
+*/
+typedef struct
+{
+  const char *name;
+  void (*clear)(void *context);
+  void (*move)(void *context, uint16_t x, uint16_t y);
+  /* Only the colors with their set_ flag on change */
+  void (*colors)(void *context, uint16_t fg, uint16_t bg, bool set_fg, bool set_bg);
+  void (*text)(void *context, const char *text, size_t length);
+  void (*flush)(void *context);
+} RenderBackend;
+
+/*
+Null backend: nothing is drawn, every operation is just counted.
+Lets benchmarks and headless simulations run the whole game without paying for any output.
+*/
+typedef struct
+{
+  uint64_t clears;
+  uint64_t moves;
+  uint64_t colors;
+  uint64_t texts;
+  /* Characters the texts had */
+  uint64_t bytes;
+  uint64_t flushes;
+} RenderCounts;
+
+/* Its context is a RenderCounts (zero it before using it) */
+extern const RenderBackend render_null_backend;
+
+/*
+Snapshot backend: draws on a screen in memory, which can then be written
+as plain text or as a PPM image (for debugging and snapshots)
+*/
+typedef struct
+{
+  char glyph;
+  uint16_t fg;
+  uint16_t bg;
+} RenderScreenCell;
+
+typedef struct
+{
+  uint16_t width;
+  uint16_t height;
+  RenderScreenCell *cells;
+  /* Cursor (from 0) and the colors being drawn with */
+  uint16_t x;
+  uint16_t y;
+  uint16_t fg;
+  uint16_t bg;
+} RenderScreen;
+
+/* Its context is a RenderScreen, whatever's drawn outside of it is dropped */
+extern const RenderBackend render_screen_backend;
+
+/* Returns false if memory couldn't be allocated */
+bool render_screen_init(RenderScreen *screen, uint16_t width, uint16_t height);
+void render_screen_free(RenderScreen *screen);
+
+/* Every row (trailing spaces trimmed), returns false if the file couldn't be written */
+bool render_screen_write_text(const RenderScreen *screen, FILE *file);
+/*
+Binary PPM, every character is a block of pixels with its background color
+and the glyph as a smaller block of the foreground color (spaces are just background),
+false if it couldn't be written or there was no memory for a row
+*/
+bool render_screen_write_ppm(const RenderScreen *screen, FILE *file);
+
+#endif /* RENDER_H */
@@ -0,0 +1,75 @@
+#include "threads.h"
+
+#ifdef _WIN32
+
+static DWORD WINAPI _trampoline(LPVOID param)
+{
+  Thread *thread = param;
+  thread->func(thread->arg);
+  return 0;
+}
+
+bool thread_start(Thread *thread, void (*func)(void *arg), void *arg)
+{
+  thread->func = func;
+  thread->arg = arg;
+  thread->handle = CreateThread(NULL, 0, _trampoline, thread, 0, NULL);
+  return thread->handle != NULL;
+}
+
+void thread_join(Thread *thread)
+{
+  WaitForSingleObject(thread->handle, INFINITE);
+  CloseHandle(thread->handle);
+}
+
+uint32_t thread_cpu_count(void)
+{
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+
+void thread_yield(void)
+{
+  SwitchToThread();
+}
+
+#elif defined(__unix__) || defined(__APPLE__) || defined(__linux__)
+
+#include <sched.h>
+#include <unistd.h>
+
+static void *_trampoline(void *param)
+{
+  Thread *thread = param;
+  thread->func(thread->arg);
+  return NULL;
+}
+
+bool thread_start(Thread *thread, void (*func)(void *arg), void *arg)
+{
+  thread->func = func;
+  thread->arg = arg;
+  return pthread_create(&thread->handle, NULL, _trampoline, thread) == 0;
+}
+
+void thread_join(Thread *thread)
+{
+  pthread_join(thread->handle, NULL);
+}
+
+uint32_t thread_cpu_count(void)
+{
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (uint32_t)count : 1;
+}
+
+void thread_yield(void)
+{
+  sched_yield();
+}
+
+#else
+#error This target cannot be compiled. Please add definitions for your current build system.
+#endif
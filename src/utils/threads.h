@@ -0,0 +1,36 @@
+#ifndef THREADS_H
+#define THREADS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Tiny portable thread wrapper, just enough to start workers and wait for them.
+ * The Thread struct must stay alive until thread_join returns.
+ */
+#ifdef _WIN32
+#include <windows.h>
+typedef HANDLE ThreadHandle;
+#else
+#include <pthread.h>
+typedef pthread_t ThreadHandle;
+#endif
+
+typedef struct
+{
+  ThreadHandle handle;
+  void (*func)(void *arg);
+  void *arg;
+} Thread;
+
+/* Returns false if the thread couldn't be created */
+bool thread_start(Thread *thread, void (*func)(void *arg), void *arg);
+void thread_join(Thread *thread);
+
+/* Amount of CPUs available (at least 1) */
+uint32_t thread_cpu_count(void);
+
+/* Lets another thread run, for workers waiting on the others */
+void thread_yield(void);
+
+#endif /* THREADS_H */
@@ -0,0 +1,208 @@
+#include <stdlib.h>
+
+#include "timer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+
+uint64_t timer_now_ms(void)
+{
+  static LARGE_INTEGER frequency = {0};
+  LARGE_INTEGER counter;
+
+  if (frequency.QuadPart == 0)
+    QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (uint64_t)(counter.QuadPart / (frequency.QuadPart / 1000));
+}
+
+uint64_t timer_now_us(void)
+{
+  static LARGE_INTEGER frequency = {0};
+  LARGE_INTEGER counter;
+
+  if (frequency.QuadPart == 0)
+    QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (uint64_t)(counter.QuadPart / (frequency.QuadPart / 1000000.0));
+}
+
+#elif defined(__unix__) || defined(__APPLE__) || defined(__linux__)
+#include <time.h>
+
+uint64_t timer_now_ms(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+uint64_t timer_now_us(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+#else
+#error This target cannot be compiled. Please add definitions for your current build system.
+#endif
+
+void stopwatch_start(Stopwatch *stopwatch)
+{
+  stopwatch->started_at = timer_now_ms();
+  stopwatch->accumulated = 0;
+  stopwatch->paused = false;
+}
+
+void stopwatch_pause(Stopwatch *stopwatch)
+{
+  if (stopwatch->paused)
+    return;
+  stopwatch->accumulated += timer_now_ms() - stopwatch->started_at;
+  stopwatch->paused = true;
+}
+
+void stopwatch_resume(Stopwatch *stopwatch)
+{
+  if (!stopwatch->paused)
+    return;
+  stopwatch->started_at = timer_now_ms();
+  stopwatch->paused = false;
+}
+
+uint64_t stopwatch_ms(const Stopwatch *stopwatch)
+{
+  if (stopwatch->paused)
+    return stopwatch->accumulated;
+  return stopwatch->accumulated + (timer_now_ms() - stopwatch->started_at);
+}
+
+/* Heap helpers, the earliest deadline is always heap[0] */
+static void _swap(Deadline *a, Deadline *b)
+{
+  Deadline temp = *a;
+  *a = *b;
+  *b = temp;
+}
+
+static void _sift_up(Scheduler *scheduler, uint32_t index)
+{
+  while (index > 0)
+  {
+    uint32_t parent = (index - 1) / 2;
+    if (scheduler->heap[parent].at <= scheduler->heap[index].at)
+      return;
+    _swap(&scheduler->heap[parent], &scheduler->heap[index]);
+    index = parent;
+  }
+}
+
+static void _sift_down(Scheduler *scheduler, uint32_t index)
+{
+  while (true)
+  {
+    uint32_t smallest = index;
+    uint32_t left = index * 2 + 1, right = index * 2 + 2;
+
+    if (left < scheduler->count && scheduler->heap[left].at < scheduler->heap[smallest].at)
+      smallest = left;
+    if (right < scheduler->count && scheduler->heap[right].at < scheduler->heap[smallest].at)
+      smallest = right;
+    if (smallest == index)
+      return;
+
+    _swap(&scheduler->heap[smallest], &scheduler->heap[index]);
+    index = smallest;
+  }
+}
+
+/* Takes heap[index] out, keeping the heap in order */
+static void _remove_at(Scheduler *scheduler, uint32_t index)
+{
+  scheduler->count--;
+  if (index == scheduler->count)
+    return;
+
+  scheduler->heap[index] = scheduler->heap[scheduler->count];
+  _sift_up(scheduler, index);
+  _sift_down(scheduler, index);
+}
+
+void scheduler_init(Scheduler *scheduler)
+{
+  scheduler->heap = NULL;
+  scheduler->count = 0;
+  scheduler->capacity = 0;
+  scheduler->last_id = 0;
+}
+
+void scheduler_free(Scheduler *scheduler)
+{
+  free(scheduler->heap);
+  scheduler_init(scheduler);
+}
+
+uint32_t scheduler_add(Scheduler *scheduler, uint64_t at, DeadlineFunc func, void *arg)
+{
+  if (scheduler->count == scheduler->capacity)
+  {
+    uint32_t capacity = scheduler->capacity ? scheduler->capacity * 2 : 8;
+    Deadline *heap = realloc(scheduler->heap, sizeof(Deadline) * capacity);
+    if (heap == NULL)
+      return 0;
+    scheduler->heap = heap;
+    scheduler->capacity = capacity;
+  }
+
+  /* 0 means failure, skip it when the ids wrap around */
+  if (++scheduler->last_id == 0)
+    scheduler->last_id = 1;
+
+  Deadline deadline = {.at = at, .id = scheduler->last_id, .func = func, .arg = arg};
+  scheduler->heap[scheduler->count] = deadline;
+  _sift_up(scheduler, scheduler->count++);
+  return deadline.id;
+}
+
+bool scheduler_cancel(Scheduler *scheduler, uint32_t id)
+{
+  for (uint32_t i = 0; i < scheduler->count; i++)
+    if (scheduler->heap[i].id == id)
+    {
+      _remove_at(scheduler, i);
+      return true;
+    }
+  return false;
+}
+
+uint64_t scheduler_next(const Scheduler *scheduler)
+{
+  return scheduler->count > 0 ? scheduler->heap[0].at : TIMER_NEVER;
+}
+
+int32_t scheduler_timeout_ms(const Scheduler *scheduler, uint64_t now)
+{
+  uint64_t next = scheduler_next(scheduler);
+  if (next == TIMER_NEVER)
+    return -1;
+  if (next <= now)
+    return 0;
+  return (next - now > INT32_MAX) ? INT32_MAX : (int32_t)(next - now);
+}
+
+uint32_t scheduler_run(Scheduler *scheduler, uint64_t now)
+{
+  uint32_t ran = 0;
+
+  while (scheduler->count > 0 && scheduler->heap[0].at <= now)
+  {
+    /* Take it out first, the function may schedule more stuff */
+    Deadline deadline = scheduler->heap[0];
+    _remove_at(scheduler, 0);
+
+    deadline.func(scheduler, deadline.arg);
+    ran++;
+  }
+  return ran;
+}
@@ -0,0 +1,82 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Nothing is scheduled (see scheduler_next) */
+#define TIMER_NEVER UINT64_MAX
+
+/*
+ * Milliseconds on a monotonic clock, only useful to compare with each other
+ * (changing the system's clock doesn't move it)
+ */
+uint64_t timer_now_ms(void);
+/* Same clock, in microseconds (for measuring how long stuff takes) */
+uint64_t timer_now_us(void);
+
+/* Measures time that can be paused, like a game timer */
+typedef struct
+{
+  /* When the current run started (meaningless while paused) */
+  uint64_t started_at;
+  /* Time of the runs before the current one */
+  uint64_t accumulated;
+  bool paused;
+} Stopwatch;
+
+/* Starts from 0 (running) */
+void stopwatch_start(Stopwatch *stopwatch);
+/* Pausing a paused stopwatch (or resuming a running one) does nothing */
+void stopwatch_pause(Stopwatch *stopwatch);
+void stopwatch_resume(Stopwatch *stopwatch);
+uint64_t stopwatch_ms(const Stopwatch *stopwatch);
+
+typedef struct Scheduler Scheduler;
+
+/* Called when its deadline passes, it may schedule new deadlines (itself included) */
+typedef void (*DeadlineFunc)(Scheduler *scheduler, void *arg);
+
+typedef struct
+{
+  uint64_t at;
+  uint32_t id;
+  DeadlineFunc func;
+  void *arg;
+} Deadline;
+
+/*
+ * Deadline list, a binary heap on the deadline time so the next one is always on top.
+ * Loops sleep until scheduler_next instead of polling.
+ */
+struct Scheduler
+{
+  Deadline *heap;
+  uint32_t count;
+  uint32_t capacity;
+  uint32_t last_id;
+};
+
+void scheduler_init(Scheduler *scheduler);
+void scheduler_free(Scheduler *scheduler);
+
+/**
+ * scheduler_add
+ * Schedules func(scheduler, arg) for a moment on the timer_now_ms clock
+ * @return The id of the deadline (for scheduler_cancel), 0 if there was no memory left
+ */
+uint32_t scheduler_add(Scheduler *scheduler, uint64_t at, DeadlineFunc func, void *arg);
+
+/* Returns false if the deadline already ran (or never existed) */
+bool scheduler_cancel(Scheduler *scheduler, uint32_t id);
+
+/* Time of the next deadline, TIMER_NEVER if there's none */
+uint64_t scheduler_next(const Scheduler *scheduler);
+
+/* Milliseconds to wait from now until the next deadline, -1 if there's none */
+int32_t scheduler_timeout_ms(const Scheduler *scheduler, uint64_t now);
+
+/* Runs every deadline that's due at `now`, returns how many ran */
+uint32_t scheduler_run(Scheduler *scheduler, uint64_t now);
+
+#endif /* TIMER_H */